@@ -0,0 +1,969 @@
+#include "jit.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include "parse.h"
+#include "program_cache.h"
+#include "runtime.h"
+#include "vm.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <malloc.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+// Объявлена в sanitizer/allocator_interface.h, который устанавливается не со всеми компиляторами
+extern "C" std::size_t __sanitizer_get_current_allocated_bytes();
+#endif
+
+using namespace std;
+
+namespace
+  {
+    // Не даёт компилятору выбросить вычисление value
+    template<typename T>
+    void DoNotOptimize(const T &value) {
+      asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // Выполняет body iterations раз, печатает и возвращает среднее время одной итерации в наносекундах
+    template<typename Fn>
+    double Measure(string_view name, size_t iterations, Fn body) {
+      const auto start = chrono::steady_clock::now();
+      for (size_t i = 0; i < iterations; ++i) {
+        body(i);
+      }
+      const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+      const double ns_per_op = elapsed.count() / static_cast<double>(iterations);
+      cout << "  "sv << left << setw(40) << name << fixed << setprecision(2) << ns_per_op << " ns/op"sv
+           << endl;
+      return ns_per_op;
+    }
+
+    void PrintSpeedup(double before, double after) {
+      cout << "  speedup: "sv << fixed << setprecision(2) << before / after << "x"sv << endl;
+    }
+
+    void RunProgram(const string &program, ostream &output) {
+      istringstream input(program);
+      parse::Lexer lexer(input);
+      auto tree = ParseProgram(lexer);
+      runtime::SimpleContext context{output};
+      runtime::Closure closure;
+      tree->Execute(closure, context);
+    }
+
+    // Программы из тестов интерпретатора
+    namespace programs
+      {
+        struct Program {
+          string_view name;
+          string text;
+        };
+
+        const vector<Program> &TestPrograms() {
+          static const vector<Program> programs = {
+              {"arithmetics"sv, "print 1+2+3+4+5, 1*2*3*4*5, 1-2-3-4-5, 36/4/3, 2*5+10/2\n"s},
+              {"recursion"sv, R"(
+class ArithmeticProgression:
+  def calc(n):
+    self.result = 0
+    self.calc_impl(n)
+
+  def calc_impl(n):
+    value = n
+    if value > 0:
+      self.result = self.result + value
+      self.calc_impl(value - 1)
+
+x = ArithmeticProgression()
+x.calc(10)
+print x.result
+)"s},
+              {"gcd"sv, R"(
+class GCD:
+  def __init__():
+    self.call_count = 0
+
+  def calc(a, b):
+    self.call_count = self.call_count + 1
+    if a < b:
+      return self.calc(b, a)
+    if b == 0:
+      return a
+    return self.calc(a - b, b)
+
+x = GCD()
+print x.calc(510510, 18629977)
+print x.calc(22, 17)
+print x.call_count
+)"s},
+              {"logical"sv, R"(
+a = 1
+b = 2
+c = 3
+ok = a + b > c and a + c > b and b + c > a
+print ok, not ok, a < b or b < a
+)"s},
+              {"polymorphism"sv, R"(
+class Shape:
+  def __str__():
+    return "Shape"
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def __str__():
+    return "Rect(" + str(self.w) + 'x' + str(self.h) + ')'
+
+class Triangle(Shape):
+  def __init__(a, b, c):
+    self.ok = a + b > c and a + c > b and b + c > a
+    if (self.ok):
+      self.a = a
+      self.b = b
+      self.c = c
+
+  def __str__():
+    if self.ok:
+      return 'Triangle(' + str(self.a) + ', ' + str(self.b) + ', ' + str(self.c) + ')'
+    else:
+      return 'Wrong triangle'
+
+print Rect(10, 20), Triangle(3, 4, 5), Triangle(125, 1, 2)
+)"s},
+          };
+          return programs;
+        }
+      }  // namespace programs
+
+    namespace allocations
+      {
+        // Выполняет программу после прохода escape, размещающего временные значения в STACK_REGION
+        void RunWithEscapeAnalysis(const string &program, ostream &output) {
+          istringstream input(program);
+          parse::Lexer lexer(input);
+          auto tree = ParseProgram(lexer);
+          opt::PassManager passes;
+          passes.DisableAll();
+          passes.SetEnabled("escape"sv, true);
+          passes.Run(tree);
+          runtime::SimpleContext context{output};
+          runtime::Closure closure;
+          tree->Execute(closure, context);
+        }
+
+        // Сколько объектов программы из тестов размещают в куче и сколько выделений памяти
+        // экономят immediate-числа, кэш малых чисел, неуничтожимые True/False и анализ времени жизни
+        // временных значений (столбцы escape и stack - после прохода escape)
+        void Benchmark() {
+          cout << "  "sv << left << setw(16) << "program"sv << setw(8) << "heap"sv << setw(12) << "immediate"sv
+               << setw(10) << "cached"sv << setw(8) << "bools"sv << setw(10) << "avoided"sv << setw(8)
+               << "escape"sv << "stack"sv << endl;
+          for (const auto &program: programs::TestPrograms()) {
+            runtime::ALLOCATION_STATS = {};
+            ostringstream output;
+            RunProgram(program.text, output);
+            const auto stats = runtime::ALLOCATION_STATS;
+            runtime::ALLOCATION_STATS = {};
+            RunWithEscapeAnalysis(program.text, output);
+            const auto &escape_stats = runtime::ALLOCATION_STATS;
+            cout << "  "sv << left << setw(16) << program.name << setw(8) << stats.heap_objects << setw(12)
+                 << stats.immediate_numbers << setw(10) << stats.cached_numbers << setw(8) << stats.immortal_bools
+                 << setw(10) << stats.AvoidedAllocations() << setw(8) << escape_stats.heap_objects
+                 << escape_stats.stack_objects << endl;
+          }
+        }
+      }  // namespace allocations
+
+    namespace inline_caches
+      {
+        // Попадания и промахи inline-кэшей методов в программах из тестов
+        void Benchmark() {
+          cout << "  "sv << left << setw(16) << "program"sv << setw(8) << "hits"sv << setw(8) << "misses"sv
+               << setw(8) << "mega"sv << setw(8) << "poly"sv << "mega sites"sv << endl;
+          for (const auto &program: programs::TestPrograms()) {
+            runtime::INLINE_CACHE_STATS = {};
+            ostringstream output;
+            RunProgram(program.text, output);
+            const auto &stats = runtime::INLINE_CACHE_STATS;
+            cout << "  "sv << left << setw(16) << program.name << setw(8) << stats.hits << setw(8) << stats.misses
+                 << setw(8) << stats.megamorphic << setw(8) << stats.polymorphic_sites << stats.megamorphic_sites
+                 << endl;
+          }
+        }
+      }  // namespace inline_caches
+
+    namespace comparison
+      {
+        using runtime::Bool;
+        using runtime::Context;
+        using runtime::Number;
+        using runtime::ObjectHolder;
+        using runtime::String;
+
+        template<typename T>
+        T *DynamicCast(const ObjectHolder &holder) {
+          return dynamic_cast<T *>(holder.Get());
+        }
+
+        // runtime::Equal в том виде, в каком он был до появления ObjectKind: цепочка dynamic_cast
+        bool DynamicCastEqual(const ObjectHolder &lhs, const ObjectHolder &rhs, Context & /*context*/) {
+          if (!lhs && !rhs) {
+            return true;
+          }
+          if (DynamicCast<Number>(lhs) && DynamicCast<Number>(rhs)) {
+            return DynamicCast<Number>(lhs)->GetValue() == DynamicCast<Number>(rhs)->GetValue();
+          }
+          if (DynamicCast<String>(lhs) && DynamicCast<String>(rhs)) {
+            return DynamicCast<String>(lhs)->GetValue() == DynamicCast<String>(rhs)->GetValue();
+          }
+          if (DynamicCast<Bool>(lhs) && DynamicCast<Bool>(rhs)) {
+            return DynamicCast<Bool>(lhs)->GetValue() == DynamicCast<Bool>(rhs)->GetValue();
+          }
+          throw runtime_error("Cannot compare objects"s);
+        }
+
+        template<typename Cmp>
+        double Run(string_view name, const ObjectHolder &lhs, const ObjectHolder &rhs, Cmp cmp) {
+          constexpr size_t ITERATIONS = 5'000'000;
+          runtime::DummyContext context;
+          return Measure(name, ITERATIONS, [&](size_t) {
+            DoNotOptimize(cmp(lhs, rhs, context));
+          });
+        }
+
+        void Compare(string_view title, const ObjectHolder &lhs, const ObjectHolder &rhs) {
+          cout << title << ':' << endl;
+          const double before = Run("dynamic_cast", lhs, rhs, DynamicCastEqual);
+          const double after = Run("ObjectKind", lhs, rhs, [](const auto &l, const auto &r, Context &context) {
+            return runtime::Equal(l, r, context);
+          });
+          PrintSpeedup(before, after);
+        }
+
+        // Стоимость одного runtime::Equal при определении типа через ObjectKind и через dynamic_cast
+        void Benchmark() {
+          Number boxed_lhs{42};
+          Number boxed_rhs{42};
+          String str{"some string"s};
+          Compare("Number == Number (immediate)"sv, ObjectHolder::Own(Number{100'042}),
+                  ObjectHolder::Own(Number{100'042}));
+          Compare("Number == Number (boxed)"sv, ObjectHolder::Share(boxed_lhs), ObjectHolder::Share(boxed_rhs));
+          Compare("String == String"sv, ObjectHolder::Share(str), ObjectHolder::Own(String{"some string"s}));
+          Compare("Bool == Bool"sv, ObjectHolder::Own(Bool{true}), ObjectHolder::Own(Bool{false}));
+        }
+      }  // namespace comparison
+
+    namespace early_return
+      {
+        // Рекурсивный метод, который возвращает значение из вложенных if
+        const string PROGRAM = R"(
+class Fib:
+  def calc(n):
+    if n < 2:
+      if n < 1:
+        return 0
+      return 1
+    return self.calc(n - 1) + self.calc(n - 2)
+
+fib = Fib()
+print fib.calc(20)
+)"s;
+        // Число вызовов Fib.calc при вычислении calc(20)
+        constexpr size_t CALLS_PER_RUN = 21'891;
+
+        // Стоимость вызова метода, завершающегося оператором return
+        void Benchmark() {
+          constexpr size_t ITERATIONS = 20;
+          istringstream input(PROGRAM);
+          parse::Lexer lexer(input);
+          const auto tree = ParseProgram(lexer);
+          const double ns_per_run = Measure("Fib.calc(20)"sv, ITERATIONS, [&](size_t) {
+            ostringstream output;
+            runtime::SimpleContext context{output};
+            runtime::Closure closure;
+            tree->Execute(closure, context);
+            DoNotOptimize(output.str());
+          });
+          cout << "  "sv << left << setw(40) << "per call"sv << fixed << setprecision(2)
+               << ns_per_run / CALLS_PER_RUN << " ns/call"sv << endl;
+        }
+      }  // namespace early_return
+
+    namespace backends
+      {
+        // Программы с большим числом вызовов методов
+        const vector<programs::Program> &MethodHeavyPrograms() {
+          static const vector<programs::Program> programs = {
+              {"fib"sv, early_return::PROGRAM},
+              {"counter"sv, R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(delta):
+    self.value = self.value + delta
+
+  def get():
+    return self.value
+
+class Loop:
+  def run(counter, n):
+    if n > 0:
+      counter.add(n * 2 - n)
+      self.run(counter, n - 1)
+
+c = Counter()
+l = Loop()
+l.run(c, 2000)
+print c.get()
+)"s},
+          };
+          return programs;
+        }
+
+        // Время выполнения программ обходом дерева и виртуальной машиной
+        void Benchmark() {
+          constexpr size_t ITERATIONS = 20;
+          for (const auto &program: MethodHeavyPrograms()) {
+            istringstream input(program.text);
+            parse::Lexer lexer(input);
+            const auto tree = ParseProgram(lexer);
+            const auto run = [&](vm::Backend backend) {
+              return [&tree, backend](size_t) {
+                ostringstream output;
+                runtime::SimpleContext context{output};
+                runtime::Closure closure;
+                vm::Run(*tree, closure, context, backend);
+                DoNotOptimize(output.str());
+              };
+            };
+            cout << program.name << ':' << endl;
+            // Сравниваются сами способы исполнения, без машинного кода
+            jit::SetEnabled(false);
+            const double before = Measure("tree walker"sv, ITERATIONS, run(vm::Backend::TreeWalker));
+            const double after = Measure("bytecode"sv, ITERATIONS, run(vm::Backend::Bytecode));
+            jit::SetEnabled(true);
+            PrintSpeedup(before, after);
+          }
+        }
+      }  // namespace backends
+
+    namespace jit_methods
+      {
+        // Время выполнения рекурсивного числового метода интерпретатором и машинным кодом
+        void Benchmark() {
+          constexpr size_t ITERATIONS = 20;
+          for (const auto backend: {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+            istringstream input(early_return::PROGRAM);
+            parse::Lexer lexer(input);
+            const auto tree = ParseProgram(lexer);
+            const auto run = [&](size_t) {
+              ostringstream output;
+              runtime::SimpleContext context{output};
+              runtime::Closure closure;
+              vm::Run(*tree, closure, context, backend);
+              DoNotOptimize(output.str());
+            };
+            cout << (backend == vm::Backend::TreeWalker ? "tree walker:"sv : "bytecode:"sv) << endl;
+            jit::SetEnabled(false);
+            const double before = Measure("interpreter"sv, ITERATIONS, run);
+            jit::SetEnabled(true);
+            const double after = Measure("jit"sv, ITERATIONS, run);
+            PrintSpeedup(before, after);
+          }
+        }
+      }  // namespace jit_methods
+
+    namespace program_cache
+      {
+        // Программа из count однотипных классов с методами
+        string MakeLargeProgram(size_t count) {
+          ostringstream program;
+          for (size_t i = 0; i < count; ++i) {
+            program << "class Shape"sv << i << ":\n"sv
+                    << "  def __init__(w, h):\n    self.w = w\n    self.h = h\n\n"sv
+                    << "  def area():\n    result = self.w * self.h\n    return result\n\n"sv
+                    << "  def describe(prefix):\n"sv
+                    << "    if self.area() > 10 and not self.w == self.h:\n"sv
+                    << "      return prefix + ' large ' + str(self.area())\n"sv
+                    << "    return prefix + ' small'\n\n"sv;
+          }
+          program << "s = Shape0(2, 3)\nprint s.describe('shape')\n"sv;
+          return program.str();
+        }
+
+        // Время получения дерева разбора: лексический и синтаксический разбор против загрузки кэша
+        void Benchmark() {
+          constexpr size_t ITERATIONS = 20;
+          const string source = MakeLargeProgram(200);
+          const auto path = filesystem::temp_directory_path() / "mython_benchmark.mythonc"s;
+          {
+            istringstream input(source);
+            parse::Lexer lexer(input);
+            if (!cache::Store(path, *ParseProgram(lexer), source)) {
+              throw runtime_error("cannot write program cache"s);
+            }
+          }
+          const double before = Measure("parse"sv, ITERATIONS, [&](size_t) {
+            istringstream input(source);
+            parse::Lexer lexer(input);
+            DoNotOptimize(ParseProgram(lexer));
+          });
+          const double after = Measure("load cache"sv, ITERATIONS, [&](size_t) {
+            DoNotOptimize(cache::Load(path, source));
+          });
+          PrintSpeedup(before, after);
+          filesystem::remove(path);
+        }
+      }  // namespace program_cache
+
+    namespace inlining
+      {
+        // Вызовы геттеров и сеттеров из рекурсивного метода
+        const string PROGRAM = R"(
+class Vector:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def get_x():
+    return self.x
+
+  def get_y():
+    return self.y
+
+  def set_x(x):
+    self.x = x
+
+class Walker:
+  def walk(v, n):
+    if n > 0:
+      v.set_x(v.get_x() + v.get_y())
+      return self.walk(v, n - 1)
+    return v.get_x()
+
+w = Walker()
+print w.walk(Vector(0, 1), 500)
+)"s;
+
+        void Benchmark() {
+          constexpr size_t ITERATIONS = 200;
+          for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+            cout << (backend == vm::Backend::TreeWalker ? "tree walker:"sv : "bytecode:"sv) << endl;
+            double times[2];
+            for (const bool inline_methods : {false, true}) {
+              istringstream input(PROGRAM);
+              parse::Lexer lexer(input);
+              auto tree = ParseProgram(lexer);
+              opt::PassManager passes;
+              passes.DisableAll();
+              passes.SetEnabled("inline"sv, inline_methods);
+              passes.Run(tree);
+              times[inline_methods] = Measure(inline_methods ? "inlined"sv : "calls"sv, ITERATIONS, [&](size_t) {
+                ostringstream output;
+                runtime::SimpleContext context{output};
+                runtime::Closure closure;
+                vm::Run(*tree, closure, context, backend);
+                DoNotOptimize(output.str());
+              });
+            }
+            PrintSpeedup(times[0], times[1]);
+          }
+        }
+      }  // namespace inlining
+
+    namespace loops
+      {
+        // Одна и та же сумма: рекурсией, как до появления циклов, и циклом for по range
+        const string RECURSION = R"(
+class Sum:
+  def calc(i, n, total):
+    if i < n:
+      return self.calc(i + 1, n, total + i * i)
+    return total
+
+s = Sum()
+print s.calc(0, 1000, 0)
+)"s;
+
+        const string LOOP = R"(
+class Sum:
+  def calc(n):
+    total = 0
+    for i in range(n):
+      total = total + i * i
+    return total
+
+s = Sum()
+print s.calc(1000)
+)"s;
+
+        void Benchmark() {
+          constexpr size_t ITERATIONS = 200;
+          // Сравниваются интерпретаторы: рекурсивный метод иначе исполнялся бы машинным кодом
+          jit::SetEnabled(false);
+          for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+            cout << (backend == vm::Backend::TreeWalker ? "tree walker:"sv : "bytecode:"sv) << endl;
+            double times[2];
+            for (const bool loop : {false, true}) {
+              istringstream input(loop ? LOOP : RECURSION);
+              parse::Lexer lexer(input);
+              auto tree = ParseProgram(lexer);
+              const auto heap_objects = runtime::ALLOCATION_STATS.heap_objects;
+              times[loop] = Measure(loop ? "for range"sv : "recursion"sv, ITERATIONS, [&](size_t) {
+                ostringstream output;
+                runtime::SimpleContext context{output};
+                runtime::Closure closure;
+                vm::Run(*tree, closure, context, backend);
+                DoNotOptimize(output.str());
+              });
+              cout << "    heap objects per run: "sv
+                   << (runtime::ALLOCATION_STATS.heap_objects - heap_objects) / ITERATIONS << endl;
+            }
+            PrintSpeedup(times[0], times[1]);
+          }
+          jit::SetEnabled(true);
+        }
+      }  // namespace loops
+
+    namespace lists
+      {
+        // Последовательность из n чисел: встроенный список против связного списка экземпляров класса.
+        // Программа строит последовательность, суммирует её и читает средний элемент
+        string MakeListProgram(size_t n) {
+          ostringstream program;
+          program << R"(
+xs = []
+for i in range()"sv << n << R"():
+  xs.append(i)
+total = 0
+for x in xs:
+  total = total + x
+print total, xs[)"sv << n / 2 << "]\n"sv;
+          return program.str();
+        }
+
+        string MakeLinkedProgram(size_t n) {
+          ostringstream program;
+          program << R"(
+class Node:
+  def __init__(value, next):
+    self.value = value
+    self.next = next
+
+head = None
+for i in range()"sv << n << R"():
+  head = Node()"sv << n - 1 << R"( - i, head)
+total = 0
+node = head
+for i in range()"sv << n << R"():
+  total = total + node.value
+  node = node.next
+node = head
+for i in range()"sv << n / 2 << R"():
+  node = node.next
+print total, node.value
+# Цепочка разрывается, иначе рекурсивное уничтожение узлов переполнит стек
+node = head
+for i in range()"sv << n - 1 << R"():
+  next = node.next
+  node.next = None
+  node = next
+)"sv;
+          return program.str();
+        }
+
+        void Benchmark() {
+          for (const size_t n : {100000U, 1000000U}) {
+            const size_t iterations = n < 1000000U ? 10 : 2;
+            cout << "n = "sv << n << ":"sv << endl;
+            double times[2];
+            for (const bool native : {false, true}) {
+              istringstream input(native ? MakeListProgram(n) : MakeLinkedProgram(n));
+              parse::Lexer lexer(input);
+              auto tree = ParseProgram(lexer);
+              times[native] = Measure(native ? "list"sv : "linked instances"sv, iterations, [&](size_t) {
+                ostringstream output;
+                runtime::SimpleContext context{output};
+                runtime::Closure closure;
+                vm::Run(*tree, closure, context, vm::Backend::Bytecode);
+                DoNotOptimize(output.str());
+              });
+            }
+            PrintSpeedup(times[0], times[1]);
+          }
+        }
+      }  // namespace lists
+
+    namespace dicts
+      {
+        // Ассоциативный массив из n строковых ключей: встроенный словарь против цепочки экземпляров класса,
+        // ключи которой сравниваются по очереди. Программа добавляет ключи и ищет каждый из них
+        string MakeDictProgram(size_t n) {
+          ostringstream program;
+          program << R"(
+d = {}
+for i in range()"sv << n << R"():
+  d['k' + str(i)] = i
+total = 0
+for i in range()"sv << n << R"():
+  total = total + d['k' + str(i)]
+print total
+)"sv;
+          return program.str();
+        }
+
+        string MakeChainProgram(size_t n) {
+          ostringstream program;
+          program << R"(
+class Entry:
+  def __init__(key, value, next):
+    self.key = key
+    self.value = value
+    self.next = next
+
+class Map:
+  def __init__():
+    self.head = None
+    self.size = 0
+
+  def set(key, value):
+    self.head = Entry(key, value, self.head)
+    self.size = self.size + 1
+
+  def get(key):
+    node = self.head
+    for i in range(self.size):
+      if node.key == key:
+        return node.value
+      node = node.next
+    return None
+
+d = Map()
+for i in range()"sv << n << R"():
+  d.set('k' + str(i), i)
+total = 0
+for i in range()"sv << n << R"():
+  total = total + d.get('k' + str(i))
+print total
+)"sv;
+          return program.str();
+        }
+
+        void ComparePrograms(size_t n) {
+          cout << "n = "sv << n << ":"sv << endl;
+          double times[2];
+          for (const bool native : {false, true}) {
+            istringstream input(native ? MakeDictProgram(n) : MakeChainProgram(n));
+            parse::Lexer lexer(input);
+            auto tree = ParseProgram(lexer);
+            times[native] = Measure(native ? "dict"sv : "instance chain"sv, 3, [&](size_t) {
+              ostringstream output;
+              runtime::SimpleContext context{output};
+              runtime::Closure closure;
+              vm::Run(*tree, closure, context, vm::Backend::Bytecode);
+              DoNotOptimize(output.str());
+            });
+          }
+          PrintSpeedup(times[0], times[1]);
+        }
+
+        // Время поиска в runtime::Dict с n строковыми ключами не должно расти вместе с n
+        void MeasureLookups(size_t n) {
+          runtime::DummyContext context;
+          runtime::Dict dict;
+          vector<runtime::ObjectHolder> keys;
+          keys.reserve(n);
+          for (size_t i = 0; i < n; ++i) {
+            keys.push_back(runtime::ObjectHolder::Own(runtime::String{"key"s + to_string(i * 7919)}));
+            dict.Set(keys.back(), runtime::ObjectHolder::Own(runtime::Number{static_cast<int>(i)}), context);
+          }
+          const size_t lookups = 2000000;
+          Measure("lookup, "s + to_string(n) + " string keys"s, lookups, [&](size_t i) {
+            DoNotOptimize(dict.Find(keys[(i * 2654435761U) % n], context));
+          });
+        }
+
+        void Benchmark() {
+          for (const size_t n : {1000U, 4000U}) {
+            ComparePrograms(n);
+          }
+          for (const size_t n : {10000U, 100000U, 1000000U}) {
+            MeasureLookups(n);
+          }
+        }
+      }  // namespace dicts
+
+    namespace closures
+      {
+        // Добавляет names в пустую таблицу Map, пока не выполнит около 2 млн вставок. Возвращает время
+        // одной вставки и заполненную таблицу
+        template<typename Map, typename Name>
+        pair<double, Map> MeasureInsert(string_view name, const vector<Name> &names) {
+          const size_t n = names.size();
+          Map map;
+          const double time = Measure(name, 2000000 / n * n, [&](size_t i) {
+            if (i % n == 0) {
+              map = Map{};
+            }
+            map[names[i % n]] = runtime::ObjectHolder::None();
+          });
+          return {time, std::move(map)};
+        }
+
+        template<typename Map, typename Name>
+        double MeasureLookup(string_view name, const Map &map, const vector<Name> &names) {
+          return Measure(name, 2000000, [&](size_t i) {
+            DoNotOptimize(map.find(names[(i * 2654435761U) % names.size()]));
+          });
+        }
+
+        // Добавление и поиск n имён: std::unordered_map со строковыми ключами против runtime::Closure,
+        // ключи которой - символы, интернированные при разборе программы
+        void CompareMaps(size_t n) {
+          cout << "n = "sv << n << ":"sv << endl;
+          vector<string> names;
+          vector<runtime::Symbol> symbols;
+          for (size_t i = 0; i < n; ++i) {
+            names.push_back("variable_"s + to_string(i * 7919));
+            symbols.emplace_back(names.back());
+          }
+          using StdMap = unordered_map<string, runtime::ObjectHolder>;
+          const auto [std_insert, std_map] = MeasureInsert<StdMap>("unordered_map insert"sv, names);
+          const auto [closure_insert, closure] = MeasureInsert<runtime::Closure>("Closure insert"sv, symbols);
+          PrintSpeedup(std_insert, closure_insert);
+          const double std_lookup = MeasureLookup("unordered_map lookup"sv, std_map, names);
+          const double closure_lookup = MeasureLookup("Closure lookup"sv, closure, symbols);
+          PrintSpeedup(std_lookup, closure_lookup);
+        }
+
+        void Benchmark() {
+          for (const size_t n : {16U, 1000U, 100000U}) {
+            CompareMaps(n);
+          }
+        }
+      }  // namespace closures
+
+    namespace symbols
+      {
+        // Программа из count классов, имена методов, параметров и переменных в которой такой же длины,
+        // как в обычном коде, и повторяются в каждом классе
+        string MakeProgram(size_t count) {
+          ostringstream program;
+          for (size_t i = 0; i < count; ++i) {
+            program << "class Account"sv << i << ":\n"sv
+                    << "  def __init__(owner_name, initial_balance):\n"sv
+                    << "    self.owner_name = owner_name\n"sv
+                    << "    self.current_balance = initial_balance\n"sv
+                    << "    self.transaction_count = 0\n\n"sv
+                    << "  def deposit_amount(amount_to_deposit):\n"sv
+                    << "    self.current_balance = self.current_balance + amount_to_deposit\n"sv
+                    << "    self.transaction_count = self.transaction_count + 1\n"sv
+                    << "    return self.current_balance\n\n"sv
+                    << "  def describe_account(description_prefix):\n"sv
+                    << "    balance_description = str(self.current_balance)\n"sv
+                    << "    return description_prefix + ' ' + self.owner_name + ': ' + balance_description\n\n"sv
+                    << "account_instance = Account"sv << i << "('owner', "sv << i << ")\n"sv
+                    << "account_instance.deposit_amount(10)\n"sv
+                    << "print account_instance.describe_account('account')\n"sv;
+          }
+          return program.str();
+        }
+
+        // Объём памяти, выделенной в куче
+        size_t HeapBytes() {
+#if defined(__SANITIZE_ADDRESS__)
+          return __sanitizer_get_current_allocated_bytes();
+#else
+          return mallinfo2().uordblks;
+#endif
+        }
+
+        // Память, занятая лексемами (вместе с таблицей символов) и деревом разбора большой программы,
+        // и время разбора
+        void Benchmark() {
+          const string source = MakeProgram(2000);
+          istringstream input(source);
+          const size_t start = HeapBytes();
+          auto lexer = make_unique<parse::Lexer>(input);
+          const size_t tokens = HeapBytes() - start;
+          auto tree = ParseProgram(*lexer);
+          const size_t tree_bytes = HeapBytes() - start - tokens;
+          cout << "  source:                                 "sv << source.size() / 1024 << " KiB"sv << endl;
+          cout << "  tokens:                                 "sv << tokens / 1024 << " KiB"sv << endl;
+          cout << "  tree:                                   "sv << tree_bytes / 1024 << " KiB"sv << endl;
+          const auto stats = runtime::GetSymbolStats();
+          cout << "  symbols:                                "sv << stats.symbols << " of "sv << stats.interned
+               << " interned names and strings"sv << endl;
+          lexer.reset();
+          tree.reset();
+
+          Measure("lex + parse"sv, 5, [&](size_t) {
+            istringstream program(source);
+            parse::Lexer program_lexer(program);
+            DoNotOptimize(ParseProgram(program_lexer));
+          });
+        }
+      }  // namespace symbols
+
+    namespace ropes
+      {
+        // Строка из n присоединений фрагмента по 100 символов
+        string MakeProgram(size_t n) {
+          ostringstream program;
+          program << "chunk = '"sv << string(100, 'x') << "'\n"sv << R"(
+s = ''
+for i in range()"sv << n << R"():
+  s = s + chunk
+print len(s)
+print s
+)"sv;
+          return program.str();
+        }
+
+        // Присоединение с копированием обоих операндов, как до появления узлов конкатенации,
+        // против String::Concat. Затем программа строит строку в 10 МБ и выводит её
+        void Benchmark() {
+          constexpr size_t APPENDS = 10000;
+          const auto chunk = runtime::ObjectHolder::Own(runtime::String{string(100, 'x')});
+          double times[2];
+          for (const bool rope : {false, true}) {
+            const auto name = rope ? "1 MB, 10^4 appends: rope"sv : "1 MB, 10^4 appends: copy"sv;
+            times[rope] = Measure(name, 1, [&](size_t) {
+              auto str = runtime::ObjectHolder::Own(runtime::String{""s});
+              for (size_t i = 0; i < APPENDS; ++i) {
+                if (rope) {
+                  str = runtime::String::Concat(str, chunk, nullptr);
+                } else {
+                  str = runtime::ObjectHolder::Own(
+                      runtime::String{str.As<runtime::String>().GetValue() + chunk.As<runtime::String>().GetValue()});
+                }
+              }
+              DoNotOptimize(str.As<runtime::String>().GetValue());
+            });
+          }
+          PrintSpeedup(times[0], times[1]);
+
+          istringstream input(MakeProgram(100000));
+          parse::Lexer lexer(input);
+          auto tree = ParseProgram(lexer);
+          size_t length = 0;
+          Measure("10 MB, 10^5 appends + print"sv, 3, [&](size_t) {
+            ostringstream output;
+            runtime::SimpleContext context{output};
+            runtime::Closure closure;
+            vm::Run(*tree, closure, context, vm::Backend::Bytecode);
+            length = output.str().size();
+          });
+          cout << "  output:                                 "sv << length / 1024 << " KiB"sv << endl;
+        }
+      }  // namespace ropes
+
+    namespace temporaries
+      {
+        // Строки из нескольких частей: каждое сложение, кроме первого, получает левым операндом
+        // временный результат предыдущего
+        string MakeProgram(size_t n) {
+          ostringstream program;
+          program << R"(
+total = 0
+for i in range()"sv << n << R"():
+  line = 'item ' + str(i) + ': ' + str(i * 2) + ', ' + str(i * 3) + ';'
+  total = total + len(line)
+print total
+)"sv;
+          return program.str();
+        }
+
+        // Сборка строки из 32 частей новой строкой на каждое сложение против дополнения временной строки
+        // на месте, затем программа со сложением временных строк
+        void Benchmark() {
+          constexpr size_t LINES = 20000;
+          const auto part = runtime::ObjectHolder::Own(runtime::String{"part"s});
+          double times[2];
+          for (const bool in_place : {false, true}) {
+            const auto name = in_place ? "32 parts: in place"sv : "32 parts: new string"sv;
+            times[in_place] = Measure(name, LINES, [&](size_t) {
+              auto line = runtime::ObjectHolder::Own(runtime::String{"line"s});
+              for (size_t i = 0; i < 32; ++i) {
+                line = in_place ? runtime::String::ConcatTemporary(line, part, nullptr)
+                                : runtime::String::Concat(line, part, nullptr);
+              }
+              DoNotOptimize(line.As<runtime::String>().GetValue());
+            });
+          }
+          PrintSpeedup(times[0], times[1]);
+
+          constexpr size_t N = 100000;
+          istringstream input(MakeProgram(N));
+          parse::Lexer lexer(input);
+          auto tree = ParseProgram(lexer);
+          for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+            const auto heap_objects = runtime::ALLOCATION_STATS.heap_objects;
+            Measure(backend == vm::Backend::TreeWalker ? "program: tree"sv : "program: bytecode"sv, 1, [&](size_t) {
+              ostringstream output;
+              runtime::SimpleContext context{output};
+              runtime::Closure closure;
+              vm::Run(*tree, closure, context, backend);
+              DoNotOptimize(output.str());
+            });
+            cout << "  heap objects per line:                  "sv << fixed << setprecision(2)
+                 << static_cast<double>(runtime::ALLOCATION_STATS.heap_objects - heap_objects) / N << endl;
+          }
+        }
+      }  // namespace temporaries
+
+    struct Benchmark {
+      string_view name;
+      void (*run)();
+    };
+
+    const vector<Benchmark> BENCHMARKS = {
+        {"comparison"sv, comparison::Benchmark},
+        {"allocations"sv, allocations::Benchmark},
+        {"inline_caches"sv, inline_caches::Benchmark},
+        {"early_return"sv, early_return::Benchmark},
+        {"backends"sv, backends::Benchmark},
+        {"program_cache"sv, program_cache::Benchmark},
+        {"jit"sv, jit_methods::Benchmark},
+        {"inlining"sv, inlining::Benchmark},
+        {"loops"sv, loops::Benchmark},
+        {"lists"sv, lists::Benchmark},
+        {"dicts"sv, dicts::Benchmark},
+        {"closures"sv, closures::Benchmark},
+        {"symbols"sv, symbols::Benchmark},
+        {"ropes"sv, ropes::Benchmark},
+        {"temporaries"sv, temporaries::Benchmark},
+    };
+
+  }  // namespace
+
+// Запускает бенчмарки, имена которых переданы в командной строке, либо все бенчмарки
+int main(int argc, char **argv) {
+  try {
+    for (const auto &benchmark: BENCHMARKS) {
+      bool selected = argc < 2;
+      for (int i = 1; i < argc; ++i) {
+        selected = selected || benchmark.name == argv[i];
+      }
+      if (selected) {
+        cout << "== "sv << benchmark.name << " =="sv << endl;
+        benchmark.run();
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vm
+  {
+
+// Инструкции виртуальной машины. Операнды a, b, c, d - номера регистров, индексы в таблицах
+// функции (constants, names, call_sites, new_sites, inline_guards, caches) либо адреса переходов
+#define MYTHON_VM_OPCODES(X) \
+    X(LoadNone)      /* r[a] = None */ \
+    X(LoadTrue)      /* r[a] = True */ \
+    X(LoadFalse)     /* r[a] = False */ \
+    X(LoadConst)     /* r[a] = constants[b] */ \
+    X(Move)          /* r[a] = r[b] */ \
+    X(LoadLocal)     /* r[a] = r[b]; ошибка, если переменной b ещё не присвоено значение */ \
+    X(LoadName)      /* r[a] = closure[names[b]] */ \
+    X(StoreName)     /* closure[names[a]] = r[b] */ \
+    X(GetField)      /* r[a] = r[b].names[c], field_caches[d] - кэш поля */ \
+    X(CheckInstance) /* ошибка, если r[a] не экземпляр класса */ \
+    X(SetField)      /* r[a].names[b] = r[c], field_caches[d] - кэш поля */ \
+    X(DefineClass)   /* closure[names[b]] = constants[a] */ \
+    X(Write)         /* выводит r[a] */ \
+    X(WriteSpace)    /* выводит пробел */ \
+    X(WriteNewline)  /* выводит перевод строки */ \
+    X(Stringify)     /* r[a] = str(r[b]); если c != 0, строка размещается в STACK_REGION */ \
+    X(Add)           /* r[a] = r[b] + r[c], caches[d] - кэш метода __add__ */ \
+    X(Concat)        /* как Add, но результат сложения строк размещается в STACK_REGION */ \
+    X(Sub)           /* r[a] = r[b] - r[c] */ \
+    X(Mult)          /* r[a] = r[b] * r[c] */ \
+    X(Div)           /* r[a] = r[b] / r[c] */ \
+    X(Negate)        /* r[a] = -r[b] */ \
+    X(Not)           /* r[a] = not r[b] */ \
+    X(Equal)         /* r[a] = r[b] == r[c], caches[d] и caches[d + 1] - кэши __eq__ и __lt__ */ \
+    X(NotEqual) \
+    X(Less) \
+    X(Greater) \
+    X(LessOrEqual) \
+    X(GreaterOrEqual) \
+    X(Jump)          /* переход на a */ \
+    X(JumpIfTrue)    /* переход на b, если r[a] приводится к True */ \
+    X(JumpIfFalse)   /* переход на b, если r[a] приводится к False */ \
+    X(RangeCheck)    /* ошибка, если r[a] или r[b] не числа */ \
+    X(ForRange)      /* переход на b, если r[a] >= r[c] */ \
+    X(Increment)     /* r[a] = r[a] + 1 */ \
+    X(ForEach)       /* если r[a + 1] < len(r[a]): r[c] = r[a][r[a + 1]], r[a + 1] += 1; иначе переход на b */ \
+    X(NewList)       /* r[a] = [r[b], r[b + 1], ..., r[b + c - 1]] */ \
+    X(GetItem)       /* r[a] = r[b][r[c]] */ \
+    X(SetItem)       /* r[a][r[b]] = r[c] */ \
+    X(Length)        /* r[a] = len(r[b]) */ \
+    X(NewDict)       /* r[a] = {r[b]: r[b + 1], ..., r[b + 2c - 2]: r[b + 2c - 1]} */ \
+    X(Contains)      /* r[a] = r[b] in r[c] */ \
+    X(GuardMethod)   /* переход на b, если у r[a] нет метода inline_guards[c] */ \
+    X(TailCall)      /* параметры = r[a + 1], r[a + 2], ...; локальные переменные сбрасываются, переход на 0 */ \
+    X(PrepareCall)   /* ищет метод call_sites[c] у r[b]; если r[b] не список и метода нет, r[a] = None и переход на d */ \
+    X(Call)          /* r[a] = r[b].method(r[b + 1], ...), метод найден предшествующей PrepareCall */ \
+    X(New)           /* r[a] = new_sites[c].class(r[b], ...); если d != 0, экземпляр размещается в STACK_REGION */ \
+    X(RegionMark)    /* r[a] = граница STACK_REGION */ \
+    X(RegionRelease) /* освобождает объекты STACK_REGION, размещённые после границы r[a] */ \
+    X(Return)        /* завершает функцию, возвращая r[a] */ \
+    X(ReturnNone)    /* завершает функцию, возвращая None */
+
+    enum class OpCode : std::uint8_t {
+#define MYTHON_VM_OPCODE_ENUM(name) name,
+      MYTHON_VM_OPCODES(MYTHON_VM_OPCODE_ENUM)
+#undef MYTHON_VM_OPCODE_ENUM
+    };
+
+    using Register = std::uint32_t;
+
+    struct Instruction {
+      OpCode op;
+      // У Add и Concat: r[b] - временный регистр, который после инструкции не читается, а не регистр
+      // переменной, и сложение строк может дополнить его строку на месте
+      bool temporary_b = false;
+      std::uint32_t a = 0;
+      std::uint32_t b = 0;
+      std::uint32_t c = 0;
+      std::uint32_t d = 0;
+    };
+
+    struct Function;
+
+// Точка вызова метода
+    struct CallSite {
+      runtime::Selector selector;
+      std::uint32_t argument_count;
+      runtime::InlineCache cache;
+      // Последний вызванный метод и его скомпилированное тело (nullptr - метод исполняется обходом дерева)
+      const runtime::Method *last_method = nullptr;
+      Function *last_function = nullptr;
+    };
+
+// Точка создания экземпляра класса. Как и ast::NewInstance, метод __init__ вызывается у экземпляра,
+// принадлежащего узлу дерева разбора, а результатом становится его копия
+    struct NewSite {
+      runtime::ClassInstance *instance;
+      std::uint32_t argument_count;
+      const runtime::Method *init = nullptr;
+      Function *init_function = nullptr;
+      bool init_resolved = false;
+    };
+
+// Проверка подставленного вызова (см. ast::InlinedCall): у класса объекта должен быть метод method
+    struct InlineGuard {
+      runtime::Selector selector;
+      const runtime::Method *method;
+    };
+
+// Скомпилированное тело метода либо программа верхнего уровня
+    struct Function {
+      std::string name;
+      std::vector<Instruction> code;
+      std::vector<runtime::ObjectHolder> constants;
+      std::vector<runtime::Symbol> names;
+      std::vector<CallSite> call_sites;
+      std::vector<NewSite> new_sites;
+      std::vector<InlineGuard> inline_guards;
+      std::vector<runtime::InlineCache> caches;
+      std::vector<runtime::FieldCache> field_caches;
+      // Регистры 0..local_count-1 - слоты кадра метода (self, параметры, локальные переменные),
+      // остальные регистры - временные значения
+      std::uint32_t register_count = 0;
+      std::uint32_t local_count = 0;
+      std::uint32_t argument_count = 0;
+    };
+
+// Скомпилированная программа. Ссылается на узлы дерева разбора, которое должно жить дольше программы
+    struct Program {
+      Function main;
+      std::unordered_map<const runtime::Method *, std::unique_ptr<Function>> methods;
+
+      // Возвращает скомпилированное тело метода либо nullptr
+      [[nodiscard]] Function *FindMethod(const runtime::Method *method) const {
+        const auto it = methods.find(method);
+        return it != methods.end() ? it->second.get() : nullptr;
+      }
+    };
+
+  }  // namespace vm
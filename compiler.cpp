@@ -0,0 +1,525 @@
+#include "compiler.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace vm
+  {
+    using namespace std::literals;
+
+    namespace
+      {
+        const runtime::Selector INIT_METHOD = runtime::InternSelector("__init__"sv);
+
+        template<typename T>
+        const T *NodeAs(const ast::Statement &node) {
+          return dynamic_cast<const T *>(&node);
+        }
+
+        template<ast::Comparator cmp>
+        bool IsComparison(const ast::Statement &node) {
+          return NodeAs<ast::Comparison<cmp>>(node) != nullptr;
+        }
+      }  // namespace
+
+    std::unique_ptr<Program> Compiler::Compile(const ast::Statement &program) {
+      auto result = std::make_unique<Program>();
+      result->main.name = "<program>"s;
+      Compiler compiler(*result, result->main, false);
+      compiler.CompileFunction(program);
+      return result;
+    }
+
+    Compiler::Compiler(Program &program, Function &function, bool is_method)
+        : program_(program)
+        , function_(function)
+        , is_method_(is_method)
+        , next_register_(function.local_count) {
+      function_.register_count = std::max(function_.register_count, next_register_);
+    }
+
+    void Compiler::CompileMethods(const runtime::Class &cls) {
+      for (const auto &method: cls.GetMethods()) {
+        const auto *body = dynamic_cast<const ast::MethodBody *>(method.body.get());
+        // Методы без кадра вызова (frame_size == 0) исполняет только обход дерева
+        if (body == nullptr || method.frame_size == 0 || program_.methods.count(&method) > 0) {
+          continue;
+        }
+        auto function = std::make_unique<Function>();
+        function->name = cls.GetName() + "."s + method.name.GetText();
+        function->local_count = static_cast<std::uint32_t>(method.frame_size);
+        function->argument_count = static_cast<std::uint32_t>(method.formal_params.size());
+        try {
+          Compiler compiler(program_, *function, true);
+          compiler.CompileFunction(*body);
+        } catch (const CompileError &) {
+          continue;
+        }
+        program_.methods.emplace(&method, std::move(function));
+      }
+    }
+
+    void Compiler::CompileFunction(const ast::Statement &body) {
+      CompileStatement(body);
+      Emit(OpCode::ReturnNone);
+    }
+
+    void Compiler::CompileStatement(const ast::Statement &node) {
+      const Register mark = next_register_;
+      if (const auto *compound = NodeAs<ast::Compound>(node)) {
+        for (const auto &statement: compound->statements_) {
+          CompileStatement(*statement);
+        }
+      } else if (const auto *method_body = NodeAs<ast::MethodBody>(node)) {
+        CompileStatement(*method_body->body_);
+      } else if (const auto *ret = NodeAs<ast::Return>(node)) {
+        if (const auto *tail_call = NodeAs<ast::TailCall>(*ret->statement_); tail_call != nullptr && is_method_) {
+          CompileTailCall(*tail_call);
+        }
+        Emit(OpCode::Return, CompileOperand(*ret->statement_));
+      } else if (const auto *if_else = NodeAs<ast::IfElse>(node)) {
+        const Register condition = CompileOperand(*if_else->condition_);
+        const auto jump_to_else = Emit(OpCode::JumpIfFalse, condition);
+        next_register_ = mark;
+        CompileStatement(*if_else->if_body_);
+        if (if_else->else_body_) {
+          const auto jump_to_end = Emit(OpCode::Jump);
+          PatchJump(jump_to_else, Here());
+          CompileStatement(*if_else->else_body_);
+          PatchJump(jump_to_end, Here());
+        } else {
+          PatchJump(jump_to_else, Here());
+        }
+      } else if (const auto *assignment = NodeAs<ast::Assignment>(node)) {
+        const Register value = AllocateRegister();
+        CompileExpression(*assignment->rv_, value);
+        if (is_method_ && assignment->slot_ != runtime::Frame::NO_SLOT) {
+          Emit(OpCode::Move, static_cast<Register>(assignment->slot_), value);
+        } else {
+          Emit(OpCode::StoreName, AddName(assignment->var_), value);
+        }
+      } else if (const auto *field_assignment = NodeAs<ast::FieldAssignment>(node)) {
+        const Register object = AllocateRegister();
+        CompileVariable(field_assignment->object_, object);
+        Emit(OpCode::CheckInstance, object);
+        const Register value = CompileOperand(*field_assignment->rv_);
+        Emit(OpCode::SetField, object, AddName(field_assignment->field_name_), value, AddFieldCache());
+      } else if (const auto *class_definition = NodeAs<ast::ClassDefinition>(node)) {
+        const auto &cls = class_definition->cls_.As<runtime::Class>();
+        Emit(OpCode::DefineClass, AddConstant(class_definition->cls_), AddName(cls.GetName()));
+        CompileMethods(cls);
+      } else if (const auto *scope = NodeAs<ast::StackScope>(node)) {
+        const Register region_mark = AllocateRegister();
+        Emit(OpCode::RegionMark, region_mark);
+        region_marks_.push_back(region_mark);
+        CompileStatement(*scope->body_);
+        region_marks_.pop_back();
+        Emit(OpCode::RegionRelease, region_mark);
+      } else if (const auto *while_loop = NodeAs<ast::While>(node)) {
+        const auto start = Here();
+        const Register condition = CompileOperand(*while_loop->condition_);
+        const auto jump_to_end = Emit(OpCode::JumpIfFalse, condition);
+        next_register_ = mark;
+        CompileLoopBody(*while_loop->body_, start);
+        Emit(OpCode::Jump, start);
+        PatchJump(jump_to_end, Here());
+        EndLoop();
+      } else if (const auto *for_loop = NodeAs<ast::ForRange>(node)) {
+        // Счётчик и граница диапазона занимают регистры до конца цикла
+        const Register counter = AllocateRegister();
+        const Register end = AllocateRegister();
+        CompileExpression(*for_loop->begin_, counter);
+        CompileExpression(*for_loop->end_, end);
+        Emit(OpCode::RangeCheck, counter, end);
+        const auto start = Here();
+        const auto jump_to_end = Emit(OpCode::ForRange, counter, 0, end);
+        if (is_method_ && for_loop->slot_ != runtime::Frame::NO_SLOT) {
+          Emit(OpCode::Move, static_cast<Register>(for_loop->slot_), counter);
+        } else {
+          Emit(OpCode::StoreName, AddName(for_loop->var_), counter);
+        }
+        CompileLoopBody(*for_loop->body_, std::nullopt);
+        Emit(OpCode::Increment, counter);
+        Emit(OpCode::Jump, start);
+        PatchJump(jump_to_end, Here());
+        EndLoop();
+      } else if (const auto *for_each = NodeAs<ast::ForEach>(node)) {
+        // Список и индекс очередного элемента занимают соседние регистры до конца цикла
+        const Register list = AllocateRegister();
+        const Register counter = AllocateRegister();
+        const Register item = AllocateRegister();
+        CompileExpression(*for_each->iterable_, list);
+        Emit(OpCode::LoadConst, counter, AddConstant(runtime::ObjectHolder::Own(runtime::Number(0))));
+        const auto start = Here();
+        const auto jump_to_end = Emit(OpCode::ForEach, list, 0, item);
+        if (is_method_ && for_each->slot_ != runtime::Frame::NO_SLOT) {
+          Emit(OpCode::Move, static_cast<Register>(for_each->slot_), item);
+        } else {
+          Emit(OpCode::StoreName, AddName(for_each->var_), item);
+        }
+        CompileLoopBody(*for_each->body_, start);
+        Emit(OpCode::Jump, start);
+        PatchJump(jump_to_end, Here());
+        EndLoop();
+      } else if (const auto *index_assignment = NodeAs<ast::IndexAssignment>(node)) {
+        const Register object = CompileOperand(*index_assignment->object_);
+        const Register index = CompileOperand(*index_assignment->index_);
+        const Register value = CompileOperand(*index_assignment->rv_);
+        Emit(OpCode::SetItem, object, index, value);
+      } else if (NodeAs<ast::Break>(node) != nullptr) {
+        CompileLoopExit(true);
+      } else if (NodeAs<ast::Continue>(node) != nullptr) {
+        CompileLoopExit(false);
+      } else if (const auto *print = NodeAs<ast::Print>(node)) {
+        bool first_arg = true;
+        for (const auto &arg: print->args_) {
+          if (!first_arg) {
+            Emit(OpCode::WriteSpace);
+          }
+          first_arg = false;
+          Emit(OpCode::Write, CompileOperand(*arg));
+          next_register_ = mark;
+        }
+        Emit(OpCode::WriteNewline);
+      } else {
+        CompileExpression(node, AllocateRegister());
+      }
+      next_register_ = mark;
+    }
+
+    void Compiler::CompileExpression(const ast::Statement &node, Register dst) {
+      const Register mark = next_register_;
+      if (const auto *number = NodeAs<ast::NumericConst>(node)) {
+        Emit(OpCode::LoadConst, dst, AddConstant(runtime::ObjectHolder::Own(runtime::Number(number->value_))));
+      } else if (const auto *str = NodeAs<ast::StringConst>(node)) {
+        Emit(OpCode::LoadConst, dst,
+             AddConstant(runtime::ObjectHolder::Share(const_cast<runtime::String &>(str->value_))));
+      } else if (const auto *boolean = NodeAs<ast::BoolConst>(node)) {
+        Emit(boolean->value_.GetValue() ? OpCode::LoadTrue : OpCode::LoadFalse, dst);
+      } else if (NodeAs<ast::None>(node) != nullptr) {
+        Emit(OpCode::LoadNone, dst);
+      } else if (const auto *variable = NodeAs<ast::VariableValue>(node)) {
+        CompileVariable(*variable, dst);
+      } else if (const auto *method_call = NodeAs<ast::MethodCall>(node)) {
+        CompileMethodCall(*method_call, dst);
+      } else if (const auto *new_instance = NodeAs<ast::NewInstance>(node)) {
+        CompileNewInstance(*new_instance, dst);
+      } else if (const auto *scope = NodeAs<ast::StackScope>(node)) {
+        const Register region_mark = AllocateRegister();
+        Emit(OpCode::RegionMark, region_mark);
+        region_marks_.push_back(region_mark);
+        CompileExpression(*scope->body_, dst);
+        region_marks_.pop_back();
+        Emit(OpCode::RegionRelease, region_mark);
+      } else if (const auto *stringify = NodeAs<ast::Stringify>(node)) {
+        Emit(OpCode::Stringify, dst, CompileOperand(*stringify->argument_), stringify->in_stack_region_ ? 1 : 0);
+      } else if (const auto *negate = NodeAs<ast::Negate>(node)) {
+        if (!negate->argument_) {
+          throw CompileError("null operands are not supported"s);
+        }
+        Emit(OpCode::Negate, dst, CompileOperand(*negate->argument_));
+      } else if (const auto *length = NodeAs<ast::Length>(node)) {
+        Emit(OpCode::Length, dst, CompileOperand(*length->argument_));
+      } else if (const auto *list = NodeAs<ast::ListLiteral>(node)) {
+        const Register first = next_register_;
+        for (std::size_t i = 0; i < list->items_.size(); ++i) {
+          AllocateRegister();
+        }
+        for (std::size_t i = 0; i < list->items_.size(); ++i) {
+          CompileExpression(*list->items_[i], first + static_cast<Register>(i));
+        }
+        Emit(OpCode::NewList, dst, first, static_cast<std::uint32_t>(list->items_.size()));
+      } else if (const auto *dict = NodeAs<ast::DictLiteral>(node)) {
+        // Ключи и значения занимают соседние регистры попарно
+        const Register first = next_register_;
+        for (std::size_t i = 0; i < dict->keys_.size() * 2; ++i) {
+          AllocateRegister();
+        }
+        for (std::size_t i = 0; i < dict->keys_.size(); ++i) {
+          CompileExpression(*dict->keys_[i], first + static_cast<Register>(2 * i));
+          CompileExpression(*dict->values_[i], first + static_cast<Register>(2 * i + 1));
+        }
+        Emit(OpCode::NewDict, dst, first, static_cast<std::uint32_t>(dict->keys_.size()));
+      } else if (const auto *contains = NodeAs<ast::Contains>(node)) {
+        const Register item = CompileOperand(*contains->lhs_);
+        Emit(OpCode::Contains, dst, item, CompileOperand(*contains->rhs_));
+      } else if (const auto *index = NodeAs<ast::Index>(node)) {
+        const Register object = CompileOperand(*index->object_);
+        Emit(OpCode::GetItem, dst, object, CompileOperand(*index->index_));
+      } else if (const auto *not_node = NodeAs<ast::Not>(node)) {
+        if (!not_node->argument_) {
+          throw CompileError("null operands are not supported"s);
+        }
+        Emit(OpCode::Not, dst, CompileOperand(*not_node->argument_));
+      } else if (const auto *or_node = NodeAs<ast::Or>(node)) {
+        CompileLogical(*or_node, true, dst);
+      } else if (const auto *and_node = NodeAs<ast::And>(node)) {
+        CompileLogical(*and_node, false, dst);
+      } else if (!TryCompileBinary(node, dst)) {
+        throw CompileError("unsupported statement"s);
+      }
+      next_register_ = mark;
+    }
+
+    Register Compiler::CompileOperand(const ast::Statement &node) {
+      if (const auto *variable = NodeAs<ast::VariableValue>(node);
+          variable != nullptr && inline_base_ && variable->dotted_ids_.size() == 1) {
+        return *inline_base_ + static_cast<Register>(variable->slot_);
+      }
+      // self и параметры метода всегда имеют значение, поэтому используются без копирования
+      if (const auto *variable = NodeAs<ast::VariableValue>(node);
+          variable != nullptr && is_method_ && variable->dotted_ids_.size() == 1
+          && variable->slot_ <= function_.argument_count) {
+        return static_cast<Register>(variable->slot_);
+      }
+      const Register result = AllocateRegister();
+      CompileExpression(node, result);
+      return result;
+    }
+
+    void Compiler::CompileVariable(const ast::VariableValue &node, Register dst) {
+      const auto &ids = node.dotted_ids_;
+      if (inline_base_) {
+        Emit(OpCode::Move, dst, *inline_base_ + static_cast<Register>(node.slot_));
+      } else if (is_method_ && node.slot_ != runtime::Frame::NO_SLOT) {
+        const auto slot = static_cast<Register>(node.slot_);
+        Emit(slot <= function_.argument_count ? OpCode::Move : OpCode::LoadLocal, dst, slot);
+      } else {
+        Emit(OpCode::LoadName, dst, AddName(ids.front()));
+      }
+      for (std::size_t i = 1; i < ids.size(); ++i) {
+        Emit(OpCode::GetField, dst, dst, AddName(ids[i]), AddFieldCache());
+      }
+    }
+
+    void Compiler::CompileMethodCall(const ast::MethodCall &node, Register dst) {
+      // Объект и аргументы располагаются в соседних регистрах
+      const Register object = AllocateRegister();
+      for (std::size_t i = 0; i < node.args_.size(); ++i) {
+        AllocateRegister();
+      }
+      CompileExpression(*node.object_, object);
+      std::optional<std::uint32_t> jump_to_end;
+      if (const auto *inlined_call = NodeAs<ast::InlinedCall>(node)) {
+        // Подставленное тело выполняется, если проверка метода прошла, иначе - обычный вызов
+        const auto &inlined = inlined_call->inlined_;
+        const auto guard = static_cast<std::uint32_t>(function_.inline_guards.size());
+        function_.inline_guards.push_back({node.selector_, inlined.method});
+        const auto jump_to_call = Emit(OpCode::GuardMethod, object, 0, guard);
+        for (std::size_t i = 0; i < node.args_.size(); ++i) {
+          CompileExpression(*node.args_[i], object + 1 + static_cast<Register>(i));
+        }
+        CompileInlined(inlined, object, dst);
+        jump_to_end = Emit(OpCode::Jump);
+        PatchJump(jump_to_call, Here());
+      }
+      const auto site = static_cast<std::uint32_t>(function_.call_sites.size());
+      function_.call_sites.push_back({node.selector_, static_cast<std::uint32_t>(node.args_.size()), {}});
+      const auto prepare = Emit(OpCode::PrepareCall, dst, object, site);
+      for (std::size_t i = 0; i < node.args_.size(); ++i) {
+        CompileExpression(*node.args_[i], object + 1 + static_cast<Register>(i));
+      }
+      Emit(OpCode::Call, dst, object, site);
+      function_.code[prepare].d = Here();
+      if (jump_to_end) {
+        PatchJump(*jump_to_end, Here());
+      }
+    }
+
+    void Compiler::CompileLoopBody(const ast::Statement &body, std::optional<std::uint32_t> continue_target) {
+      loops_.push_back({{}, {}, region_marks_.size()});
+      CompileStatement(body);
+      const auto target = continue_target ? *continue_target : Here();
+      for (const auto jump: loops_.back().continues) {
+        PatchJump(jump, target);
+      }
+    }
+
+    void Compiler::EndLoop() {
+      for (const auto jump: loops_.back().breaks) {
+        PatchJump(jump, Here());
+      }
+      loops_.pop_back();
+    }
+
+    void Compiler::CompileLoopExit(bool is_break) {
+      if (loops_.empty()) {
+        throw CompileError(is_break ? "break outside loop"s : "continue outside loop"s);
+      }
+      auto &loop = loops_.back();
+      if (region_marks_.size() > loop.region_depth) {
+        Emit(OpCode::RegionRelease, region_marks_[loop.region_depth]);
+      }
+      (is_break ? loop.breaks : loop.continues).push_back(Emit(OpCode::Jump));
+    }
+
+    void Compiler::CompileTailCall(const ast::TailCall &node) {
+      const Register mark = next_register_;
+      const Register object = AllocateRegister();
+      for (std::size_t i = 0; i < node.args_.size(); ++i) {
+        AllocateRegister();
+      }
+      CompileExpression(*node.object_, object);
+      const auto guard = static_cast<std::uint32_t>(function_.inline_guards.size());
+      function_.inline_guards.push_back({node.selector_, node.callee_});
+      const auto jump_to_call = Emit(OpCode::GuardMethod, object, 0, guard);
+      for (std::size_t i = 0; i < node.args_.size(); ++i) {
+        CompileExpression(*node.args_[i], object + 1 + static_cast<Register>(i));
+      }
+      Emit(OpCode::TailCall, object);
+      // Если проверка не прошла, метод вызывается обычным образом
+      PatchJump(jump_to_call, Here());
+      next_register_ = mark;
+    }
+
+    void Compiler::CompileNewInstance(const ast::NewInstance &node, Register dst) {
+      auto &instance = const_cast<runtime::ClassInstance &>(node.cls_);
+      // Для подставленного __init__ перед аргументами располагается self
+      const Register self = node.init_.body ? AllocateRegister() : next_register_;
+      const Register first_arg = next_register_;
+      for (std::size_t i = 0; i < node.args_.size(); ++i) {
+        AllocateRegister();
+      }
+      for (std::size_t i = 0; i < node.args_.size(); ++i) {
+        CompileExpression(*node.args_[i], first_arg + static_cast<Register>(i));
+      }
+      const auto argument_count = static_cast<std::uint32_t>(node.args_.size());
+      const runtime::Method *init = nullptr;
+      if (node.init_.body) {
+        Emit(OpCode::LoadConst, self, AddConstant(runtime::ObjectHolder::Share(instance)));
+        CompileInlined(node.init_, self, AllocateRegister());
+      } else {
+        init = instance.FindMethod(INIT_METHOD, argument_count);
+      }
+      const auto site = static_cast<std::uint32_t>(function_.new_sites.size());
+      function_.new_sites.push_back({&instance, argument_count, init});
+      Emit(OpCode::New, dst, first_arg, site, node.in_stack_region_ ? 1 : 0);
+    }
+
+    void Compiler::CompileInlined(const ast::InlinedMethod &inlined, Register base, Register dst) {
+      const auto saved_base = inline_base_;
+      inline_base_ = base;
+      // Тело из присваиваний полям возвращает None, иначе тело - возвращаемое выражение
+      if (NodeAs<ast::Compound>(*inlined.body) != nullptr) {
+        CompileStatement(*inlined.body);
+        Emit(OpCode::LoadNone, dst);
+      } else {
+        CompileExpression(*inlined.body, dst);
+      }
+      inline_base_ = saved_base;
+    }
+
+    void Compiler::CompileLogical(const ast::BinaryOperation &node, bool is_or, Register dst) {
+      if (!node.lhs_ || !node.rhs_) {
+        throw CompileError("null operands are not supported"s);
+      }
+      // Or: если хотя бы один операнд истинен - True, иначе False. And - наоборот
+      const OpCode short_circuit = is_or ? OpCode::JumpIfTrue : OpCode::JumpIfFalse;
+      const auto lhs_jump = Emit(short_circuit, CompileOperand(*node.lhs_));
+      const auto rhs_jump = Emit(short_circuit, CompileOperand(*node.rhs_));
+      Emit(is_or ? OpCode::LoadFalse : OpCode::LoadTrue, dst);
+      const auto jump_to_end = Emit(OpCode::Jump);
+      PatchJump(lhs_jump, Here());
+      PatchJump(rhs_jump, Here());
+      Emit(is_or ? OpCode::LoadTrue : OpCode::LoadFalse, dst);
+      PatchJump(jump_to_end, Here());
+    }
+
+    bool Compiler::TryCompileBinary(const ast::Statement &node, Register dst) {
+      const auto *binary = NodeAs<ast::BinaryOperation>(node);
+      if (binary == nullptr) {
+        return false;
+      }
+      OpCode op;
+      std::uint32_t caches = 0;
+      if (const auto *add = NodeAs<ast::Add>(node)) {
+        op = add->in_stack_region_ ? OpCode::Concat : OpCode::Add;
+        caches = AddCaches(1);
+      } else if (NodeAs<ast::Sub>(node) != nullptr) {
+        op = OpCode::Sub;
+      } else if (NodeAs<ast::Mult>(node) != nullptr) {
+        op = OpCode::Mult;
+      } else if (NodeAs<ast::Div>(node) != nullptr) {
+        op = OpCode::Div;
+      } else {
+        using ast::Comparator;
+        if (IsComparison<Comparator::Equal>(node)) {
+          op = OpCode::Equal;
+        } else if (IsComparison<Comparator::NotEqual>(node)) {
+          op = OpCode::NotEqual;
+        } else if (IsComparison<Comparator::Less>(node)) {
+          op = OpCode::Less;
+        } else if (IsComparison<Comparator::Greater>(node)) {
+          op = OpCode::Greater;
+        } else if (IsComparison<Comparator::LessOrEqual>(node)) {
+          op = OpCode::LessOrEqual;
+        } else if (IsComparison<Comparator::GreaterOrEqual>(node)) {
+          op = OpCode::GreaterOrEqual;
+        } else {
+          return false;
+        }
+        caches = AddCaches(2);
+      }
+      if (!binary->lhs_ || !binary->rhs_) {
+        throw CompileError("null operands are not supported"s);
+      }
+      const Register mark = next_register_;
+      const Register lhs = CompileOperand(*binary->lhs_);
+      const Register rhs = CompileOperand(*binary->rhs_);
+      const std::uint32_t index = Emit(op, dst, lhs, rhs, caches);
+      // Регистры параметров и переменных подставленных методов выделены до mark
+      function_.code[index].temporary_b = (op == OpCode::Add || op == OpCode::Concat) && lhs >= mark;
+      return true;
+    }
+
+    Register Compiler::AllocateRegister() {
+      const Register result = next_register_++;
+      function_.register_count = std::max(function_.register_count, next_register_);
+      return result;
+    }
+
+    std::uint32_t Compiler::Emit(OpCode op, std::uint32_t a, std::uint32_t b, std::uint32_t c, std::uint32_t d) {
+      function_.code.push_back({op, false, a, b, c, d});
+      return static_cast<std::uint32_t>(function_.code.size() - 1);
+    }
+
+    std::uint32_t Compiler::Here() const {
+      return static_cast<std::uint32_t>(function_.code.size());
+    }
+
+    void Compiler::PatchJump(std::uint32_t instruction, std::uint32_t target) {
+      auto &jump = function_.code[instruction];
+      if (jump.op == OpCode::Jump) {
+        jump.a = target;
+      } else {
+        jump.b = target;
+      }
+    }
+
+    std::uint32_t Compiler::AddConstant(runtime::ObjectHolder value) {
+      function_.constants.push_back(std::move(value));
+      return static_cast<std::uint32_t>(function_.constants.size() - 1);
+    }
+
+    std::uint32_t Compiler::AddName(runtime::Symbol name) {
+      auto &names = function_.names;
+      const auto it = std::find(names.begin(), names.end(), name);
+      if (it != names.end()) {
+        return static_cast<std::uint32_t>(it - names.begin());
+      }
+      names.push_back(name);
+      return static_cast<std::uint32_t>(names.size() - 1);
+    }
+
+    std::uint32_t Compiler::AddCaches(std::size_t count) {
+      const auto first = static_cast<std::uint32_t>(function_.caches.size());
+      function_.caches.resize(function_.caches.size() + count);
+      return first;
+    }
+
+    std::uint32_t Compiler::AddFieldCache() {
+      function_.field_caches.emplace_back();
+      return static_cast<std::uint32_t>(function_.field_caches.size() - 1);
+    }
+
+  }  // namespace vm
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "bytecode.h"
+#include "statement.h"
+
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace vm
+  {
+
+// Ошибка компиляции: дерево разбора содержит узлы, которые не поддерживаются виртуальной машиной
+    class CompileError
+        : public std::runtime_error {
+     public:
+      using std::runtime_error::runtime_error;
+    };
+
+// Компилирует дерево разбора в байт-код регистровой виртуальной машины
+    class Compiler {
+     public:
+      // Компилирует программу верхнего уровня и методы объявленных в ней классов.
+      // Методы, тела которых не удалось скомпилировать, исполняются обходом дерева.
+      // Если не удалось скомпилировать саму программу, выбрасывает CompileError
+      static std::unique_ptr<Program> Compile(const ast::Statement &program);
+
+     private:
+      Compiler(Program &program, Function &function, bool is_method);
+
+      void CompileMethods(const runtime::Class &cls);
+      void CompileFunction(const ast::Statement &body);
+
+      void CompileStatement(const ast::Statement &node);
+      void CompileExpression(const ast::Statement &node, Register dst);
+      // Возвращает регистр со значением node: слот параметра метода либо временный регистр
+      Register CompileOperand(const ast::Statement &node);
+
+      void CompileVariable(const ast::VariableValue &node, Register dst);
+      void CompileMethodCall(const ast::MethodCall &node, Register dst);
+      // Компилирует return self.method(...) в переход на начало функции (см. ast::TailCall)
+      void CompileTailCall(const ast::TailCall &node);
+      void CompileNewInstance(const ast::NewInstance &node, Register dst);
+      // Компилирует подставленное тело метода. self и аргументы находятся в регистрах base, base + 1, ...
+      void CompileInlined(const ast::InlinedMethod &inlined, Register base, Register dst);
+      // Компилирует тело цикла. Переходы continue ведут на continue_target либо, если он не задан,
+      // на инструкцию после тела; переходы break заполняет EndLoop
+      void CompileLoopBody(const ast::Statement &body, std::optional<std::uint32_t> continue_target);
+      // Направляет переходы break последнего скомпилированного цикла на текущую инструкцию
+      void EndLoop();
+      // Компилирует break либо continue: освобождает временные значения StackScope внутри цикла
+      void CompileLoopExit(bool is_break);
+      void CompileLogical(const ast::BinaryOperation &node, bool is_or, Register dst);
+      bool TryCompileBinary(const ast::Statement &node, Register dst);
+
+      Register AllocateRegister();
+      std::uint32_t Emit(OpCode op, std::uint32_t a = 0, std::uint32_t b = 0, std::uint32_t c = 0,
+                         std::uint32_t d = 0);
+      [[nodiscard]] std::uint32_t Here() const;
+      void PatchJump(std::uint32_t instruction, std::uint32_t target);
+      std::uint32_t AddConstant(runtime::ObjectHolder value);
+      std::uint32_t AddName(runtime::Symbol name);
+      std::uint32_t AddCaches(std::size_t count);
+      std::uint32_t AddFieldCache();
+
+      Program &program_;
+      Function &function_;
+      bool is_method_;
+      Register next_register_ = 0;
+      // Регистр self подставленного метода, который компилируется сейчас: слоты его переменных
+      // отсчитываются от этого регистра
+      std::optional<Register> inline_base_;
+
+      struct Loop {
+        std::vector<std::uint32_t> breaks;
+        std::vector<std::uint32_t> continues;
+        // Число StackScope, объемлющих цикл
+        std::size_t region_depth = 0;
+      };
+
+      // Компилируемые циклы, начиная с внешнего
+      std::vector<Loop> loops_;
+      // Регистры границ STACK_REGION компилируемых StackScope
+      std::vector<Register> region_marks_;
+    };
+
+  }  // namespace vm
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace runtime
+  {
+
+/*
+ * Хеш-таблица с открытой адресацией, отображающая ключи Key на значения Value (схема SwissTable).
+ * Каждому слоту соответствует управляющий байт: EMPTY для свободного слота либо 7 младших битов
+ * хеша (H2) для занятого. Управляющие байты сгруппированы по GROUP_SIZE, поиск проверяет группу
+ * целиком: одно SIMD-сравнение находит слоты с совпадающим H2, и только их ключи сравниваются с искомым.
+ * Старшие биты хеша (H1) выбирают начальную группу, следующие группы перебираются квадратичным
+ * пробированием. Значения хранятся в плоском массиве слотов без отдельного выделения памяти на запись.
+ *
+ * Ключи хешируются std::hash<Key>. У ключей-символов (см. Symbol) хеш вычислен при интернировании,
+ * и сравниваются они по указателю, поэтому поиск имени не обращается к тексту.
+ * Удаление отдельных ключей не поддерживается: таблицы имён только растут, clear очищает таблицу целиком.
+ * Итераторы и ссылки на значения становятся недействительными при добавлении ключа
+ */
+    template<typename Key, typename Value>
+    class FlatHashMap {
+     public:
+      using key_type = Key;
+      using mapped_type = Value;
+      using value_type = std::pair<const Key, Value>;
+
+      static constexpr std::size_t GROUP_SIZE = 16;
+
+      template<bool Const>
+      class Iterator {
+        using Map = std::conditional_t<Const, const FlatHashMap, FlatHashMap>;
+
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const value_type *, value_type *>;
+        using reference = std::conditional_t<Const, const value_type &, value_type &>;
+
+        Iterator() = default;
+
+        Iterator(Map *map, std::size_t index)
+            : map_(map)
+            , index_(index) {
+          SkipEmpty();
+        }
+
+        // Неконстантный итератор приводится к константному
+        template<bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+        Iterator(const Iterator<OtherConst> &other)  // NOLINT(google-explicit-constructor)
+            : map_(other.map_)
+            , index_(other.index_) {
+        }
+
+        reference operator*() const {
+          return map_->Slot(index_);
+        }
+
+        pointer operator->() const {
+          return &map_->Slot(index_);
+        }
+
+        Iterator &operator++() {
+          ++index_;
+          SkipEmpty();
+          return *this;
+        }
+
+        bool operator==(const Iterator &other) const {
+          return index_ == other.index_;
+        }
+
+        bool operator!=(const Iterator &other) const {
+          return index_ != other.index_;
+        }
+
+       private:
+        friend class FlatHashMap;
+        template<bool>
+        friend class Iterator;
+
+        void SkipEmpty() {
+          while (index_ < map_->capacity_ && map_->ctrl_[index_] == EMPTY) {
+            ++index_;
+          }
+        }
+
+        Map *map_ = nullptr;
+        std::size_t index_ = 0;
+      };
+
+      using iterator = Iterator<false>;
+      using const_iterator = Iterator<true>;
+
+      FlatHashMap() = default;
+
+      FlatHashMap(std::initializer_list<value_type> values) {
+        for (const auto &value: values) {
+          insert(value);
+        }
+      }
+
+      FlatHashMap(const FlatHashMap &other) {
+        CopyFrom(other);
+      }
+
+      FlatHashMap(FlatHashMap &&other) noexcept {
+        Swap(other);
+      }
+
+      FlatHashMap &operator=(const FlatHashMap &other) {
+        if (this != &other) {
+          FlatHashMap copy(other);
+          Swap(copy);
+        }
+        return *this;
+      }
+
+      FlatHashMap &operator=(FlatHashMap &&other) noexcept {
+        if (this != &other) {
+          FlatHashMap moved(std::move(other));
+          Swap(moved);
+        }
+        return *this;
+      }
+
+      ~FlatHashMap() {
+        DestroySlots();
+      }
+
+      [[nodiscard]] std::size_t size() const {
+        return size_;
+      }
+
+      [[nodiscard]] bool empty() const {
+        return size_ == 0;
+      }
+
+      void clear() {
+        DestroySlots();
+        groups_.clear();
+        slots_.reset();
+        ctrl_ = nullptr;
+        capacity_ = 0;
+        size_ = 0;
+      }
+
+      iterator begin() {
+        return {this, 0};
+      }
+
+      iterator end() {
+        return {this, capacity_};
+      }
+
+      const_iterator begin() const {
+        return {this, 0};
+      }
+
+      const_iterator end() const {
+        return {this, capacity_};
+      }
+
+      iterator find(const Key &key) {
+        return {this, FindIndex(key)};
+      }
+
+      const_iterator find(const Key &key) const {
+        return {this, FindIndex(key)};
+      }
+
+      [[nodiscard]] std::size_t count(const Key &key) const {
+        return FindIndex(key) != capacity_ ? 1 : 0;
+      }
+
+      // Возвращает значение ключа key. Если ключа нет, выбрасывает out_of_range
+      Value &at(const Key &key) {
+        const std::size_t index = FindIndex(key);
+        if (index == capacity_) {
+          throw std::out_of_range("FlatHashMap::at: no such key");
+        }
+        return Slot(index).second;
+      }
+
+      const Value &at(const Key &key) const {
+        return const_cast<FlatHashMap &>(*this).at(key);
+      }
+
+      // Возвращает значение ключа key, добавляя значение по умолчанию при отсутствии ключа
+      Value &operator[](const Key &key) {
+        return emplace(key).first->second;
+      }
+
+      // Добавляет ключ key со значением, созданным из args, если такого ключа ещё нет
+      template<typename... Args>
+      std::pair<iterator, bool> emplace(const Key &key, Args &&... args) {
+        const std::size_t hash = Hash(key);
+        if (const std::size_t index = FindIndex(key, hash); index != capacity_) {
+          return {iterator{this, index}, false};
+        }
+        // Заполненность таблицы не превышает 7/8
+        if ((size_ + 1) * 8 > capacity_ * 7) {
+          Rehash(capacity_ == 0 ? GROUP_SIZE : capacity_ * 2);
+        }
+        const std::size_t index = FindEmpty(hash);
+        new(&slots_[index]) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                                       std::forward_as_tuple(std::forward<Args>(args)...));
+        ctrl_[index] = H2(hash);
+        ++size_;
+        return {iterator{this, index}, true};
+      }
+
+      std::pair<iterator, bool> insert(const value_type &value) {
+        return emplace(value.first, value.second);
+      }
+
+      std::pair<iterator, bool> insert(value_type &&value) {
+        return emplace(value.first, std::move(value.second));
+      }
+
+     private:
+      static constexpr std::int8_t EMPTY = -128;
+
+      struct alignas(GROUP_SIZE) Group {
+        std::int8_t ctrl[GROUP_SIZE];
+      };
+
+      using Storage = std::aligned_storage_t<sizeof(value_type), alignof(value_type)>;
+
+      static std::size_t Hash(const Key &key) {
+        return std::hash<Key>{}(key);
+      }
+
+      static std::size_t H1(std::size_t hash) {
+        return hash >> 7;
+      }
+
+      static std::int8_t H2(std::size_t hash) {
+        return static_cast<std::int8_t>(hash & 0x7F);
+      }
+
+      // Биты маски - слоты группы, управляющий байт которых равен value
+      static std::uint32_t Match(const std::int8_t *group, std::int8_t value) {
+#if defined(__SSE2__)
+        const __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i *>(group));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value))));
+#else
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < GROUP_SIZE; ++i) {
+          mask |= static_cast<std::uint32_t>(group[i] == value) << i;
+        }
+        return mask;
+#endif
+      }
+
+      static int LowestBit(std::uint32_t mask) {
+        return __builtin_ctz(mask);
+      }
+
+      value_type &Slot(std::size_t index) {
+        return *std::launder(reinterpret_cast<value_type *>(&slots_[index]));
+      }
+
+      const value_type &Slot(std::size_t index) const {
+        return *std::launder(reinterpret_cast<const value_type *>(&slots_[index]));
+      }
+
+      // Возвращает индекс слота ключа key либо capacity_, если ключа нет
+      [[nodiscard]] std::size_t FindIndex(const Key &key) const {
+        return FindIndex(key, Hash(key));
+      }
+
+      [[nodiscard]] std::size_t FindIndex(const Key &key, std::size_t hash) const {
+        if (capacity_ == 0) {
+          return capacity_;
+        }
+        const std::size_t group_mask = capacity_ / GROUP_SIZE - 1;
+        const std::int8_t h2 = H2(hash);
+        std::size_t group = H1(hash) & group_mask;
+        for (std::size_t step = 1;; ++step) {
+          const std::int8_t *ctrl = ctrl_ + group * GROUP_SIZE;
+          for (std::uint32_t match = Match(ctrl, h2); match != 0; match &= match - 1) {
+            const std::size_t index = group * GROUP_SIZE + static_cast<std::size_t>(LowestBit(match));
+            if (Slot(index).first == key) {
+              return index;
+            }
+          }
+          if (Match(ctrl, EMPTY) != 0) {
+            return capacity_;
+          }
+          group = (group + step) & group_mask;
+        }
+      }
+
+      // Возвращает свободный слот для хеша hash. В таблице должен быть хотя бы один свободный слот
+      [[nodiscard]] std::size_t FindEmpty(std::size_t hash) const {
+        const std::size_t group_mask = capacity_ / GROUP_SIZE - 1;
+        std::size_t group = H1(hash) & group_mask;
+        for (std::size_t step = 1;; ++step) {
+          if (const std::uint32_t empty = Match(ctrl_ + group * GROUP_SIZE, EMPTY); empty != 0) {
+            return group * GROUP_SIZE + static_cast<std::size_t>(LowestBit(empty));
+          }
+          group = (group + step) & group_mask;
+        }
+      }
+
+      void Allocate(std::size_t capacity) {
+        groups_.assign(capacity / GROUP_SIZE, Group{});
+        ctrl_ = groups_.front().ctrl;
+        std::fill(ctrl_, ctrl_ + capacity, EMPTY);
+        slots_ = std::make_unique<Storage[]>(capacity);
+        capacity_ = capacity;
+      }
+
+      void Rehash(std::size_t capacity) {
+        FlatHashMap old;
+        Swap(old);
+        Allocate(capacity);
+        for (std::size_t i = 0; i < old.capacity_; ++i) {
+          if (old.ctrl_[i] != EMPTY) {
+            auto &slot = old.Slot(i);
+            const std::size_t hash = Hash(slot.first);
+            const std::size_t index = FindEmpty(hash);
+            // Старый слот уничтожается сразу после переноса, поэтому ключ перемещается, а не копируется
+            new(&slots_[index]) value_type(std::move(const_cast<Key &>(slot.first)), std::move(slot.second));
+            ctrl_[index] = H2(hash);
+            ++size_;
+          }
+        }
+      }
+
+      void CopyFrom(const FlatHashMap &other) {
+        if (other.capacity_ == 0) {
+          return;
+        }
+        Allocate(other.capacity_);
+        for (std::size_t i = 0; i < capacity_; ++i) {
+          if (other.ctrl_[i] != EMPTY) {
+            new(&slots_[i]) value_type(other.Slot(i));
+            ctrl_[i] = other.ctrl_[i];
+            ++size_;
+          }
+        }
+      }
+
+      void DestroySlots() {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+          if (ctrl_[i] != EMPTY) {
+            Slot(i).~value_type();
+            ctrl_[i] = EMPTY;
+          }
+        }
+        size_ = 0;
+      }
+
+      void Swap(FlatHashMap &other) noexcept {
+        std::swap(groups_, other.groups_);
+        std::swap(slots_, other.slots_);
+        std::swap(ctrl_, other.ctrl_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+      }
+
+      std::vector<Group> groups_;
+      std::unique_ptr<Storage[]> slots_;
+      // Управляющие байты слотов, хранящиеся в groups_
+      std::int8_t *ctrl_ = nullptr;
+      // Число слотов: 0 либо степень двойки, не меньшая GROUP_SIZE
+      std::size_t capacity_ = 0;
+      std::size_t size_ = 0;
+    };
+
+  }  // namespace runtime
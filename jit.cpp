@@ -0,0 +1,497 @@
+#include "jit.h"
+
+#include "statement.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifdef MYTHON_JIT
+#include <sys/mman.h>
+#endif
+
+namespace jit
+  {
+    using namespace std::literals;
+
+    JitStats JIT_STATS;
+
+    namespace
+      {
+        bool ENABLED = true;
+
+        // Наибольшее число параметров компилируемого метода
+        constexpr std::size_t MAX_ARGUMENTS = 8;
+
+        // Тело метода выходит за пределы поддерживаемого подмножества
+        class CompileError
+            : public std::runtime_error {
+         public:
+          using std::runtime_error::runtime_error;
+        };
+
+        template<typename T>
+        const T *NodeAs(const ast::Statement &node) {
+          return dynamic_cast<const T *>(&node);
+        }
+
+#ifdef MYTHON_JIT
+        // Исполняемая память с машинным кодом группы методов
+        class CodeBuffer {
+         public:
+          explicit CodeBuffer(const std::vector<std::uint8_t> &code)
+              : size_(code.size()) {
+            void *memory = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+              throw CompileError("cannot allocate code memory"s);
+            }
+            data_ = static_cast<std::uint8_t *>(memory);
+            std::memcpy(data_, code.data(), size_);
+          }
+
+          CodeBuffer(const CodeBuffer &) = delete;
+          CodeBuffer &operator=(const CodeBuffer &) = delete;
+
+          ~CodeBuffer() {
+            ::munmap(data_, size_);
+          }
+
+          [[nodiscard]] std::uint8_t *Data() const {
+            return data_;
+          }
+
+          // Запрещает запись и разрешает исполнение
+          void MakeExecutable() const {
+            if (::mprotect(data_, size_, PROT_READ | PROT_EXEC) != 0) {
+              throw CompileError("cannot protect code memory"s);
+            }
+          }
+
+          // Буферы методов, которые вызывает машинный код этого буфера
+          std::vector<std::shared_ptr<void>> dependencies;
+
+         private:
+          std::uint8_t *data_ = nullptr;
+          std::size_t size_;
+        };
+#endif
+      }  // namespace
+
+    /*
+     * Компилирует метод и вызываемые им методы self в один буфер машинного кода.
+     *
+     * Соглашение о вызовах скомпилированных методов: rdi - массив значений параметров по 8 байт,
+     * rsi - флаг возврата в интерпретатор, результат - eax. В теле метода rbx хранит массив параметров,
+     * r12 - флаг; промежуточные значения выражений сохраняются в стеке. Значения - 32-битные числа,
+     * арифметика, как и в интерпретаторе, выполняется по модулю 2^32
+     */
+    class Compiler {
+     public:
+      static bool Compile(const runtime::Method &method, const runtime::Class &cls);
+
+     private:
+      enum class Type {
+        Number,
+        Bool,
+      };
+
+      explicit Compiler(const runtime::Class &cls)
+          : cls_(cls) {
+      }
+
+      std::size_t AddFunction(const runtime::Method &method);
+      void CompileFunction(const runtime::Method &method);
+      void CompileStatement(const ast::Statement &node);
+      Type CompileExpression(const ast::Statement &node);
+      void CompileNumber(const ast::Statement &node);
+      void CompileCall(const ast::MethodCall &node);
+      // Компилирует return self.method(...) текущего метода в переход на начало его тела
+      bool TryCompileTailCall(const ast::Statement &node);
+      void CompileBinary(const ast::BinaryOperation &node);
+      void CompileDivision();
+      void EmitBailout();
+
+      void Emit(std::initializer_list<std::uint8_t> bytes);
+      void EmitInt32(std::uint32_t value);
+      void EmitInt64(std::uint64_t value);
+      // Выдаёт переход с 32-битным смещением и возвращает позицию смещения
+      std::size_t EmitJump(std::initializer_list<std::uint8_t> opcode);
+      void PatchJump(std::size_t position, std::size_t target);
+
+      const runtime::Class &cls_;
+      std::vector<std::uint8_t> code_;
+      // Методы группы в порядке компиляции и смещения их машинного кода
+      std::vector<const runtime::Method *> functions_;
+      std::vector<std::size_t> offsets_;
+      std::unordered_map<const runtime::Method *, std::size_t> indices_;
+      // Позиции 64-битных адресов вызываемых методов группы
+      std::vector<std::pair<std::size_t, std::size_t>> call_fixups_;
+      // Буферы уже скомпилированных методов, которые вызывает группа
+      std::vector<std::shared_ptr<void>> dependencies_;
+      // Переходы на эпилог текущего метода
+      std::vector<std::size_t> return_jumps_;
+      // Начало тела текущего метода после пролога
+      std::size_t body_start_ = 0;
+      const runtime::Method *current_ = nullptr;
+    };
+
+    bool Compiler::Compile(const runtime::Method &method, const runtime::Class &cls) {
+#ifdef MYTHON_JIT
+      Compiler compiler(cls);
+      try {
+        compiler.AddFunction(method);
+        for (std::size_t i = 0; i < compiler.functions_.size(); ++i) {
+          compiler.CompileFunction(*compiler.functions_[i]);
+        }
+        auto buffer = std::make_shared<CodeBuffer>(compiler.code_);
+        const auto base = reinterpret_cast<std::uintptr_t>(buffer->Data());
+        for (const auto &[position, function]: compiler.call_fixups_) {
+          const std::uint64_t address = base + compiler.offsets_[function];
+          std::memcpy(buffer->Data() + position, &address, sizeof(address));
+        }
+        buffer->MakeExecutable();
+        buffer->dependencies = std::move(compiler.dependencies_);
+        for (std::size_t i = 0; i < compiler.functions_.size(); ++i) {
+          auto &state = compiler.functions_[i]->jit;
+          state.entry = reinterpret_cast<runtime::MethodJit::Entry>(buffer->Data() + compiler.offsets_[i]);
+          state.class_id = cls.GetId();
+          state.code = buffer;
+        }
+        JIT_STATS.compiled += compiler.functions_.size();
+        return true;
+      } catch (const CompileError &) {
+        method.jit.rejected = true;
+        ++JIT_STATS.rejected;
+        return false;
+      }
+#else
+      (void) cls;
+      method.jit.rejected = true;
+      return false;
+#endif
+    }
+
+    std::size_t Compiler::AddFunction(const runtime::Method &method) {
+      if (const auto it = indices_.find(&method); it != indices_.end()) {
+        return it->second;
+      }
+      if (method.jit.rejected) {
+        throw CompileError("method is not supported"s);
+      }
+      functions_.push_back(&method);
+      indices_.emplace(&method, functions_.size() - 1);
+      return functions_.size() - 1;
+    }
+
+    void Compiler::CompileFunction(const runtime::Method &method) {
+      const auto *body = dynamic_cast<const ast::MethodBody *>(method.body.get());
+      // Локальные переменные не поддерживаются: кадр содержит только self и параметры
+      if (body == nullptr || method.frame_size != method.formal_params.size() + 1
+          || method.formal_params.size() > MAX_ARGUMENTS) {
+        throw CompileError("method is not supported"s);
+      }
+      current_ = &method;
+      offsets_.push_back(code_.size());
+      return_jumps_.clear();
+
+      Emit({0x55});                    // push rbp
+      Emit({0x48, 0x89, 0xE5});        // mov rbp, rsp
+      Emit({0x53});                    // push rbx
+      Emit({0x41, 0x54});              // push r12
+      Emit({0x48, 0x89, 0xFB});        // mov rbx, rdi
+      Emit({0x49, 0x89, 0xF4});        // mov r12, rsi
+      body_start_ = code_.size();
+
+      CompileStatement(*body->body_);
+      // Метод без return возвращает None
+      EmitBailout();
+
+      const auto epilogue = code_.size();
+      for (const auto jump: return_jumps_) {
+        PatchJump(jump, epilogue);
+      }
+      Emit({0x48, 0x8D, 0x65, 0xF0});  // lea rsp, [rbp - 16]
+      Emit({0x41, 0x5C});              // pop r12
+      Emit({0x5B});                    // pop rbx
+      Emit({0x5D});                    // pop rbp
+      Emit({0xC3});                    // ret
+    }
+
+    void Compiler::CompileStatement(const ast::Statement &node) {
+      if (const auto *compound = NodeAs<ast::Compound>(node)) {
+        for (const auto &statement: compound->statements_) {
+          CompileStatement(*statement);
+        }
+      } else if (const auto *if_else = NodeAs<ast::IfElse>(node)) {
+        CompileExpression(*if_else->condition_);
+        Emit({0x85, 0xC0});            // test eax, eax
+        const auto jump_to_else = EmitJump({0x0F, 0x84});  // jz
+        CompileStatement(*if_else->if_body_);
+        if (if_else->else_body_) {
+          const auto jump_to_end = EmitJump({0xE9});       // jmp
+          PatchJump(jump_to_else, code_.size());
+          CompileStatement(*if_else->else_body_);
+          PatchJump(jump_to_end, code_.size());
+        } else {
+          PatchJump(jump_to_else, code_.size());
+        }
+      } else if (const auto *ret = NodeAs<ast::Return>(node)) {
+        if (TryCompileTailCall(*ret->statement_)) {
+          return;
+        }
+        CompileNumber(*ret->statement_);
+        return_jumps_.push_back(EmitJump({0xE9}));        // jmp epilogue
+      } else {
+        CompileExpression(node);
+      }
+    }
+
+    Compiler::Type Compiler::CompileExpression(const ast::Statement &node) {
+      if (const auto *number = NodeAs<ast::NumericConst>(node)) {
+        Emit({0xB8});                  // mov eax, imm32
+        EmitInt32(static_cast<std::uint32_t>(number->value_.GetValue()));
+        return Type::Number;
+      }
+      if (const auto *variable = NodeAs<ast::VariableValue>(node)) {
+        const auto slot = variable->slot_;
+        if (variable->dotted_ids_.size() != 1 || slot == 0 || slot > current_->formal_params.size()) {
+          throw CompileError("unsupported variable"s);
+        }
+        Emit({0x8B, 0x83});            // mov eax, [rbx + disp32]
+        EmitInt32(static_cast<std::uint32_t>((slot - 1) * 8));
+        return Type::Number;
+      }
+      if (const auto *negate = NodeAs<ast::Negate>(node)) {
+        CompileNumber(*negate->argument_);
+        Emit({0xF7, 0xD8});            // neg eax
+        return Type::Number;
+      }
+      if (const auto *call = NodeAs<ast::MethodCall>(node)) {
+        CompileCall(*call);
+        return Type::Number;
+      }
+      if (const auto *binary = NodeAs<ast::BinaryOperation>(node)) {
+        CompileBinary(*binary);
+        return NodeAs<ast::Add>(node) || NodeAs<ast::Sub>(node) || NodeAs<ast::Mult>(node) || NodeAs<ast::Div>(node)
+               ? Type::Number
+               : Type::Bool;
+      }
+      throw CompileError("unsupported expression"s);
+    }
+
+    void Compiler::CompileNumber(const ast::Statement &node) {
+      if (CompileExpression(node) != Type::Number) {
+        throw CompileError("number expected"s);
+      }
+    }
+
+    void Compiler::CompileCall(const ast::MethodCall &node) {
+      const auto *object = NodeAs<ast::VariableValue>(*node.object_);
+      if (object == nullptr || object->dotted_ids_.size() != 1 || object->slot_ != 0) {
+        throw CompileError("only methods of self can be called"s);
+      }
+      const runtime::Method *callee = cls_.GetMethod(node.selector_);
+      if (callee == nullptr || callee->formal_params.size() != node.args_.size()) {
+        throw CompileError("unknown method"s);
+      }
+      const auto frame_size = static_cast<std::uint32_t>(node.args_.size() * 8);
+      Emit({0x48, 0x81, 0xEC});        // sub rsp, imm32
+      EmitInt32(frame_size);
+      for (std::size_t i = 0; i < node.args_.size(); ++i) {
+        CompileNumber(*node.args_[i]);
+        Emit({0x48, 0x89, 0x84, 0x24});  // mov [rsp + disp32], rax
+        EmitInt32(static_cast<std::uint32_t>(i * 8));
+      }
+      Emit({0x48, 0x89, 0xE7});        // mov rdi, rsp
+      Emit({0x4C, 0x89, 0xE6});        // mov rsi, r12
+      Emit({0x48, 0xB8});              // mov rax, imm64
+      if (callee->jit.entry != nullptr && callee->jit.class_id == cls_.GetId() && indices_.count(callee) == 0) {
+        EmitInt64(reinterpret_cast<std::uintptr_t>(callee->jit.entry));
+        dependencies_.push_back(callee->jit.code);
+      } else {
+        call_fixups_.emplace_back(code_.size(), AddFunction(*callee));
+        EmitInt64(0);
+      }
+      Emit({0xFF, 0xD0});              // call rax
+      Emit({0x48, 0x81, 0xC4});        // add rsp, imm32
+      EmitInt32(frame_size);
+      // Если вызванный метод вернулся в интерпретатор, возвращается и этот метод
+      Emit({0x41, 0x83, 0x3C, 0x24, 0x00});  // cmp dword [r12], 0
+      return_jumps_.push_back(EmitJump({0x0F, 0x85}));  // jne epilogue
+    }
+
+    bool Compiler::TryCompileTailCall(const ast::Statement &node) {
+      const auto *call = NodeAs<ast::TailCall>(node);
+      if (call == nullptr || cls_.GetMethod(call->selector_) != current_) {
+        return false;
+      }
+      // Аргументы вычисляются в стек, затем заменяют параметры в массиве rbx
+      const auto frame_size = static_cast<std::uint32_t>(call->args_.size() * 8);
+      Emit({0x48, 0x81, 0xEC});        // sub rsp, imm32
+      EmitInt32(frame_size);
+      for (std::size_t i = 0; i < call->args_.size(); ++i) {
+        CompileNumber(*call->args_[i]);
+        Emit({0x48, 0x89, 0x84, 0x24});  // mov [rsp + disp32], rax
+        EmitInt32(static_cast<std::uint32_t>(i * 8));
+      }
+      for (std::size_t i = 0; i < call->args_.size(); ++i) {
+        Emit({0x48, 0x8B, 0x84, 0x24});  // mov rax, [rsp + disp32]
+        EmitInt32(static_cast<std::uint32_t>(i * 8));
+        Emit({0x48, 0x89, 0x83});        // mov [rbx + disp32], rax
+        EmitInt32(static_cast<std::uint32_t>(i * 8));
+      }
+      Emit({0x48, 0x81, 0xC4});        // add rsp, imm32
+      EmitInt32(frame_size);
+      PatchJump(EmitJump({0xE9}), body_start_);  // jmp body_start
+      return true;
+    }
+
+    void Compiler::CompileBinary(const ast::BinaryOperation &node) {
+      using ast::Comparator;
+      // Код setcc для операций сравнения
+      std::uint8_t setcc = 0;
+      if (NodeAs<ast::Comparison<Comparator::Equal>>(node) != nullptr) {
+        setcc = 0x94;
+      } else if (NodeAs<ast::Comparison<Comparator::NotEqual>>(node) != nullptr) {
+        setcc = 0x95;
+      } else if (NodeAs<ast::Comparison<Comparator::Less>>(node) != nullptr) {
+        setcc = 0x9C;
+      } else if (NodeAs<ast::Comparison<Comparator::GreaterOrEqual>>(node) != nullptr) {
+        setcc = 0x9D;
+      } else if (NodeAs<ast::Comparison<Comparator::LessOrEqual>>(node) != nullptr) {
+        setcc = 0x9E;
+      } else if (NodeAs<ast::Comparison<Comparator::Greater>>(node) != nullptr) {
+        setcc = 0x9F;
+      } else if (NodeAs<ast::Add>(node) == nullptr && NodeAs<ast::Sub>(node) == nullptr
+                 && NodeAs<ast::Mult>(node) == nullptr && NodeAs<ast::Div>(node) == nullptr) {
+        throw CompileError("unsupported operation"s);
+      }
+      if (!node.lhs_ || !node.rhs_) {
+        throw CompileError("null operands are not supported"s);
+      }
+      CompileNumber(*node.lhs_);
+      Emit({0x50});                    // push rax
+      CompileNumber(*node.rhs_);
+      Emit({0x89, 0xC1});              // mov ecx, eax
+      Emit({0x58});                    // pop rax
+      if (setcc != 0) {
+        Emit({0x39, 0xC8});            // cmp eax, ecx
+        Emit({0x0F, setcc, 0xC0});     // setcc al
+        Emit({0x0F, 0xB6, 0xC0});      // movzx eax, al
+      } else if (NodeAs<ast::Add>(node) != nullptr) {
+        Emit({0x01, 0xC8});            // add eax, ecx
+      } else if (NodeAs<ast::Sub>(node) != nullptr) {
+        Emit({0x29, 0xC8});            // sub eax, ecx
+      } else if (NodeAs<ast::Mult>(node) != nullptr) {
+        Emit({0x0F, 0xAF, 0xC1});      // imul eax, ecx
+      } else {
+        CompileDivision();
+      }
+    }
+
+    void Compiler::CompileDivision() {
+      // Деление на 0 выполняет интерпретатор, чтобы выбросить исключение
+      Emit({0x85, 0xC9});              // test ecx, ecx
+      const auto not_zero = EmitJump({0x0F, 0x85});       // jnz
+      EmitBailout();
+      PatchJump(not_zero, code_.size());
+      // idiv для INT_MIN / -1 вызывает исключение процессора, поэтому деление на -1 - смена знака
+      Emit({0x83, 0xF9, 0xFF});        // cmp ecx, -1
+      const auto not_minus_one = EmitJump({0x0F, 0x85});  // jne
+      Emit({0xF7, 0xD8});              // neg eax
+      const auto done = EmitJump({0xE9});                 // jmp
+      PatchJump(not_minus_one, code_.size());
+      Emit({0x99});                    // cdq
+      Emit({0xF7, 0xF9});              // idiv ecx
+      PatchJump(done, code_.size());
+    }
+
+    void Compiler::EmitBailout() {
+      Emit({0x41, 0xC7, 0x04, 0x24});  // mov dword [r12], 1
+      EmitInt32(1);
+      return_jumps_.push_back(EmitJump({0xE9}));          // jmp epilogue
+    }
+
+    void Compiler::Emit(std::initializer_list<std::uint8_t> bytes) {
+      code_.insert(code_.end(), bytes);
+    }
+
+    void Compiler::EmitInt32(std::uint32_t value) {
+      for (int i = 0; i < 4; ++i) {
+        code_.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+      }
+    }
+
+    void Compiler::EmitInt64(std::uint64_t value) {
+      for (int i = 0; i < 8; ++i) {
+        code_.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+      }
+    }
+
+    std::size_t Compiler::EmitJump(std::initializer_list<std::uint8_t> opcode) {
+      Emit(opcode);
+      const auto position = code_.size();
+      EmitInt32(0);
+      return position;
+    }
+
+    void Compiler::PatchJump(std::size_t position, std::size_t target) {
+      const auto offset = static_cast<std::int32_t>(static_cast<std::ptrdiff_t>(target)
+                                                    - static_cast<std::ptrdiff_t>(position + 4));
+      std::memcpy(code_.data() + position, &offset, sizeof(offset));
+    }
+
+    bool IsAvailable() {
+#ifdef MYTHON_JIT
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    void SetEnabled(bool enabled) {
+      ENABLED = enabled;
+    }
+
+    bool IsEnabled() {
+      return ENABLED && IsAvailable();
+    }
+
+    bool Compile(const runtime::Method &method, const runtime::Class &cls) {
+      return Compiler::Compile(method, cls);
+    }
+
+    bool TryCall(const runtime::Method &method, const runtime::ClassInstance &self,
+                 const runtime::ObjectHolder *args, std::size_t argument_count, runtime::ObjectHolder &result) {
+      auto &state = method.jit;
+      if (!ENABLED) {
+        return false;
+      }
+      if (state.entry == nullptr) {
+        if (state.rejected || ++state.call_count < COMPILE_THRESHOLD || !Compile(method, self.GetClass())) {
+          return false;
+        }
+      }
+      if (state.class_id != self.GetClass().GetId() || argument_count != method.formal_params.size()) {
+        return false;
+      }
+      std::array<std::int64_t, MAX_ARGUMENTS> values{};
+      for (std::size_t i = 0; i < argument_count; ++i) {
+        if (args[i].GetKind() != runtime::ObjectKind::Number) {
+          return false;
+        }
+        values[i] = args[i].As<runtime::Number>().GetValue();
+      }
+      std::int32_t bailout = 0;
+      const std::int32_t value = state.entry(values.data(), &bailout);
+      ++JIT_STATS.native_calls;
+      if (bailout != 0) {
+        ++JIT_STATS.bailouts;
+        return false;
+      }
+      result = runtime::ObjectHolder::Own(runtime::Number{value});
+      return true;
+    }
+
+  }  // namespace jit
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Базовый JIT-компилятор методов в машинный код x86-64. Компилируются методы, тело которых
+// состоит из арифметики и сравнений чисел, IfElse, Return и вызовов методов self
+#if defined(__x86_64__) && defined(__linux__) && !defined(MYTHON_NO_JIT)
+#define MYTHON_JIT
+#endif
+
+namespace jit
+  {
+
+// Число вызовов метода интерпретатором, после которого метод компилируется
+    constexpr std::uint32_t COMPILE_THRESHOLD = 1000;
+
+    struct JitStats {
+      // Скомпилированные методы
+      std::size_t compiled = 0;
+      // Методы, которые не удалось скомпилировать
+      std::size_t rejected = 0;
+      // Вызовы машинного кода
+      std::size_t native_calls = 0;
+      // Возвраты из машинного кода в интерпретатор
+      std::size_t bailouts = 0;
+    };
+
+    extern JitStats JIT_STATS;
+
+// Возвращает true, если JIT-компилятор поддерживается на этой платформе
+    bool IsAvailable();
+
+// Включает или выключает компиляцию и вызов машинного кода
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+
+// Компилирует метод method для экземпляров класса cls вместе с методами self, которые он вызывает.
+// Возвращает false, если метод не поддерживается
+    bool Compile(const runtime::Method &method, const runtime::Class &cls);
+
+// Учитывает вызов метода method объекта self и, если метод скомпилирован, выполняет его машинный код.
+// Возвращает false, если метод должен выполнить интерпретатор: метод не скомпилирован,
+// аргументы не числа либо машинный код встретил неподдерживаемую ситуацию (например, деление на 0)
+    bool TryCall(const runtime::Method &method, const runtime::ClassInstance &self,
+                 const runtime::ObjectHolder *args, std::size_t argument_count, runtime::ObjectHolder &result);
+
+  }  // namespace jit
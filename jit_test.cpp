@@ -0,0 +1,235 @@
+#include "jit.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include "parse.h"
+#include "test_runner_p.h"
+#include "vm.h"
+
+using namespace std;
+
+namespace jit {
+
+namespace {
+
+const string PROGRAM = R"(
+class Calc:
+  def fib(n):
+    if n < 2:
+      return n
+    return self.fib(n - 1) + self.fib(n - 2)
+
+  def div(a, b):
+    return a / b
+
+  def add(a, b):
+    return a + b
+
+  def twice(a):
+    return self.add(a, a)
+
+  def sign(a):
+    if a > 0:
+      return 1
+    else:
+      if a == 0:
+        return 0
+    return -1
+
+  def nothing(a):
+    if a:
+      return a
+
+  def local(a):
+    b = a
+    return b
+
+  def printing(a):
+    print a
+    return a
+
+class Other(Calc):
+  def add(a, b):
+    return a * b
+)"s;
+
+struct Program {
+    unique_ptr<ast::Statement> tree;
+    runtime::Closure closure;
+    runtime::DummyContext context;
+
+    explicit Program(const string& text) {
+        istringstream input(text);
+        parse::Lexer lexer(input);
+        tree = ParseProgram(lexer);
+        tree->Execute(closure, context);
+    }
+
+    const runtime::Class& GetClass(const string& name) {
+        return closure.at(name).As<runtime::Class>();
+    }
+
+    const runtime::Method& GetMethod(const string& cls, const string& method) {
+        return *GetClass(cls).GetMethod(method);
+    }
+};
+
+runtime::ObjectHolder Call(runtime::ClassInstance& instance, const string& method, vector<runtime::ObjectHolder> args) {
+    runtime::DummyContext context;
+    return instance.Call(method, args, context);
+}
+
+runtime::ObjectHolder Num(int value) {
+    return runtime::ObjectHolder::Own(runtime::Number{value});
+}
+
+int AsInt(const runtime::ObjectHolder& object) {
+    return object.As<runtime::Number>().GetValue();
+}
+
+void TestCompilesSupportedMethods() {
+    if (!IsAvailable()) {
+        return;
+    }
+    Program program(PROGRAM);
+    const auto& calc = program.GetClass("Calc"s);
+    ASSERT(Compile(program.GetMethod("Calc"s, "fib"s), calc));
+    ASSERT(Compile(program.GetMethod("Calc"s, "sign"s), calc));
+    ASSERT(Compile(program.GetMethod("Calc"s, "div"s), calc));
+    // Вызываемый метод self компилируется вместе с вызывающим
+    ASSERT(Compile(program.GetMethod("Calc"s, "twice"s), calc));
+    ASSERT(program.GetMethod("Calc"s, "add"s).jit.entry != nullptr);
+
+    runtime::ClassInstance instance(calc);
+    const auto native_calls = JIT_STATS.native_calls;
+    ASSERT_EQUAL(AsInt(Call(instance, "fib"s, {Num(20)})), 6765);
+    ASSERT_EQUAL(AsInt(Call(instance, "twice"s, {Num(21)})), 42);
+    ASSERT_EQUAL(AsInt(Call(instance, "sign"s, {Num(5)})), 1);
+    ASSERT_EQUAL(AsInt(Call(instance, "sign"s, {Num(0)})), 0);
+    ASSERT_EQUAL(AsInt(Call(instance, "sign"s, {Num(-5)})), -1);
+    ASSERT_EQUAL(AsInt(Call(instance, "div"s, {Num(-7), Num(2)})), -3);
+    ASSERT_EQUAL(JIT_STATS.native_calls - native_calls, 6U);
+}
+
+void TestRejectsUnsupportedMethods() {
+    if (!IsAvailable()) {
+        return;
+    }
+    Program program(PROGRAM);
+    const auto& calc = program.GetClass("Calc"s);
+    ASSERT(!Compile(program.GetMethod("Calc"s, "local"s), calc));
+    ASSERT(!Compile(program.GetMethod("Calc"s, "printing"s), calc));
+    ASSERT(program.GetMethod("Calc"s, "printing"s).jit.rejected);
+
+    runtime::ClassInstance instance(calc);
+    ASSERT_EQUAL(AsInt(Call(instance, "local"s, {Num(3)})), 3);
+}
+
+void TestFallsBackToInterpreter() {
+    if (!IsAvailable()) {
+        return;
+    }
+    Program program(PROGRAM);
+    const auto& calc = program.GetClass("Calc"s);
+    for (const auto* name : {"div", "add", "nothing", "twice"}) {
+        ASSERT(Compile(program.GetMethod("Calc"s, name), calc));
+    }
+    runtime::ClassInstance instance(calc);
+
+    // Деление на 0: исключение выбрасывает интерпретатор
+    const auto bailouts = JIT_STATS.bailouts;
+    ASSERT_THROWS(Call(instance, "div"s, {Num(1), Num(0)}), runtime_error);
+    ASSERT_EQUAL(JIT_STATS.bailouts - bailouts, 1U);
+    // Метод, завершившийся без return, возвращает None
+    ASSERT(!Call(instance, "nothing"s, {Num(0)}));
+    ASSERT_EQUAL(AsInt(Call(instance, "nothing"s, {Num(7)})), 7);
+
+    // Аргументы, не являющиеся числами, обрабатывает интерпретатор
+    const auto native_calls = JIT_STATS.native_calls;
+    runtime::String a{"a"s};
+    const auto str = Call(instance, "add"s, {runtime::ObjectHolder::Share(a), runtime::ObjectHolder::Share(a)});
+    ASSERT_EQUAL(str.As<runtime::String>().GetValue(), "aa"s);
+
+    // Код скомпилирован для класса Calc: в экземплярах Other метод add перекрыт
+    runtime::ClassInstance other(program.GetClass("Other"s));
+    ASSERT_EQUAL(AsInt(Call(other, "twice"s, {Num(5)})), 25);
+    ASSERT_EQUAL(JIT_STATS.native_calls, native_calls);
+}
+
+void TestCompilesHotMethods() {
+    const string program = PROGRAM + R"(
+c = Calc()
+print c.fib(18), c.twice(4), c.div(9, 3)
+)"s;
+    for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+        istringstream input(program);
+        parse::Lexer lexer(input);
+        auto tree = ParseProgram(lexer);
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        const auto native_calls = JIT_STATS.native_calls;
+        vm::Run(*tree, closure, context, backend);
+        ASSERT_EQUAL(context.output.str(), "2584 8 3\n"s);
+        // fib(18) вызывает метод 8361 раз: после COMPILE_THRESHOLD вызовов он исполняется машинным кодом
+        ASSERT_EQUAL(JIT_STATS.native_calls > native_calls, IsAvailable());
+    }
+}
+
+void TestCompilesTailCalls() {
+    if (!IsAvailable()) {
+        return;
+    }
+    istringstream input(R"(
+class Counter:
+  def count(n, total):
+    if n == 0:
+      return total
+    return self.count(n - 1, total + 2)
+)"s);
+    parse::Lexer lexer(input);
+    auto tree = ParseProgram(lexer);
+    opt::PassManager passes;
+    passes.DisableAll();
+    passes.SetEnabled("tail-calls"sv, true);
+    passes.Run(tree);
+    runtime::Closure closure;
+    runtime::DummyContext context;
+    tree->Execute(closure, context);
+    const auto& counter = closure.at("Counter"s).As<runtime::Class>();
+    ASSERT(Compile(*counter.GetMethod("count"s), counter));
+
+    // Хвостовой вызов - переход на начало тела: миллион итераций не расходуют стек
+    runtime::ClassInstance instance(counter);
+    const auto native_calls = JIT_STATS.native_calls;
+    ASSERT_EQUAL(AsInt(Call(instance, "count"s, {Num(1000000), Num(0)})), 2000000);
+    ASSERT_EQUAL(JIT_STATS.native_calls - native_calls, 1U);
+}
+
+void TestCanBeDisabled() {
+    Program program(PROGRAM);
+    runtime::ClassInstance instance(program.GetClass("Calc"s));
+    SetEnabled(false);
+    const auto native_calls = JIT_STATS.native_calls;
+    for (uint32_t i = 0; i <= COMPILE_THRESHOLD; ++i) {
+        Call(instance, "add"s, {Num(1), Num(2)});
+    }
+    SetEnabled(true);
+    ASSERT_EQUAL(JIT_STATS.native_calls, native_calls);
+    ASSERT(program.GetMethod("Calc"s, "add"s).jit.entry == nullptr);
+}
+
+}  // namespace
+
+void RunJitTests(TestRunner& tr) {
+    // Тесты рассчитывают на включённый JIT, настройка вызывающего восстанавливается после них
+    const bool enabled = IsEnabled();
+    SetEnabled(true);
+    RUN_TEST(tr, jit::TestCompilesSupportedMethods);
+    RUN_TEST(tr, jit::TestRejectsUnsupportedMethods);
+    RUN_TEST(tr, jit::TestFallsBackToInterpreter);
+    RUN_TEST(tr, jit::TestCompilesHotMethods);
+    RUN_TEST(tr, jit::TestCompilesTailCalls);
+    RUN_TEST(tr, jit::TestCanBeDisabled);
+    SetEnabled(enabled);
+}
+
+}  // namespace jit
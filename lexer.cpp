@@ -13,7 +13,10 @@ namespace parse
             std::string("print"), token_type::Print{}}, {std::string("and"), token_type::And{}}, {
             std::string("or"), token_type::Or{}}, {std::string("not"), token_type::Not{}}, {
             std::string("None"), token_type::None{}}, {
-            std::string("True"), token_type::True{}}, {std::string("False"), token_type::False{}}
+            std::string("True"), token_type::True{}}, {std::string("False"), token_type::False{}}, {
+            std::string("while"), token_type::While{}}, {std::string("for"), token_type::For{}}, {
+            std::string("in"), token_type::In{}}, {std::string("break"), token_type::Break{}}, {
+            std::string("continue"), token_type::Continue{}}
     };
     const std::unordered_map<std::string, Token> SPECIAL_OPERATORS_TOKEN{
         {std::string("=="), token_type::Eq{}}, {std::string("!="), token_type::NotEq{}}, {
@@ -109,6 +112,11 @@ namespace parse
       UNVALUED_OUTPUT(None);
       UNVALUED_OUTPUT(True);
       UNVALUED_OUTPUT(False);
+      UNVALUED_OUTPUT(While);
+      UNVALUED_OUTPUT(For);
+      UNVALUED_OUTPUT(In);
+      UNVALUED_OUTPUT(Break);
+      UNVALUED_OUTPUT(Continue);
       UNVALUED_OUTPUT(Eof);
 
 #undef UNVALUED_OUTPUT
@@ -142,7 +150,7 @@ namespace parse
       return current_token_;
     }
 
-    Token Lexer::NextToken() {
+    const Token &Lexer::NextToken() {
       if (current_token_index_ < tokens_.size()) {
         current_token_ = tokens_[current_token_index_++];
       }
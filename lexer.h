@@ -1,5 +1,7 @@
 #pragma once
 
+#include "symbol.h"
+
 #include <iosfwd>
 #include <optional>
 #include <sstream>
@@ -18,8 +20,8 @@ namespace parse
           int value;   // число
         };
 
-        struct Id {             // Лексема «идентификатор»
-          std::string value;  // Имя идентификатора
+        struct Id {                 // Лексема «идентификатор»
+          runtime::Symbol value;  // Имя идентификатора
         };
 
         struct Char {    // Лексема «символ»
@@ -27,7 +29,7 @@ namespace parse
         };
 
         struct String {  // Лексема «строковая константа»
-          std::string value;
+          runtime::Symbol value;
         };
 
         struct Class {};    // Лексема «class»
@@ -50,6 +52,11 @@ namespace parse
         struct None {};         // Лексема «None»
         struct True {};         // Лексема «True»
         struct False {};        // Лексема «False»
+        struct While {};        // Лексема «while»
+        struct For {};          // Лексема «for»
+        struct In {};           // Лексема «in»
+        struct Break {};        // Лексема «break»
+        struct Continue {};     // Лексема «continue»
       }  // namespace token_type
 
     using TokenBase
@@ -76,6 +83,11 @@ namespace parse
                    , token_type::None
                    , token_type::True
                    , token_type::False
+                   , token_type::While
+                   , token_type::For
+                   , token_type::In
+                   , token_type::Break
+                   , token_type::Continue
                    , token_type::Eof>;
 
     struct Token
@@ -116,7 +128,9 @@ namespace parse
 
       [[nodiscard]] const Token &CurrentToken() const;
 
-      Token NextToken();
+      // Переходит к следующей лексеме и возвращает её. Идентификаторы и строковые константы хранятся
+      // в лексемах как символы (см. runtime::Symbol), поэтому лексемы копируются без выделения памяти
+      const Token &NextToken();
 
       template<typename T>
       const T &Expect() const {
@@ -1,10 +1,19 @@
+#include "jit.h"
 #include "lexer.h"
+#include "optimizer.h"
 #include "parse.h"
+#include "program_cache.h"
 #include "runtime.h"
 #include "statement.h"
 #include "test_runner_p.h"
+#include "vm.h"
 
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <vector>
 
 using namespace std;
 
@@ -22,19 +31,77 @@ namespace runtime
     void RunObjectHolderTests(TestRunner &tr);
     void RunObjectsTests(TestRunner &tr);
   }  // namespace runtime
+namespace vm
+  {
+    void RunVmTests(TestRunner &tr);
+  }  // namespace vm
+namespace cache
+  {
+    void RunProgramCacheTests(TestRunner &tr);
+  }  // namespace cache
+namespace jit
+  {
+    void RunJitTests(TestRunner &tr);
+  }  // namespace jit
+namespace opt
+  {
+    void RunOptimizerTests(TestRunner &tr);
+  }  // namespace opt
 
 void TestParseProgram(TestRunner &tr);
 
 namespace
   {
+    vm::Backend BACKEND = vm::Backend::Bytecode;
+    opt::PassManager PASSES;
+    bool PRINT_PASS_REPORT = false;
+    bool PRINT_STACK_REPORT = false;
+
+    // Оптимизирует программу проходами PASSES и при необходимости выводит отчёт в cerr
+    void Optimize(unique_ptr<ast::Statement> &program) {
+      const auto report = PASSES.Run(program);
+      if (PRINT_PASS_REPORT) {
+        opt::PrintReport(cerr, report);
+      }
+    }
 
     void RunMythonProgram(istream &input, ostream &output) {
       parse::Lexer lexer(input);
       auto program = ParseProgram(lexer);
+      Optimize(program);
 
       runtime::SimpleContext context{output};
       runtime::Closure closure;
-      program->Execute(closure, context);
+      vm::Run(*program, closure, context, BACKEND);
+    }
+
+    // Выполняет программу source. Если задан cache_file, дерево разбора загружается из кэша,
+    // а при его отсутствии или непригодности программа разбирается заново и кэш перезаписывается.
+    // В кэше хранится неоптимизированное дерево, поэтому он не зависит от набора проходов
+    void RunMythonSource(const string &source, const optional<filesystem::path> &cache_file, ostream &output) {
+      unique_ptr<ast::Statement> program;
+      if (cache_file) {
+        program = cache::Load(*cache_file, source);
+      }
+      if (!program) {
+        istringstream input(source);
+        parse::Lexer lexer(input);
+        program = ParseProgram(lexer);
+        if (cache_file) {
+          cache::Store(*cache_file, *program, source);
+        }
+      }
+      Optimize(program);
+
+      runtime::SimpleContext context{output};
+      runtime::Closure closure;
+      vm::CALL_STACK_STATS = {};
+      vm::Run(*program, closure, context, BACKEND);
+      if (PRINT_STACK_REPORT) {
+        const auto &stats = vm::CALL_STACK_STATS;
+        cerr << "calls: "sv << stats.calls << ", max depth: "sv << stats.max_depth << ", peak frame memory: "sv
+             << stats.peak_frame_bytes << " of "sv << vm::GetFrameMemoryLimit() << " bytes"sv << endl;
+      }
     }
 
     void TestSimplePrints() {
@@ -259,14 +326,9 @@ print n
       ASSERT(output.str() == "123\n");
     }
 
-    void TestAll() {
-      TestRunner tr;
-      parse::RunOpenLexerTests(tr);
-      runtime::RunObjectHolderTests(tr);
-      runtime::RunObjectsTests(tr);
-      ast::RunUnitTests(tr);
-      TestParseProgram(tr);
-
+    // Программы из тестов выполняются обоими способами
+    void RunProgramTests(TestRunner &tr, vm::Backend backend) {
+      BACKEND = backend;
       RUN_TEST(tr, TestSimplePrints);
       RUN_TEST(tr, TestAssignments);
       RUN_TEST(tr, TestArithmetics);
@@ -281,13 +343,114 @@ print n
       RUN_TEST(tr, TestWithParameter);
     }
 
+    void TestAll() {
+      TestRunner tr;
+      parse::RunOpenLexerTests(tr);
+      runtime::RunObjectHolderTests(tr);
+      runtime::RunObjectsTests(tr);
+      ast::RunUnitTests(tr);
+      TestParseProgram(tr);
+      vm::RunVmTests(tr);
+      cache::RunProgramCacheTests(tr);
+      jit::RunJitTests(tr);
+      opt::RunOptimizerTests(tr);
+
+      const auto backend = BACKEND;
+      RunProgramTests(tr, vm::Backend::TreeWalker);
+      RunProgramTests(tr, vm::Backend::Bytecode);
+      RunProgramTests(tr, vm::Backend::Stackless);
+      BACKEND = backend;
+    }
+
   }  // namespace
 
-int main() {
+// MythonInterpreter [--tree | --stackless [--frame-memory-limit BYTES] [--stack-report]] [--no-jit]
+//                   [--cache-dir DIR] [--no-cache] [--no-opt] [--disable-pass NAME]... [--pass-report] [SCRIPT]
+// Программа читается из файла SCRIPT либо из стандартного ввода.
+// Ключ --tree выполняет программу обходом дерева разбора, без компиляции в байт-код.
+// Ключ --stackless размещает кадры вызовов методов в стеке виртуальной машины: глубина рекурсии
+// ограничена объёмом памяти --frame-memory-limit, а --stack-report выводит в стандартный поток ошибок
+// наибольшую глубину и объём памяти стека кадров.
+// Ключ --no-jit отключает компиляцию часто вызываемых методов в машинный код.
+// Разобранная программа кэшируется в файле SCRIPT.mythonc либо, если задан --cache-dir, в каталоге DIR
+// в файле, имя которого - хэш исходного текста. Ключ --no-cache отключает кэш.
+// Ключ --no-opt отключает оптимизацию дерева разбора, --disable-pass NAME - проход NAME (см. optimizer.h),
+// --pass-report выводит в стандартный поток ошибок отчёт о работе проходов
+int main(int argc, char **argv) {
   try {
+    optional<filesystem::path> script;
+    optional<filesystem::path> cache_dir;
+    bool use_cache = true;
+    bool optimize = true;
+    bool pass_report = false;
+    bool stack_report = false;
+    bool use_jit = true;
+    optional<size_t> frame_memory_limit;
+    vector<string> disabled_passes;
+    for (int i = 1; i < argc; ++i) {
+      if (argv[i] == "--tree"sv) {
+        BACKEND = vm::Backend::TreeWalker;
+      } else if (argv[i] == "--stackless"sv) {
+        BACKEND = vm::Backend::Stackless;
+      } else if (argv[i] == "--frame-memory-limit"sv && i + 1 < argc) {
+        frame_memory_limit = stoull(argv[++i]);
+      } else if (argv[i] == "--stack-report"sv) {
+        stack_report = true;
+      } else if (argv[i] == "--no-jit"sv) {
+        use_jit = false;
+      } else if (argv[i] == "--cache-dir"sv && i + 1 < argc) {
+        cache_dir = argv[++i];
+      } else if (argv[i] == "--no-cache"sv) {
+        use_cache = false;
+      } else if (argv[i] == "--no-opt"sv) {
+        optimize = false;
+      } else if (argv[i] == "--disable-pass"sv && i + 1 < argc) {
+        disabled_passes.emplace_back(argv[++i]);
+      } else if (argv[i] == "--pass-report"sv) {
+        pass_report = true;
+      } else if (argv[i][0] != '-' && !script) {
+        script = argv[i];
+      } else {
+        throw std::invalid_argument("unknown option: "s + argv[i]);
+      }
+    }
     TestAll();
 
-    RunMythonProgram(cin, cout);
+    // Тесты выполняются со всеми проходами оптимизатора и настройками по умолчанию, поэтому ключи применяются после них
+    for (const auto &name: disabled_passes) {
+      PASSES.SetEnabled(name, false);
+    }
+    if (!optimize) {
+      PASSES.DisableAll();
+    }
+    PRINT_PASS_REPORT = pass_report;
+    PRINT_STACK_REPORT = stack_report;
+    if (frame_memory_limit) {
+      vm::SetFrameMemoryLimit(*frame_memory_limit);
+    }
+    if (!use_jit) {
+      jit::SetEnabled(false);
+    }
+
+    string source;
+    if (script) {
+      ifstream input(*script, ios::binary);
+      if (!input) {
+        throw std::runtime_error("cannot open "s + script->string());
+      }
+      source.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    } else {
+      source.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+    }
+
+    optional<filesystem::path> cache_file;
+    if (use_cache && cache_dir) {
+      cache_file = cache::CachePath(*cache_dir, source);
+    } else if (use_cache && script) {
+      cache_file = *script;
+      *cache_file += ".mythonc"s;
+    }
+    RunMythonSource(source, cache_file, cout);
   } catch (const std::exception &e) {
     std::cerr << e.what() << std::endl;
     return 1;
@@ -0,0 +1,741 @@
+#include "optimizer.h"
+
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace opt
+  {
+    using namespace std::literals;
+    using runtime::ObjectHolder;
+
+    namespace
+      {
+        using StatementPtr = std::unique_ptr<ast::Statement>;
+
+        const runtime::Selector INIT_METHOD = runtime::InternSelector("__init__"sv);
+        const runtime::Selector STR_METHOD = runtime::InternSelector("__str__"sv);
+
+        template<typename T>
+        bool Is(const ast::Statement &node) {
+          return dynamic_cast<const T *>(&node) != nullptr;
+        }
+
+        bool IsConstant(const ast::Statement &node) {
+          return Is<ast::NumericConst>(node) || Is<ast::StringConst>(node) || Is<ast::BoolConst>(node)
+                 || Is<ast::None>(node);
+        }
+
+        // Вычисляет узел, не обращающийся к переменным
+        ObjectHolder Evaluate(ast::Statement &node) {
+          runtime::Closure closure;
+          runtime::DummyContext context;
+          return node.Execute(closure, context);
+        }
+
+        // Возвращает константу со значением value либо nullptr, если такой константы нет
+        StatementPtr MakeConstant(const ObjectHolder &value) {
+          switch (value.GetKind()) {
+            case runtime::ObjectKind::None:
+              return std::make_unique<ast::None>();
+            case runtime::ObjectKind::Number:
+              return std::make_unique<ast::NumericConst>(value.As<runtime::Number>());
+            case runtime::ObjectKind::String:
+              return std::make_unique<ast::StringConst>(value.As<runtime::String>());
+            case runtime::ObjectKind::Bool:
+              return std::make_unique<ast::BoolConst>(value.As<runtime::Bool>());
+            default:
+              return nullptr;
+          }
+        }
+
+        // Заменяет узел node результатом make_replacement и учитывает замену в отчёте.
+        // make_replacement может забирать дочерние узлы node: они подсчитываются заранее
+        template<typename MakeReplacement>
+        void Replace(StatementPtr &node, MakeReplacement make_replacement, PassReport &report) {
+          const auto before = CountNodes(*node);
+          StatementPtr replacement = make_replacement();
+          node = std::move(replacement);
+          ++report.rewritten;
+          report.removed += before - CountNodes(*node);
+        }
+
+        // Обходит дерево в обратном порядке: сначала дочерние узлы, затем сам узел
+        template<typename Fn>
+        void VisitPostOrder(StatementPtr &node, Fn &fn) {
+          TreeAccess::ForEachChild(*node, [&fn](StatementPtr &child) {
+            VisitPostOrder(child, fn);
+          });
+          fn(node);
+        }
+
+        class NegationPass
+            : public Pass {
+         public:
+          [[nodiscard]] std::string_view Name() const override {
+            return "negation"sv;
+          }
+
+          void Run(StatementPtr &program, PassReport &report) override {
+            auto rewrite = [&report](StatementPtr &node) {
+              auto *mult = dynamic_cast<ast::Mult *>(node.get());
+              if (mult == nullptr) {
+                return;
+              }
+              auto &lhs = TreeAccess::Lhs(*mult);
+              auto &rhs = TreeAccess::Rhs(*mult);
+              if (!lhs || !rhs || !Is<ast::NumericConst>(*rhs)
+                  || Evaluate(*rhs).As<runtime::Number>().GetValue() != -1) {
+                return;
+              }
+              Replace(node, [&lhs] {
+                return std::make_unique<ast::Negate>(std::move(lhs));
+              }, report);
+            };
+            VisitPostOrder(program, rewrite);
+          }
+        };
+
+        class ConstantFoldingPass
+            : public Pass {
+         public:
+          [[nodiscard]] std::string_view Name() const override {
+            return "constant-fold"sv;
+          }
+
+          void Run(StatementPtr &program, PassReport &report) override {
+            auto rewrite = [&report](StatementPtr &node) {
+              if (auto *print = dynamic_cast<ast::Print *>(node.get())) {
+                MergePrintArgs(TreeAccess::PrintArgs(*print), report);
+              } else if (auto replacement = Fold(*node)) {
+                Replace(node, [&replacement] {
+                  return std::move(replacement);
+                }, report);
+              }
+            };
+            VisitPostOrder(program, rewrite);
+          }
+
+         private:
+          // Возвращает константу, равную значению операции node, либо nullptr
+          static StatementPtr Fold(ast::Statement &node) {
+            std::vector<ast::Statement *> operands;
+            if (auto *unary = dynamic_cast<ast::UnaryOperation *>(&node)) {
+              operands.push_back(TreeAccess::Argument(*unary).get());
+            } else if (auto *binary = dynamic_cast<ast::BinaryOperation *>(&node)) {
+              auto *lhs = TreeAccess::Lhs(*binary).get();
+              // Значение or и and определяется константным левым операндом, если правый не вычисляется
+              if (lhs != nullptr && IsConstant(*lhs)) {
+                const bool lhs_value = runtime::IsTrue(Evaluate(*lhs));
+                if (Is<ast::Or>(node) && lhs_value) {
+                  return std::make_unique<ast::BoolConst>(runtime::Bool(true));
+                }
+                if (Is<ast::And>(node) && !lhs_value) {
+                  return std::make_unique<ast::BoolConst>(runtime::Bool(false));
+                }
+              }
+              operands.push_back(lhs);
+              operands.push_back(TreeAccess::Rhs(*binary).get());
+            } else {
+              return nullptr;
+            }
+            for (const auto *operand: operands) {
+              if (operand == nullptr || !IsConstant(*operand)) {
+                return nullptr;
+              }
+            }
+            // Ошибки (например, деление на 0) остаются на время исполнения
+            try {
+              return MakeConstant(Evaluate(node));
+            } catch (const std::runtime_error &) {
+              return nullptr;
+            }
+          }
+
+          // Заменяет подряд идущие константные аргументы print одной строкой
+          static void MergePrintArgs(std::vector<StatementPtr> &args, PassReport &report) {
+            std::vector<StatementPtr> result;
+            for (std::size_t i = 0; i < args.size();) {
+              std::size_t end = i;
+              while (end < args.size() && args[end] && IsConstant(*args[end])) {
+                ++end;
+              }
+              if (end - i < 2) {
+                result.push_back(std::move(args[i]));
+                ++i;
+                continue;
+              }
+              std::ostringstream text;
+              runtime::DummyContext context;
+              for (std::size_t j = i; j < end; ++j) {
+                if (j > i) {
+                  text << ' ';
+                }
+                if (const auto value = Evaluate(*args[j])) {
+                  value->Print(text, context);
+                } else {
+                  text << "None"sv;
+                }
+              }
+              result.push_back(std::make_unique<ast::StringConst>(runtime::String(text.str())));
+              ++report.rewritten;
+              report.removed += end - i - 1;
+              i = end;
+            }
+            args = std::move(result);
+          }
+        };
+
+        class DeadBranchPass
+            : public Pass {
+         public:
+          [[nodiscard]] std::string_view Name() const override {
+            return "dead-branches"sv;
+          }
+
+          void Run(StatementPtr &program, PassReport &report) override {
+            auto rewrite = [&report](StatementPtr &node) {
+              if (auto *statements = TreeAccess::CompoundStatements(*node)) {
+                FlattenCompounds(*statements, report);
+                return;
+              }
+              auto *if_else = dynamic_cast<ast::IfElse *>(node.get());
+              if (if_else == nullptr || !TreeAccess::Condition(*if_else)
+                  || !IsConstant(*TreeAccess::Condition(*if_else))) {
+                return;
+              }
+              auto &branch = runtime::IsTrue(Evaluate(*TreeAccess::Condition(*if_else)))
+                             ? TreeAccess::IfBody(*if_else)
+                             : TreeAccess::ElseBody(*if_else);
+              Replace(node, [&branch]() -> StatementPtr {
+                return branch ? std::move(branch) : std::make_unique<ast::Compound>();
+              }, report);
+            };
+            VisitPostOrder(program, rewrite);
+          }
+
+         private:
+          // Встраивает в statements инструкции вложенных Compound, оставшихся на месте IfElse.
+          // Пустые Compound от ветвей, которые никогда не выполняются, при этом исчезают
+          static void FlattenCompounds(std::vector<StatementPtr> &statements, PassReport &report) {
+            std::vector<StatementPtr> result;
+            for (auto &statement: statements) {
+              auto *nested = statement ? TreeAccess::CompoundStatements(*statement) : nullptr;
+              if (nested == nullptr) {
+                result.push_back(std::move(statement));
+                continue;
+              }
+              for (auto &nested_statement: *nested) {
+                result.push_back(std::move(nested_statement));
+              }
+              ++report.removed;
+            }
+            statements = std::move(result);
+          }
+        };
+
+        class DeadCodePass
+            : public Pass {
+         public:
+          [[nodiscard]] std::string_view Name() const override {
+            return "dead-code"sv;
+          }
+
+          void Run(StatementPtr &program, PassReport &report) override {
+            auto rewrite = [&report](StatementPtr &node) {
+              auto *statements = TreeAccess::CompoundStatements(*node);
+              if (statements == nullptr) {
+                return;
+              }
+              for (std::size_t i = 0; i + 1 < statements->size(); ++i) {
+                const auto *statement = (*statements)[i].get();
+                if (statement != nullptr
+                    && (Is<ast::Return>(*statement) || Is<ast::Break>(*statement) || Is<ast::Continue>(*statement))) {
+                  for (auto j = i + 1; j < statements->size(); ++j) {
+                    report.removed += (*statements)[j] ? CountNodes(*(*statements)[j]) : 0;
+                  }
+                  statements->resize(i + 1);
+                  break;
+                }
+              }
+            };
+            VisitPostOrder(program, rewrite);
+          }
+        };
+
+        // Копирует узел node, если он имеет тип Node, и возвращает true. Если операнды скопировать
+        // нельзя, result остаётся пустым
+        template<typename Node>
+        bool CloneOperation(ast::Statement &node, std::size_t max_slot, StatementPtr &result) {
+          auto *operation = dynamic_cast<Node *>(&node);
+          if (operation == nullptr) {
+            return false;
+          }
+          if constexpr (std::is_base_of_v<ast::UnaryOperation, Node>) {
+            auto &argument = TreeAccess::Argument(*operation);
+            if (auto copy = argument ? TreeAccess::Clone(*argument, max_slot) : nullptr) {
+              result = std::make_unique<Node>(std::move(copy));
+            }
+          } else {
+            auto &lhs = TreeAccess::Lhs(*operation);
+            auto &rhs = TreeAccess::Rhs(*operation);
+            auto lhs_copy = lhs ? TreeAccess::Clone(*lhs, max_slot) : nullptr;
+            auto rhs_copy = rhs ? TreeAccess::Clone(*rhs, max_slot) : nullptr;
+            if (lhs_copy && rhs_copy) {
+              result = std::make_unique<Node>(std::move(lhs_copy), std::move(rhs_copy));
+            }
+          }
+          return true;
+        }
+
+        template<typename... Nodes>
+        StatementPtr CloneOperation(ast::Statement &node, std::size_t max_slot) {
+          StatementPtr result;
+          (CloneOperation<Nodes>(node, max_slot, result) || ...);
+          return result;
+        }
+
+        // Подставляет тела небольших методов на место вызова. Метод подставляется, если его тело - return
+        // выражения либо последовательность присваиваний полям, а выражения состоят из констант, операций
+        // и параметров метода. Вызываемый метод определяется статически: для self.method(...) - метод класса,
+        // которому принадлежит вызывающий метод, для остальных вызовов - единственный в программе метод
+        // с таким именем. Во время исполнения подстановку защищает проверка метода класса объекта
+        class InlinePass
+            : public Pass {
+         public:
+          // Наибольшее число узлов подставляемого тела метода
+          static constexpr std::size_t MAX_INLINED_NODES = 16;
+
+          [[nodiscard]] std::string_view Name() const override {
+            return "inline"sv;
+          }
+
+          void Run(StatementPtr &program, PassReport &report) override {
+            methods_.clear();
+            CollectMethods(*program);
+            InlineCalls(program, nullptr, report);
+          }
+
+         private:
+          void CollectMethods(ast::Statement &node) {
+            if (auto *definition = dynamic_cast<ast::ClassDefinition *>(&node)) {
+              for (const auto &method: TreeAccess::DefinedClass(*definition).GetMethods()) {
+                methods_[runtime::InternSelector(method.name)].push_back(&method);
+              }
+            }
+            TreeAccess::ForEachChild(node, [this](StatementPtr &child) {
+              CollectMethods(*child);
+            });
+          }
+
+          // Подставляет вызовы в поддереве node, принадлежащем методу класса cls (nullptr - программе)
+          void InlineCalls(StatementPtr &node, const runtime::Class *cls, PassReport &report) {
+            if (auto *definition = dynamic_cast<ast::ClassDefinition *>(node.get())) {
+              auto &defined_class = TreeAccess::DefinedClass(*definition);
+              for (auto &method: defined_class.GetMethods()) {
+                if (method.body) {
+                  InlineCalls(method.body, &defined_class, report);
+                }
+              }
+              return;
+            }
+            TreeAccess::ForEachChild(*node, [this, cls, &report](StatementPtr &child) {
+              InlineCalls(child, cls, report);
+            });
+
+            if (auto *call = dynamic_cast<ast::MethodCall *>(node.get());
+                call != nullptr && dynamic_cast<ast::InlinedCall *>(call) == nullptr) {
+              const runtime::Method *callee = FindCallee(*call, cls);
+              if (auto body = callee != nullptr ? InlinableBody(*callee) : nullptr) {
+                node = TreeAccess::Inline(*call, {callee, std::move(body)});
+                ++report.rewritten;
+              }
+            } else if (auto *new_instance = dynamic_cast<ast::NewInstance *>(node.get());
+                new_instance != nullptr && !TreeAccess::HasInlinedInit(*new_instance)) {
+              const auto &instance_class = TreeAccess::InstanceClass(*new_instance);
+              const runtime::Method *init = instance_class.GetMethod(INIT_METHOD);
+              if (init == nullptr || init->formal_params.size() != TreeAccess::ArgumentCount(*new_instance)) {
+                return;
+              }
+              if (auto body = InlinableBody(*init)) {
+                TreeAccess::InlineInit(*new_instance, {init, std::move(body)});
+                ++report.rewritten;
+              }
+            }
+          }
+
+          // Возвращает метод, который предположительно будет вызван в точке call, либо nullptr
+          const runtime::Method *FindCallee(const ast::MethodCall &call, const runtime::Class *cls) const {
+            const auto selector = TreeAccess::GetSelector(call);
+            const runtime::Method *callee = nullptr;
+            if (cls != nullptr && TreeAccess::IsSelfCall(call)) {
+              callee = cls->GetMethod(selector);
+            } else if (const auto it = methods_.find(selector); it != methods_.end() && it->second.size() == 1) {
+              callee = it->second.front();
+            }
+            return callee != nullptr && callee->formal_params.size() == TreeAccess::ArgumentCount(call) ? callee
+                                                                                                          : nullptr;
+          }
+
+          // Возвращает копию тела метода для подстановки либо nullptr, если метод нельзя подставить
+          static StatementPtr InlinableBody(const runtime::Method &method) {
+            const auto parameter_count = method.formal_params.size();
+            // Кадр подставленного метода содержит только self и параметры
+            auto *body = dynamic_cast<ast::MethodBody *>(method.body.get());
+            if (body == nullptr || method.frame_size != parameter_count + 1) {
+              return nullptr;
+            }
+            StatementPtr result;
+            TreeAccess::ForEachChild(*body, [&result, parameter_count](StatementPtr &compound) {
+              auto *statements = TreeAccess::CompoundStatements(*compound);
+              if (statements == nullptr || statements->empty()) {
+                return;
+              }
+              if (statements->size() == 1 && dynamic_cast<ast::Return *>(statements->front().get()) != nullptr) {
+                TreeAccess::ForEachChild(*statements->front(), [&result, parameter_count](StatementPtr &value) {
+                  result = TreeAccess::Clone(*value, parameter_count);
+                });
+                return;
+              }
+              for (const auto &statement: *statements) {
+                if (dynamic_cast<ast::FieldAssignment *>(statement.get()) == nullptr) {
+                  return;
+                }
+              }
+              result = TreeAccess::Clone(*compound, parameter_count);
+            });
+            return result && CountNodes(*result) <= MAX_INLINED_NODES ? std::move(result) : nullptr;
+          }
+
+          // Собственные методы классов программы по селектору имени
+          std::unordered_map<runtime::Selector, std::vector<const runtime::Method *>> methods_;
+        };
+
+        // Заменяет return self.method(...) в теле того же метода на TailCall: такой вызов выполняется
+        // в кадре текущего вызова без рекурсии, и длинные итерации не переполняют стек
+        class TailCallPass
+            : public Pass {
+         public:
+          [[nodiscard]] std::string_view Name() const override {
+            return "tail-calls"sv;
+          }
+
+          void Run(StatementPtr &program, PassReport &report) override {
+            Visit(program, report);
+          }
+
+         private:
+          static void Visit(StatementPtr &node, PassReport &report) {
+            if (auto *definition = dynamic_cast<ast::ClassDefinition *>(node.get())) {
+              auto &cls = TreeAccess::DefinedClass(*definition);
+              for (auto &method: cls.GetMethods()) {
+                if (method.body) {
+                  EliminateTailCalls(method.body, cls, method, report);
+                }
+              }
+              return;
+            }
+            TreeAccess::ForEachChild(*node, [&report](StatementPtr &child) {
+              Visit(child, report);
+            });
+          }
+
+          // Заменяет хвостовые вызовы method в поддереве node тела метода method класса cls
+          static void EliminateTailCalls(StatementPtr &node, const runtime::Class &cls, const runtime::Method &method,
+                                         PassReport &report) {
+            if (!Is<ast::Return>(*node)) {
+              TreeAccess::ForEachChild(*node, [&cls, &method, &report](StatementPtr &child) {
+                EliminateTailCalls(child, cls, method, report);
+              });
+              return;
+            }
+            TreeAccess::ForEachChild(*node, [&cls, &method, &report](StatementPtr &value) {
+              auto *call = dynamic_cast<ast::MethodCall *>(value.get());
+              if (call == nullptr || Is<ast::InlinedCall>(*call) || Is<ast::TailCall>(*call)
+                  || !TreeAccess::IsSelfCall(*call) || cls.GetMethod(TreeAccess::GetSelector(*call)) != &method
+                  || TreeAccess::ArgumentCount(*call) != method.formal_params.size()) {
+                return;
+              }
+              value = TreeAccess::EliminateTailCall(*call, method);
+              ++report.rewritten;
+            });
+          }
+        };
+
+        /*
+         * Анализ времени жизни временных значений. Строка или экземпляр класса не покидают выражение,
+         * если их потребляет операция, которая не сохраняет операнд и не передаёт его в методы:
+         * сложение строк, сравнение строк, str, print, not, and, or и условие if.
+         * Такие значения размещаются в STACK_REGION, а ближайший объемлющий узел, результат которого
+         * размещается обычным образом, оборачивается в StackScope, освобождающий их после вычисления.
+         * Числа уже хранятся в ObjectHolder непосредственно и анализа не требуют
+         */
+        class EscapePass
+            : public Pass {
+         public:
+          [[nodiscard]] std::string_view Name() const override {
+            return "escape"sv;
+          }
+
+          void Run(StatementPtr &program, PassReport &report) override {
+            Visit(program, false, report);
+          }
+
+         private:
+          // Обрабатывает поддерево node; consumed - родитель потребляет значение node.
+          // Возвращает true, если в поддереве остались размещённые в STACK_REGION значения,
+          // ещё не охваченные StackScope
+          static bool Visit(StatementPtr &node, bool consumed, PassReport &report) {
+            bool pending = false;
+            if (auto *definition = dynamic_cast<ast::ClassDefinition *>(node.get())) {
+              for (auto &method: TreeAccess::DefinedClass(*definition).GetMethods()) {
+                if (method.body) {
+                  Visit(method.body, false, report);
+                }
+              }
+              return false;
+            }
+            ast::Statement &parent = *node;
+            TreeAccess::ForEachChild(parent, [&parent, &pending, &report](StatementPtr &child) {
+              pending = Visit(child, Consumes(parent, *child), report) || pending;
+            });
+            if (consumed && TreeAccess::PlaceInStackRegion(*node)) {
+              ++report.rewritten;
+              return true;
+            }
+            if (pending) {
+              node = std::make_unique<ast::StackScope>(std::move(node));
+            }
+            return false;
+          }
+
+          // Выражение, результатом которого может быть только строка
+          static bool IsString(ast::Statement &node) {
+            if (auto *add = dynamic_cast<ast::Add *>(&node)) {
+              auto &lhs = TreeAccess::Lhs(*add);
+              return lhs && IsString(*lhs);
+            }
+            return Is<ast::StringConst>(node) || Is<ast::Stringify>(node);
+          }
+
+          // Значение, которое print и str выводят, не вызывая методов
+          static bool IsPrintable(ast::Statement &node) {
+            if (auto *new_instance = dynamic_cast<ast::NewInstance *>(&node)) {
+              const auto *str = TreeAccess::InstanceClass(*new_instance).GetMethod(STR_METHOD);
+              return str == nullptr || !str->formal_params.empty();
+            }
+            return IsString(node);
+          }
+
+          static bool IsStringComparison(ast::Statement &node) {
+            auto *binary = dynamic_cast<ast::BinaryOperation *>(&node);
+            if (binary == nullptr || Is<ast::Add>(node) || Is<ast::Sub>(node) || Is<ast::Mult>(node)
+                || Is<ast::Div>(node) || Is<ast::Or>(node) || Is<ast::And>(node)) {
+              return false;
+            }
+            auto &lhs = TreeAccess::Lhs(*binary);
+            auto &rhs = TreeAccess::Rhs(*binary);
+            return lhs && rhs && IsString(*lhs) && IsString(*rhs);
+          }
+
+          // Возвращает true, если parent потребляет значение дочернего узла child, не сохраняя его
+          static bool Consumes(ast::Statement &parent, ast::Statement &child) {
+            if (Is<ast::Print>(parent) || Is<ast::Stringify>(parent)) {
+              return IsPrintable(child);
+            }
+            if (Is<ast::Add>(parent)) {
+              return IsString(parent);
+            }
+            if (auto *if_else = dynamic_cast<ast::IfElse *>(&parent)) {
+              return TreeAccess::Condition(*if_else).get() == &child;
+            }
+            return Is<ast::Not>(parent) || Is<ast::Or>(parent) || Is<ast::And>(parent) || IsStringComparison(parent);
+          }
+        };
+      }  // namespace
+
+    void PrintReport(std::ostream &os, const Report &report) {
+      for (const auto &pass: report) {
+        os << pass.name << ": rewritten "sv << pass.rewritten << ", removed "sv << pass.removed << '\n';
+      }
+    }
+
+    PassManager::PassManager() {
+      passes_.push_back({std::make_unique<NegationPass>()});
+      passes_.push_back({std::make_unique<ConstantFoldingPass>()});
+      passes_.push_back({std::make_unique<DeadBranchPass>()});
+      passes_.push_back({std::make_unique<DeadCodePass>()});
+      passes_.push_back({std::make_unique<InlinePass>()});
+      passes_.push_back({std::make_unique<TailCallPass>()});
+      passes_.push_back({std::make_unique<EscapePass>()});
+    }
+
+    void PassManager::SetEnabled(std::string_view name, bool enabled) {
+      for (auto &entry: passes_) {
+        if (entry.pass->Name() == name) {
+          entry.enabled = enabled;
+          return;
+        }
+      }
+      throw std::invalid_argument("unknown optimization pass: "s + std::string(name));
+    }
+
+    void PassManager::DisableAll() {
+      for (auto &entry: passes_) {
+        entry.enabled = false;
+      }
+    }
+
+    Report PassManager::Run(std::unique_ptr<ast::Statement> &program) {
+      Report report;
+      for (auto &entry: passes_) {
+        if (entry.enabled) {
+          report.push_back({entry.pass->Name()});
+          entry.pass->Run(program, report.back());
+        }
+      }
+      return report;
+    }
+
+    std::size_t CountNodes(ast::Statement &node) {
+      std::size_t result = 1;
+      TreeAccess::ForEachChild(node, [&result](std::unique_ptr<ast::Statement> &child) {
+        result += CountNodes(*child);
+      });
+      return result;
+    }
+
+    std::vector<std::unique_ptr<ast::Statement>> *TreeAccess::CompoundStatements(ast::Statement &node) {
+      auto *compound = dynamic_cast<ast::Compound *>(&node);
+      return compound != nullptr ? &compound->statements_ : nullptr;
+    }
+
+    std::vector<std::unique_ptr<ast::Statement>> &TreeAccess::PrintArgs(ast::Print &node) {
+      return node.args_;
+    }
+
+    std::unique_ptr<ast::Statement> &TreeAccess::Argument(ast::UnaryOperation &node) {
+      return node.argument_;
+    }
+
+    std::unique_ptr<ast::Statement> &TreeAccess::Lhs(ast::BinaryOperation &node) {
+      return node.lhs_;
+    }
+
+    std::unique_ptr<ast::Statement> &TreeAccess::Rhs(ast::BinaryOperation &node) {
+      return node.rhs_;
+    }
+
+    std::unique_ptr<ast::Statement> &TreeAccess::Condition(ast::IfElse &node) {
+      return node.condition_;
+    }
+
+    std::unique_ptr<ast::Statement> &TreeAccess::IfBody(ast::IfElse &node) {
+      return node.if_body_;
+    }
+
+    std::unique_ptr<ast::Statement> &TreeAccess::ElseBody(ast::IfElse &node) {
+      return node.else_body_;
+    }
+
+    runtime::Class &TreeAccess::DefinedClass(ast::ClassDefinition &node) {
+      return node.cls_.As<runtime::Class>();
+    }
+
+    bool TreeAccess::IsSelfCall(const ast::MethodCall &node) {
+      const auto *object = dynamic_cast<const ast::VariableValue *>(node.object_.get());
+      return object != nullptr && object->slot_ == 0 && object->dotted_ids_.size() == 1;
+    }
+
+    runtime::Selector TreeAccess::GetSelector(const ast::MethodCall &node) {
+      return node.selector_;
+    }
+
+    std::size_t TreeAccess::ArgumentCount(const ast::MethodCall &node) {
+      return node.args_.size();
+    }
+
+    std::size_t TreeAccess::ArgumentCount(const ast::NewInstance &node) {
+      return node.args_.size();
+    }
+
+    const runtime::Class &TreeAccess::InstanceClass(const ast::NewInstance &node) {
+      return node.cls_.GetClass();
+    }
+
+    bool TreeAccess::HasInlinedInit(const ast::NewInstance &node) {
+      return node.init_.body != nullptr;
+    }
+
+    std::unique_ptr<ast::Statement> TreeAccess::Inline(ast::MethodCall &node, ast::InlinedMethod inlined) {
+      return std::make_unique<ast::InlinedCall>(std::move(node.object_), node.method_name_, std::move(node.args_),
+                                                std::move(inlined));
+    }
+
+    std::unique_ptr<ast::Statement> TreeAccess::EliminateTailCall(ast::MethodCall &node, const runtime::Method &method) {
+      return std::make_unique<ast::TailCall>(std::move(node.object_), node.method_name_, std::move(node.args_), &method);
+    }
+
+    void TreeAccess::InlineInit(ast::NewInstance &node, ast::InlinedMethod inlined) {
+      node.init_ = std::move(inlined);
+    }
+
+    bool TreeAccess::PlaceInStackRegion(ast::Statement &node) {
+      if (auto *stringify = dynamic_cast<ast::Stringify *>(&node)) {
+        stringify->in_stack_region_ = true;
+      } else if (auto *add = dynamic_cast<ast::Add *>(&node)) {
+        add->in_stack_region_ = true;
+      } else if (auto *new_instance = dynamic_cast<ast::NewInstance *>(&node)) {
+        new_instance->in_stack_region_ = true;
+      } else {
+        return false;
+      }
+      return true;
+    }
+
+    std::unique_ptr<ast::Statement> TreeAccess::Clone(ast::Statement &node, std::size_t max_slot) {
+      using ast::Comparator;
+      if (const auto *number = dynamic_cast<const ast::NumericConst *>(&node)) {
+        return std::make_unique<ast::NumericConst>(number->value_);
+      }
+      if (const auto *str = dynamic_cast<const ast::StringConst *>(&node)) {
+        return std::make_unique<ast::StringConst>(str->value_);
+      }
+      if (const auto *boolean = dynamic_cast<const ast::BoolConst *>(&node)) {
+        return std::make_unique<ast::BoolConst>(boolean->value_);
+      }
+      if (dynamic_cast<const ast::None *>(&node) != nullptr) {
+        return std::make_unique<ast::None>();
+      }
+      if (const auto *variable = dynamic_cast<const ast::VariableValue *>(&node)) {
+        return variable->slot_ <= max_slot ? std::make_unique<ast::VariableValue>(*variable) : nullptr;
+      }
+      if (auto *field_assignment = dynamic_cast<ast::FieldAssignment *>(&node)) {
+        auto rv = field_assignment->rv_ ? Clone(*field_assignment->rv_, max_slot) : nullptr;
+        if (field_assignment->object_.slot_ > max_slot || !rv) {
+          return nullptr;
+        }
+        return std::make_unique<ast::FieldAssignment>(field_assignment->object_, field_assignment->field_name_,
+                                                      std::move(rv));
+      }
+      if (auto *compound = dynamic_cast<ast::Compound *>(&node)) {
+        auto result = std::make_unique<ast::Compound>();
+        for (const auto &statement: compound->statements_) {
+          auto copy = statement ? Clone(*statement, max_slot) : nullptr;
+          if (!copy) {
+            return nullptr;
+          }
+          result->AddStatement(std::move(copy));
+        }
+        return result;
+      }
+      return CloneOperation<ast::Stringify, ast::Not, ast::Negate, ast::Add, ast::Sub, ast::Mult, ast::Div, ast::Or,
+                            ast::And, ast::Comparison<Comparator::Equal>, ast::Comparison<Comparator::NotEqual>,
+                            ast::Comparison<Comparator::Less>, ast::Comparison<Comparator::Greater>,
+                            ast::Comparison<Comparator::LessOrEqual>,
+                            ast::Comparison<Comparator::GreaterOrEqual>>(node, max_slot);
+    }
+
+  }  // namespace opt
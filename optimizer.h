@@ -0,0 +1,187 @@
+#pragma once
+
+#include "statement.h"
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace opt
+  {
+
+// Результат работы прохода оптимизатора
+    struct PassReport {
+      std::string_view name;
+      // Число узлов, заменённых новыми узлами
+      std::size_t rewritten = 0;
+      // На сколько уменьшилось число узлов дерева
+      std::size_t removed = 0;
+    };
+
+    using Report = std::vector<PassReport>;
+
+// Выводит отчёт в os, по строке на проход
+    void PrintReport(std::ostream &os, const Report &report);
+
+// Проход оптимизатора: преобразует дерево разбора, сохраняя поведение программы
+    class Pass {
+     public:
+      virtual ~Pass() = default;
+
+      [[nodiscard]] virtual std::string_view Name() const = 0;
+      virtual void Run(std::unique_ptr<ast::Statement> &program, PassReport &report) = 0;
+    };
+
+/*
+ * Выполняет проходы над деревом разбора после ParseProgram и до исполнения программы.
+ * Проходы по умолчанию, в порядке выполнения:
+ *   negation       - x * -1 заменяется на Negate(x)
+ *   constant-fold  - вычисляет операции над константами Number, String, Bool и None,
+ *                    объединяет константные аргументы print
+ *   dead-branches  - заменяет IfElse с константным условием инструкциями выбранной ветви
+ *   dead-code      - удаляет инструкции Compound, следующие за return, break и continue
+ *   inline         - подставляет тела небольших методов (геттеров, сеттеров, тривиальных __init__)
+ *                    на место их вызова (см. ast::InlinedCall)
+ *   tail-calls     - заменяет return self.method(...) в теле того же метода на ast::TailCall,
+ *                    выполняющий вызов без рекурсии
+ *   escape         - размещает в runtime::STACK_REGION строки и экземпляры, которые потребляются
+ *                    объемлющим выражением и не покидают его (см. ast::StackScope)
+ */
+    class PassManager {
+     public:
+      PassManager();
+
+      // Отключает или включает проход name. Для неизвестного имени выбрасывает invalid_argument
+      void SetEnabled(std::string_view name, bool enabled);
+      // Отключает все проходы
+      void DisableAll();
+
+      Report Run(std::unique_ptr<ast::Statement> &program);
+
+     private:
+      struct Entry {
+        std::unique_ptr<Pass> pass;
+        bool enabled = true;
+      };
+
+      std::vector<Entry> passes_;
+    };
+
+// Число узлов дерева, включая тела методов определённых в нём классов
+    std::size_t CountNodes(ast::Statement &node);
+
+// Доступ проходов оптимизатора к дочерним узлам дерева разбора
+    class TreeAccess {
+     public:
+      // Вызывает fn для каждого непустого дочернего узла node, передавая ссылку на владеющий указатель
+      template<typename Fn>
+      static void ForEachChild(ast::Statement &node, Fn &&fn);
+
+      // Инструкции составного узла либо nullptr, если node не Compound
+      static std::vector<std::unique_ptr<ast::Statement>> *CompoundStatements(ast::Statement &node);
+      static std::vector<std::unique_ptr<ast::Statement>> &PrintArgs(ast::Print &node);
+      static std::unique_ptr<ast::Statement> &Argument(ast::UnaryOperation &node);
+      static std::unique_ptr<ast::Statement> &Lhs(ast::BinaryOperation &node);
+      static std::unique_ptr<ast::Statement> &Rhs(ast::BinaryOperation &node);
+      static std::unique_ptr<ast::Statement> &Condition(ast::IfElse &node);
+      static std::unique_ptr<ast::Statement> &IfBody(ast::IfElse &node);
+      static std::unique_ptr<ast::Statement> &ElseBody(ast::IfElse &node);
+
+      static runtime::Class &DefinedClass(ast::ClassDefinition &node);
+      // Возвращает true, если метод вызывается у self метода, которому принадлежит node
+      static bool IsSelfCall(const ast::MethodCall &node);
+      static runtime::Selector GetSelector(const ast::MethodCall &node);
+      static std::size_t ArgumentCount(const ast::MethodCall &node);
+      static std::size_t ArgumentCount(const ast::NewInstance &node);
+      static const runtime::Class &InstanceClass(const ast::NewInstance &node);
+      static bool HasInlinedInit(const ast::NewInstance &node);
+
+      // Заменяет вызов node узлом InlinedCall, забирая у node объект и аргументы
+      static std::unique_ptr<ast::Statement> Inline(ast::MethodCall &node, ast::InlinedMethod inlined);
+      static void InlineInit(ast::NewInstance &node, ast::InlinedMethod inlined);
+      // Заменяет хвостовой вызов node метода method узлом TailCall, забирая у node объект и аргументы
+      static std::unique_ptr<ast::Statement> EliminateTailCall(ast::MethodCall &node, const runtime::Method &method);
+      // Размещает результат Stringify, Add или NewInstance в STACK_REGION. Для остальных узлов возвращает false
+      static bool PlaceInStackRegion(ast::Statement &node);
+
+      // Копирует выражение из констант, операций над ними, переменных со слотами 0..max_slot
+      // и присваиваний полям таких переменных. Для остальных узлов возвращает nullptr
+      static std::unique_ptr<ast::Statement> Clone(ast::Statement &node, std::size_t max_slot);
+    };
+
+    template<typename Fn>
+    void TreeAccess::ForEachChild(ast::Statement &node, Fn &&fn) {
+      const auto visit = [&fn](std::unique_ptr<ast::Statement> &child) {
+        if (child) {
+          fn(child);
+        }
+      };
+      const auto visit_all = [&visit](std::vector<std::unique_ptr<ast::Statement>> &children) {
+        for (auto &child: children) {
+          visit(child);
+        }
+      };
+      if (auto *compound = dynamic_cast<ast::Compound *>(&node)) {
+        visit_all(compound->statements_);
+      } else if (auto *print = dynamic_cast<ast::Print *>(&node)) {
+        visit_all(print->args_);
+      } else if (auto *method_body = dynamic_cast<ast::MethodBody *>(&node)) {
+        visit(method_body->body_);
+      } else if (auto *ret = dynamic_cast<ast::Return *>(&node)) {
+        visit(ret->statement_);
+      } else if (auto *if_else = dynamic_cast<ast::IfElse *>(&node)) {
+        visit(if_else->condition_);
+        visit(if_else->if_body_);
+        visit(if_else->else_body_);
+      } else if (auto *while_loop = dynamic_cast<ast::While *>(&node)) {
+        visit(while_loop->condition_);
+        visit(while_loop->body_);
+      } else if (auto *for_loop = dynamic_cast<ast::ForRange *>(&node)) {
+        visit(for_loop->begin_);
+        visit(for_loop->end_);
+        visit(for_loop->body_);
+      } else if (auto *for_each = dynamic_cast<ast::ForEach *>(&node)) {
+        visit(for_each->iterable_);
+        visit(for_each->body_);
+      } else if (auto *list = dynamic_cast<ast::ListLiteral *>(&node)) {
+        visit_all(list->items_);
+      } else if (auto *dict = dynamic_cast<ast::DictLiteral *>(&node)) {
+        visit_all(dict->keys_);
+        visit_all(dict->values_);
+      } else if (auto *index = dynamic_cast<ast::Index *>(&node)) {
+        visit(index->object_);
+        visit(index->index_);
+      } else if (auto *index_assignment = dynamic_cast<ast::IndexAssignment *>(&node)) {
+        visit(index_assignment->object_);
+        visit(index_assignment->index_);
+        visit(index_assignment->rv_);
+      } else if (auto *assignment = dynamic_cast<ast::Assignment *>(&node)) {
+        visit(assignment->rv_);
+      } else if (auto *field_assignment = dynamic_cast<ast::FieldAssignment *>(&node)) {
+        visit(field_assignment->rv_);
+      } else if (auto *method_call = dynamic_cast<ast::MethodCall *>(&node)) {
+        visit(method_call->object_);
+        visit_all(method_call->args_);
+        if (auto *inlined_call = dynamic_cast<ast::InlinedCall *>(method_call)) {
+          visit(inlined_call->inlined_.body);
+        }
+      } else if (auto *new_instance = dynamic_cast<ast::NewInstance *>(&node)) {
+        visit_all(new_instance->args_);
+        visit(new_instance->init_.body);
+      } else if (auto *unary = dynamic_cast<ast::UnaryOperation *>(&node)) {
+        visit(unary->argument_);
+      } else if (auto *binary = dynamic_cast<ast::BinaryOperation *>(&node)) {
+        visit(binary->lhs_);
+        visit(binary->rhs_);
+      } else if (auto *stack_scope = dynamic_cast<ast::StackScope *>(&node)) {
+        visit(stack_scope->body_);
+      } else if (auto *class_definition = dynamic_cast<ast::ClassDefinition *>(&node)) {
+        for (auto &method: class_definition->cls_.As<runtime::Class>().GetMethods()) {
+          visit(method.body);
+        }
+      }
+    }
+
+  }  // namespace opt
@@ -0,0 +1,347 @@
+#include "lexer.h"
+#include "optimizer.h"
+#include "parse.h"
+#include "program_cache.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+#include "vm.h"
+
+#include <sstream>
+
+using namespace std;
+
+namespace opt {
+
+namespace {
+
+using test_program::Parse;
+using test_program::Run;
+
+// Оптимизирует source и сравнивает результат с деревом разбора программы expected
+void AssertOptimizesTo(const string& source, const string& expected) {
+    auto program = Parse(source);
+    PassManager passes;
+    passes.Run(program);
+    ASSERT_EQUAL(cache::Serialize(*program, {}), cache::Serialize(*Parse(expected), {}));
+}
+
+const PassReport& FindPass(const Report& report, string_view name) {
+    for (const auto& pass : report) {
+        if (pass.name == name) {
+            return pass;
+        }
+    }
+    throw runtime_error("no pass "s + string(name));
+}
+
+void TestFoldsConstants() {
+    AssertOptimizesTo("x = 2 * 3 + 4\ny = 'a' + 'b'\nz = 1 < 2 and not False\nprint x, y, z\n"s,
+                      "x = 10\ny = 'ab'\nz = True\nprint x, y, z\n"s);
+    AssertOptimizesTo("x = str(12) + str(None)\nprint x\n"s, "x = '12None'\nprint x\n"s);
+    // Короткое вычисление: правый операнд не вычисляется
+    AssertOptimizesTo("x = True or y.f()\nz = False and y.f()\n"s, "x = True\nz = False\n"s);
+    // Подряд идущие константные аргументы print объединяются
+    AssertOptimizesTo("x = 1\nprint 1, 'a', None, True, x, 2, 3\nprint 4\n"s,
+                      "x = 1\nprint '1 a None True', x, '2 3'\nprint 4\n"s);
+}
+
+void TestKeepsRuntimeErrors() {
+    AssertOptimizesTo("x = 1 / 0\ny = 'a' + 1\n"s, "x = 1 / 0\ny = 'a' + 1\n"s);
+    for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+        auto program = Parse("print 1 / 0\n"s);
+        PassManager().Run(program);
+        ASSERT_THROWS(Run(*program, backend), runtime_error);
+    }
+}
+
+void TestReplacesNegation() {
+    auto program = Parse("x = 5\ny = -x\nprint y, -y, x * -1, -(x + 1), -3\n"s);
+    PassManager passes;
+    passes.SetEnabled("constant-fold"sv, false);
+    const auto report = passes.Run(program);
+    ASSERT_EQUAL(FindPass(report, "negation"sv).rewritten, 4U);
+    ASSERT_EQUAL(FindPass(report, "negation"sv).removed, 4U);
+    for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+        ASSERT_EQUAL(Run(*program, backend), "-5 5 -5 -6 -3\n"s);
+    }
+
+    auto negate_string = Parse("x = 'a'\nprint -x\n"s);
+    PassManager().Run(negate_string);
+    for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+        ASSERT_THROWS(Run(*negate_string, backend), runtime_error);
+    }
+}
+
+void TestRemovesDeadBranches() {
+    AssertOptimizesTo(R"(
+if 1 < 2:
+  print 'yes'
+else:
+  print 'no'
+if None:
+  print 'never'
+if 'a' == 'b':
+  print 'no'
+else:
+  x = 1
+  if x:
+    print x
+)"s,
+                      R"(
+print 'yes'
+x = 1
+if x:
+  print x
+)"s);
+}
+
+void TestRemovesCodeAfterReturn() {
+    AssertOptimizesTo(R"(
+class A:
+  def f(x):
+    if x:
+      return 1
+      print 'unreachable'
+    return 2
+    x = 3
+    print x
+)"s,
+                      R"(
+class A:
+  def f(x):
+    if x:
+      return 1
+    return 2
+)"s);
+}
+
+void TestPassesCanBeDisabled() {
+    const string source = "if True:\n  print 1 + 1\n"s;
+    auto program = Parse(source);
+    PassManager passes;
+    passes.SetEnabled("dead-branches"sv, false);
+    const auto report = passes.Run(program);
+    ASSERT_EQUAL(report.size(), 6U);
+    ASSERT_EQUAL(FindPass(report, "constant-fold"sv).rewritten, 1U);
+    ASSERT_EQUAL(cache::Serialize(*program, {}), cache::Serialize(*Parse("if True:\n  print 2\n"s), {}));
+
+    PassManager none;
+    none.DisableAll();
+    auto unchanged = Parse(source);
+    ASSERT(none.Run(unchanged).empty());
+    ASSERT_EQUAL(cache::Serialize(*unchanged, {}), cache::Serialize(*Parse(source), {}));
+
+    ASSERT_THROWS(none.SetEnabled("unknown"sv, true), invalid_argument);
+}
+
+void TestPreservesBehaviour() {
+    const string source = R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    if n > 0 or False:
+      self.value = self.value + n * -1 * -1
+    else:
+      return self.value
+      print 'never'
+    return self.value
+
+  def __str__():
+    if 2 * 2 == 4:
+      return 'Counter ' + str(self.value)
+    return 'broken'
+
+c = Counter()
+c.add(2)
+c.add(3 * 4 - 2)
+print c, c.add(-1), -c.value, 1 + 2, 'x' + 'y' == 'xy' or c.add(1)
+print 'done', None, 10 / 3
+)"s;
+    for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+        auto original = Parse(source);
+        auto optimized = Parse(source);
+        const auto report = PassManager().Run(optimized);
+        ASSERT_EQUAL(report.size(), 7U);
+        ASSERT(CountNodes(*optimized) < CountNodes(*original));
+        ASSERT_EQUAL(Run(*optimized, backend), Run(*original, backend));
+    }
+}
+
+void TestInlinesSmallMethods() {
+    const string source = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def get_x():
+    return self.x
+
+  def set_x(x):
+    self.x = x
+
+  def sum():
+    return self.get_x() + self.y
+
+class Point3(Point):
+  def get_x():
+    return 100
+
+p = Point(1, 2)
+p.set_x(5)
+print p.get_x(), p.sum()
+q = Point3(1, 2)
+print q.sum()
+x = 5
+print x.set_x(1)
+)"s;
+    PassManager passes;
+    passes.DisableAll();
+    passes.SetEnabled("inline"sv, true);
+    auto program = Parse(source);
+    const auto report = passes.Run(program);
+    // Два вызова __init__, p.set_x, x.set_x и self.get_x в методе sum.
+    // Метод get_x перекрыт в Point3, поэтому p.get_x не подставляется, а sum вызывает метод
+    ASSERT_EQUAL(FindPass(report, "inline"sv).rewritten, 5U);
+    // Для объекта Point3 и числа x проверка метода не проходит и метод вызывается обычным образом
+    for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+        ASSERT_EQUAL(Run(*program, backend), "5 7\n102\nNone\n"s);
+    }
+    // В кэш подставленные вызовы записываются как обычные
+    ASSERT_EQUAL(cache::Serialize(*program, {}), cache::Serialize(*Parse(source), {}));
+}
+
+void TestInlinesOnlySimpleMethods() {
+    auto program = Parse(R"(
+class A:
+  def local(a):
+    b = a
+    return b
+
+  def call():
+    return self.local(1)
+
+  def branch(a):
+    if a:
+      return 1
+    return 2
+
+  def large(a):
+    return a + a + a + a + a + a + a + a + a
+
+a = A()
+print a.local(1), a.call(), a.branch(0), a.large(1)
+)"s);
+    PassManager passes;
+    passes.DisableAll();
+    passes.SetEnabled("inline"sv, true);
+    ASSERT_EQUAL(FindPass(passes.Run(program), "inline"sv).rewritten, 0U);
+    ASSERT_EQUAL(Run(*program, vm::Backend::Bytecode), "1 1 2 9\n"s);
+}
+
+void TestPlacesTemporariesInStackRegion() {
+    const string source = R"(
+class Point:
+  def __init__(x):
+    self.x = x
+
+  def __str__():
+    return 'Point(' + str(self.x) + ')'
+
+class Plain:
+  def __init__():
+    self.x = 0
+
+p = Point(1)
+s = 'a'
+print 'x=' + str(p) + ';', str(Plain()) == s
+if str(p) + s == 'Point(1)a':
+  print 'equal'
+x = 'kept ' + str(2)
+print x, not Point(2), p
+)"s;
+    PassManager passes;
+    passes.DisableAll();
+    passes.SetEnabled("escape"sv, true);
+    auto program = Parse(source);
+    ASSERT(FindPass(passes.Run(program), "escape"sv).rewritten > 0U);
+    for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+        const auto stats = runtime::ALLOCATION_STATS;
+        const auto output = Run(*program, backend);
+        const auto heap_objects = runtime::ALLOCATION_STATS.heap_objects - stats.heap_objects;
+        ASSERT_EQUAL(output, Run(*Parse(source), backend));
+        ASSERT(runtime::ALLOCATION_STATS.stack_objects > stats.stack_objects);
+        // Все временные значения освобождены
+        ASSERT_EQUAL(runtime::STACK_REGION.Mark(), 0U);
+
+        const auto unoptimized_stats = runtime::ALLOCATION_STATS;
+        Run(*Parse(source), backend);
+        ASSERT(heap_objects < runtime::ALLOCATION_STATS.heap_objects - unoptimized_stats.heap_objects);
+    }
+    // В кэш записывается дерево без областей временных значений
+    ASSERT_EQUAL(cache::Serialize(*program, {}), cache::Serialize(*Parse(source), {}));
+}
+
+void TestEliminatesTailCalls() {
+    const string source = R"(
+class Counter:
+  def count(n, total):
+    if n == 0:
+      return total
+    if n == 500000:
+      half = total
+      print 'half', half
+    return self.count(n - 1, total + 2)
+
+  def twice(n):
+    if n > 0:
+      return self.count(n, 0)
+    return self.twice(-n)
+
+class Other(Counter):
+  def count(n, total):
+    return 'other ' + str(n)
+
+class Runner:
+  def run(counter, n):
+    return counter.count(n, 0)
+
+c = Counter()
+o = Other()
+r = Runner()
+print c.count(1000000, 0), c.twice(-3), o.twice(-3)
+print r.run(c, 10)
+)"s;
+    PassManager passes;
+    passes.DisableAll();
+    passes.SetEnabled("tail-calls"sv, true);
+    auto program = Parse(source);
+    // Вызовы count в count и twice в twice. Вызов self.count в twice и вызов метода другого объекта
+    // в Runner.run не являются рекурсией
+    ASSERT_EQUAL(FindPass(passes.Run(program), "tail-calls"sv).rewritten, 2U);
+    // Миллион итераций без рекурсии. В Other метод count перекрыт, и twice вызывает его обычным образом
+    for (const auto backend : {vm::Backend::TreeWalker, vm::Backend::Bytecode}) {
+        ASSERT_EQUAL(Run(*program, backend), "half 1000000\n2000000 6 other 3\n20\n"s);
+    }
+    ASSERT_EQUAL(cache::Serialize(*program, {}), cache::Serialize(*Parse(source), {}));
+}
+
+}  // namespace
+
+void RunOptimizerTests(TestRunner& tr) {
+    RUN_TEST(tr, opt::TestFoldsConstants);
+    RUN_TEST(tr, opt::TestKeepsRuntimeErrors);
+    RUN_TEST(tr, opt::TestReplacesNegation);
+    RUN_TEST(tr, opt::TestRemovesDeadBranches);
+    RUN_TEST(tr, opt::TestRemovesCodeAfterReturn);
+    RUN_TEST(tr, opt::TestPassesCanBeDisabled);
+    RUN_TEST(tr, opt::TestPreservesBehaviour);
+    RUN_TEST(tr, opt::TestInlinesSmallMethods);
+    RUN_TEST(tr, opt::TestInlinesOnlySimpleMethods);
+    RUN_TEST(tr, opt::TestPlacesTemporariesInStackRegion);
+    RUN_TEST(tr, opt::TestEliminatesTailCalls);
+}
+
+}  // namespace opt
@@ -3,6 +3,10 @@
 #include "lexer.h"
 #include "statement.h"
 
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
 using namespace std;
 
 namespace TokenType = parse::token_type;
@@ -76,7 +80,19 @@ private:
             lexer_.ExpectNext<TokenType::Char>(':');
             lexer_.NextToken();
 
+            // Параметры занимают слоты 1..n в порядке объявления, self - слот 0
+            MethodScope scope;
+            for (const auto& param : m.formal_params) {
+                scope.slots.emplace(param, scope.size++);
+            }
+            scope.slots.emplace("self"s, 0);
+
+            auto outer_scope = std::exchange(method_scope_, std::move(scope));
+            const size_t outer_loop_depth = std::exchange(loop_depth_, 0);
             m.body = std::make_unique<ast::MethodBody>(ParseSuite());  // NOLINT
+            m.frame_size = method_scope_->size;
+            method_scope_ = std::move(outer_scope);
+            loop_depth_ = outer_loop_depth;
 
             result.push_back(std::move(m));
         }
@@ -86,19 +102,19 @@ private:
     // ClassDefinition -> Id ['(' Id ')'] : new_line indent MethodList dedent
     unique_ptr<ast::Statement> ParseClassDefinition()  // NOLINT
     {
-        string class_name = lexer_.Expect<TokenType::Id>().value;
+        const runtime::Symbol class_name = lexer_.Expect<TokenType::Id>().value;
 
         lexer_.NextToken();
 
         const runtime::Class* base_class = nullptr;
         if (lexer_.CurrentToken() == '(') {
-            auto name = lexer_.ExpectNext<TokenType::Id>().value;
+            const runtime::Symbol name = lexer_.ExpectNext<TokenType::Id>().value;
             lexer_.ExpectNext<TokenType::Char>(')');
             lexer_.NextToken();
 
             auto it = declared_classes_.find(name);
             if (it == declared_classes_.end()) {
-                throw ParseError("Base class "s + name + " not found for class "s + class_name);
+                throw ParseError("Base class "s + name.GetText() + " not found for class "s + class_name.GetText());
             }
             base_class = static_cast<const runtime::Class*>(it->second.Get());  // NOLINT
         }
@@ -118,14 +134,32 @@ private:
         });
 
         if (!inserted) {
-            throw ParseError("Class "s + class_name + " already exists"s);
+            throw ParseError("Class "s + class_name.GetText() + " already exists"s);
         }
 
         return make_unique<ast::ClassDefinition>(it->second);
     }
 
-    vector<string> ParseDottedIds() {
-        vector<string> result(1, lexer_.Expect<TokenType::Id>().value);
+    // Возвращает слот переменной разбираемого метода, назначая новый при первом упоминании имени.
+    // Вне методов переменные хранятся в Closure и слотов не имеют
+    size_t ResolveSlot(runtime::Symbol name) {
+        if (!method_scope_) {
+            return runtime::Frame::NO_SLOT;
+        }
+        auto [it, inserted] = method_scope_->slots.emplace(name, method_scope_->size);
+        if (inserted) {
+            ++method_scope_->size;
+        }
+        return it->second;
+    }
+
+    unique_ptr<ast::VariableValue> MakeVariable(vector<runtime::Symbol> dotted_ids) {
+        const size_t slot = ResolveSlot(dotted_ids.front());
+        return make_unique<ast::VariableValue>(std::move(dotted_ids), slot);
+    }
+
+    vector<runtime::Symbol> ParseDottedIds() {
+        vector<runtime::Symbol> result(1, lexer_.Expect<TokenType::Id>().value);
 
         while (lexer_.NextToken() == '.') {
             result.push_back(lexer_.ExpectNext<TokenType::Id>().value);
@@ -135,28 +169,46 @@ private:
     }
 
     //  AssgnOrCall -> DottedIds = Expr
+    //               | DottedIds ['[' Expr ']']+ = Expr
+    //               | DottedIds ['[' Expr ']']+ Trailers
     //               | DottedIds '(' ExprList ')'
     unique_ptr<ast::Statement> ParseAssignmentOrCall() {
         lexer_.Expect<TokenType::Id>();
 
-        vector<string> id_list = ParseDottedIds();
-        string last_name = id_list.back();
+        vector<runtime::Symbol> id_list = ParseDottedIds();
+        if (lexer_.CurrentToken() == '[') {
+            unique_ptr<ast::Statement> object = MakeVariable(std::move(id_list));
+            while (true) {
+                auto index = ParseSubscript();
+                if (lexer_.CurrentToken() == '=') {
+                    lexer_.NextToken();
+                    return make_unique<ast::IndexAssignment>(std::move(object), std::move(index), ParseTest());
+                }
+                object = make_unique<ast::Index>(std::move(object), std::move(index));
+                if (lexer_.CurrentToken() != '[') {
+                    return ParseTrailers(std::move(object));
+                }
+            }
+        }
+        const runtime::Symbol last_name = id_list.back();
         id_list.pop_back();
 
         if (lexer_.CurrentToken() == '=') {
             lexer_.NextToken();
 
             if (id_list.empty()) {
-                return make_unique<ast::Assignment>(std::move(last_name), ParseTest());
+                const size_t slot = ResolveSlot(last_name);
+                return make_unique<ast::Assignment>(last_name, slot, ParseTest());
             }
-            return make_unique<ast::FieldAssignment>(ast::VariableValue{std::move(id_list)},
-                                                     std::move(last_name), ParseTest());
+            const size_t slot = ResolveSlot(id_list.front());
+            return make_unique<ast::FieldAssignment>(ast::VariableValue{std::move(id_list), slot},
+                                                     last_name, ParseTest());
         }
         lexer_.Expect<TokenType::Char>('(');
         lexer_.NextToken();
 
         if (id_list.empty()) {
-            throw ParseError("Mython doesn't support functions, only methods: "s + last_name);
+            throw ParseError("Mython doesn't support functions, only methods: "s + last_name.GetText());
         }
 
         vector<unique_ptr<ast::Statement>> args;
@@ -166,8 +218,8 @@ private:
         lexer_.Expect<TokenType::Char>(')');
         lexer_.NextToken();
 
-        return make_unique<ast::MethodCall>(make_unique<ast::VariableValue>(std::move(id_list)),
-                                            std::move(last_name), std::move(args));
+        return make_unique<ast::MethodCall>(MakeVariable(std::move(id_list)), std::move(last_name),
+                                            std::move(args));
     }
 
     // Expr -> Adder ['+'/'-' Adder]*
@@ -204,16 +256,65 @@ private:
         return result;
     }
 
-    // Mult -> '(' Expr ')'
+    // Mult -> '-' Mult
+    //       | Atom Trailers
+    unique_ptr<ast::Statement> ParseMult()  // NOLINT
+    {
+        if (lexer_.CurrentToken() == '-') {
+            lexer_.NextToken();
+            // Отрицательная числовая константа не требует умножения во время исполнения
+            if (const auto* num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
+                int result = -num->value;
+                lexer_.NextToken();
+                return make_unique<ast::NumericConst>(result);
+            }
+            return make_unique<ast::Mult>(ParseMult(), make_unique<ast::NumericConst>(-1));
+        }
+        return ParseTrailers(ParseAtom());
+    }
+
+    // Trailers -> ['[' Expr ']' | '.' Id '(' ExprList ')']*
+    unique_ptr<ast::Statement> ParseTrailers(unique_ptr<ast::Statement> result) {
+        while (true) {
+            if (lexer_.CurrentToken() == '[') {
+                result = make_unique<ast::Index>(std::move(result), ParseSubscript());
+            } else if (lexer_.CurrentToken() == '.') {
+                const runtime::Symbol method = lexer_.ExpectNext<TokenType::Id>().value;
+                lexer_.ExpectNext<TokenType::Char>('(');
+                vector<unique_ptr<ast::Statement>> args;
+                if (lexer_.NextToken() != ')') {
+                    args = ParseTestList();
+                }
+                lexer_.Expect<TokenType::Char>(')');
+                lexer_.NextToken();
+                result = make_unique<ast::MethodCall>(std::move(result), method, std::move(args));
+            } else {
+                return result;
+            }
+        }
+    }
+
+    // '[' Expr ']'
+    unique_ptr<ast::Statement> ParseSubscript() {
+        lexer_.Expect<TokenType::Char>('[');
+        lexer_.NextToken();
+        auto index = ParseTest();
+        lexer_.Expect<TokenType::Char>(']');
+        lexer_.NextToken();
+        return index;
+    }
+
+    // Atom -> '(' Expr ')'
+    //       | '[' [ExprList] ']'
+    //       | '{' [Expr ':' Expr [',' Expr ':' Expr]*] '}'
     //       | NUMBER
-    //       | '-' Mult
     //       | STRING
     //       | NONE
     //       | TRUE
     //       | FALSE
     //       | DottedIds '(' ExprList ')'
     //       | DottedIds
-    unique_ptr<ast::Statement> ParseMult()  // NOLINT
+    unique_ptr<ast::Statement> ParseAtom()  // NOLINT
     {
         if (lexer_.CurrentToken() == '(') {
             lexer_.NextToken();
@@ -222,9 +323,33 @@ private:
             lexer_.NextToken();
             return result;
         }
-        if (lexer_.CurrentToken() == '-') {
+        if (lexer_.CurrentToken() == '[') {
+            vector<unique_ptr<ast::Statement>> items;
+            if (lexer_.NextToken() != ']') {
+                items = ParseTestList();
+            }
+            lexer_.Expect<TokenType::Char>(']');
             lexer_.NextToken();
-            return make_unique<ast::Mult>(ParseMult(), make_unique<ast::NumericConst>(-1));
+            return make_unique<ast::ListLiteral>(std::move(items));
+        }
+        if (lexer_.CurrentToken() == '{') {
+            vector<unique_ptr<ast::Statement>> keys;
+            vector<unique_ptr<ast::Statement>> values;
+            if (lexer_.NextToken() != '}') {
+                while (true) {
+                    keys.push_back(ParseTest());
+                    lexer_.Expect<TokenType::Char>(':');
+                    lexer_.NextToken();
+                    values.push_back(ParseTest());
+                    if (lexer_.CurrentToken() != ',') {
+                        break;
+                    }
+                    lexer_.NextToken();
+                }
+            }
+            lexer_.Expect<TokenType::Char>('}');
+            lexer_.NextToken();
+            return make_unique<ast::DictLiteral>(std::move(keys), std::move(values));
         }
         if (const auto* num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
             int result = num->value;
@@ -253,7 +378,7 @@ private:
     }
 
     std::unique_ptr<ast::Statement> ParseDottedIdsInMultExpr() {
-        vector<string> names = ParseDottedIds();
+        vector<runtime::Symbol> names = ParseDottedIds();
 
         if (lexer_.CurrentToken() == '(') {
             // various calls
@@ -268,9 +393,8 @@ private:
             names.pop_back();
 
             if (!names.empty()) {
-                return make_unique<ast::MethodCall>(
-                    make_unique<ast::VariableValue>(std::move(names)), std::move(method_name),
-                    std::move(args));
+                return make_unique<ast::MethodCall>(MakeVariable(std::move(names)),
+                                                    method_name, std::move(args));
             }
             if (auto it = declared_classes_.find(method_name); it != declared_classes_.end()) {
                 return make_unique<ast::NewInstance>(
@@ -282,9 +406,15 @@ private:
                 }
                 return make_unique<ast::Stringify>(std::move(args.front()));
             }
-            throw ParseError("Unknown call to "s + method_name + "()"s);
+            if (method_name == "len"sv) {
+                if (args.size() != 1) {
+                    throw ParseError("Function len takes exactly one argument"s);
+                }
+                return make_unique<ast::Length>(std::move(args.front()));
+            }
+            throw ParseError("Unknown call to "s + method_name.GetText() + "()"s);
         }
-        return make_unique<ast::VariableValue>(std::move(names));
+        return MakeVariable(std::move(names));
     }
 
     vector<unique_ptr<ast::Statement>> ParseTestList()  // NOLINT
@@ -323,6 +453,65 @@ private:
                                         std::move(else_body));
     }
 
+    // While -> while LogicalExpr: Suite
+    unique_ptr<ast::Statement> ParseWhile()  // NOLINT
+    {
+        lexer_.Expect<TokenType::While>();
+        lexer_.NextToken();
+
+        auto condition = ParseTest();
+
+        lexer_.Expect<TokenType::Char>(':');
+        lexer_.NextToken();
+
+        return make_unique<ast::While>(std::move(condition), ParseLoopBody());
+    }
+
+    // For -> for Id in range '(' [Expr ,] Expr ')' : Suite
+    //      | for Id in Expr : Suite
+    unique_ptr<ast::Statement> ParseFor()  // NOLINT
+    {
+        lexer_.Expect<TokenType::For>();
+        const runtime::Symbol var = lexer_.ExpectNext<TokenType::Id>().value;
+        lexer_.ExpectNext<TokenType::In>();
+        lexer_.NextToken();
+        const auto* range = lexer_.CurrentToken().TryAs<TokenType::Id>();
+        if (range == nullptr || range->value != "range"sv) {
+            auto iterable = ParseTest();
+            lexer_.Expect<TokenType::Char>(':');
+            lexer_.NextToken();
+            const size_t slot = ResolveSlot(var);
+            return make_unique<ast::ForEach>(var, slot, std::move(iterable), ParseLoopBody());
+        }
+        lexer_.ExpectNext<TokenType::Char>('(');
+        lexer_.NextToken();
+
+        auto bounds = ParseTestList();
+        if (bounds.size() > 2) {
+            throw ParseError("Function range takes one or two arguments"s);
+        }
+        // range(end) перебирает числа от 0
+        if (bounds.size() == 1) {
+            bounds.insert(bounds.begin(), make_unique<ast::NumericConst>(0));
+        }
+
+        lexer_.Expect<TokenType::Char>(')');
+        lexer_.ExpectNext<TokenType::Char>(':');
+        lexer_.NextToken();
+
+        const size_t slot = ResolveSlot(var);
+        return make_unique<ast::ForRange>(var, slot, std::move(bounds[0]), std::move(bounds[1]),
+                                          ParseLoopBody());
+    }
+
+    unique_ptr<ast::Statement> ParseLoopBody()  // NOLINT
+    {
+        ++loop_depth_;
+        auto body = ParseSuite();
+        --loop_depth_;
+        return body;
+    }
+
     // LogicalExpr -> AndTest [OR AndTest]
     // AndTest -> NotTest [AND NotTest]
     // NotTest -> [NOT] NotTest
@@ -357,6 +546,7 @@ private:
     }
 
     // Comparison -> Expr [COMP_OP Expr]
+    //             | Expr [NOT] IN Expr
     unique_ptr<ast::Statement> ParseComparison()  // NOLINT
     {
         auto result = ParseExpression();
@@ -365,33 +555,37 @@ private:
 
         if (tok == '<') {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Less, std::move(result),
-                                                ParseExpression());
+            return make_unique<ast::Comparison<ast::Comparator::Less>>(std::move(result), ParseExpression());
         }
         if (tok == '>') {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Greater, std::move(result),
-                                                ParseExpression());
+            return make_unique<ast::Comparison<ast::Comparator::Greater>>(std::move(result), ParseExpression());
         }
         if (tok.Is<TokenType::Eq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Equal, std::move(result),
-                                                ParseExpression());
+            return make_unique<ast::Comparison<ast::Comparator::Equal>>(std::move(result), ParseExpression());
         }
         if (tok.Is<TokenType::NotEq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::NotEqual, std::move(result),
-                                                ParseExpression());
+            return make_unique<ast::Comparison<ast::Comparator::NotEqual>>(std::move(result), ParseExpression());
         }
         if (tok.Is<TokenType::LessOrEq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::LessOrEqual, std::move(result),
-                                                ParseExpression());
+            return make_unique<ast::Comparison<ast::Comparator::LessOrEqual>>(std::move(result), ParseExpression());
         }
         if (tok.Is<TokenType::GreaterOrEq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::GreaterOrEqual, std::move(result),
-                                                ParseExpression());
+            return make_unique<ast::Comparison<ast::Comparator::GreaterOrEqual>>(std::move(result), ParseExpression());
+        }
+        if (tok.Is<TokenType::In>()) {
+            lexer_.NextToken();
+            return make_unique<ast::Contains>(std::move(result), ParseExpression());
+        }
+        if (tok.Is<TokenType::Not>()) {
+            lexer_.NextToken();
+            lexer_.Expect<TokenType::In>();
+            lexer_.NextToken();
+            return make_unique<ast::Not>(make_unique<ast::Contains>(std::move(result), ParseExpression()));
         }
         return result;
     }
@@ -399,6 +593,8 @@ private:
     // Statement -> SimpleStatement Newline
     //           | class ClassDefinition
     //           | if Condition
+    //           | while While
+    //           | for For
     unique_ptr<ast::Statement> ParseStatement()  // NOLINT
     {
         const auto& tok = lexer_.CurrentToken();
@@ -410,6 +606,12 @@ private:
         if (tok.Is<TokenType::If>()) {
             return ParseCondition();
         }
+        if (tok.Is<TokenType::While>()) {
+            return ParseWhile();
+        }
+        if (tok.Is<TokenType::For>()) {
+            return ParseFor();
+        }
         auto result = ParseSimpleStatement();
         lexer_.Expect<TokenType::Newline>();
         lexer_.NextToken();
@@ -418,10 +620,23 @@ private:
 
     // StatementBody -> return Expression
     //               | print ExpressionList
+    //               | break
+    //               | continue
     //               | AssignmentOrCall
     unique_ptr<ast::Statement> ParseSimpleStatement() {
         const auto& tok = lexer_.CurrentToken();
 
+        if (tok.Is<TokenType::Break>() || tok.Is<TokenType::Continue>()) {
+            const bool is_break = tok.Is<TokenType::Break>();
+            if (loop_depth_ == 0) {
+                throw ParseError(is_break ? "'break' outside loop"s : "'continue' not properly in loop"s);
+            }
+            lexer_.NextToken();
+            if (is_break) {
+                return make_unique<ast::Break>();
+            }
+            return make_unique<ast::Continue>();
+        }
         if (tok.Is<TokenType::Return>()) {
             lexer_.NextToken();
             return make_unique<ast::Return>(ParseTest());
@@ -437,8 +652,17 @@ private:
         return ParseAssignmentOrCall();
     }
 
+    // Слоты параметров и локальных переменных метода
+    struct MethodScope {
+        unordered_map<runtime::Symbol, size_t> slots;
+        size_t size = 1;
+    };
+
     parse::Lexer& lexer_;
     runtime::Closure declared_classes_;
+    optional<MethodScope> method_scope_;
+    // Число циклов, в которые вложена разбираемая инструкция текущего метода либо программы
+    size_t loop_depth_ = 0;
 };
 
 }  // namespace
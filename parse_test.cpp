@@ -173,6 +173,52 @@ print x.call_count
     ASSERT_EQUAL(context.output.str(), "17\n1\n115\n"s);
 }
 
+void TestMethodLocals() {
+    const string program = R"(
+x = "global"
+
+class Locals:
+  def __init__(x):
+    self.x = x
+
+  def shadow(x):
+    y = x + 1
+    x = y * 2
+    return x
+
+  def swap(a, b):
+    tmp = a
+    a = b
+    b = tmp
+    return str(a) + str(b)
+
+  def read_global():
+    return x
+
+obj = Locals(5)
+print obj.shadow(1), obj.shadow(10), obj.x, x
+print obj.swap(1, 2)
+)"s;
+
+    runtime::DummyContext context;
+
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(), "4 22 5 global\n21\n"s);
+
+    // Глобальные переменные внутри методов не видны
+    ASSERT_THROWS(ParseProgramFromString("class A:\n  def f():\n    return x\nx = 1\nprint A().f()\n"s)
+                      ->Execute(closure, context),
+                  std::runtime_error);
+    // Локальная переменная, которой ещё не присвоено значение
+    ASSERT_THROWS(
+        ParseProgramFromString("class A:\n  def f(c):\n    if c:\n      y = 1\n    return y\nprint A().f(0)\n"s)
+            ->Execute(closure, context),
+        std::runtime_error);
+}
+
 void TestComplexLogicalExpression() {
     const string program = R"(
 a = 1
@@ -244,6 +290,44 @@ print r, c, t1, t2
                  "Rect(10x20) Circle(52) Triangle(3, 4, 5) Wrong triangle\n"s);
 }
 
+void TestLoops() {
+    const string program = R"(
+class Primes:
+  def count(n):
+    found = 0
+    for i in range(2, n):
+      d = 2
+      prime = True
+      while d * d <= i:
+        if i - i / d * d == 0:
+          prime = False
+          break
+        d = d + 1
+      if not prime:
+        continue
+      found = found + 1
+    return found
+
+total = 0
+for i in range(5):
+  total = total + i
+p = Primes()
+print total, i, p.count(30)
+)"s;
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "10 4 10\n"s);
+
+    ASSERT_THROWS(ParseProgramFromString("break\n"s), ParseError);
+    ASSERT_THROWS(ParseProgramFromString("while True:\n  x = 1\ncontinue\n"s), ParseError);
+    // Цикл вне метода не делает break допустимым в теле метода
+    ASSERT_THROWS(ParseProgramFromString("while True:\n  class A:\n    def f():\n      break\n"s), ParseError);
+    ASSERT_THROWS(ParseProgramFromString("for i in range(1, 2, 3):\n  print i\n"s), ParseError);
+}
+
 }  // namespace parse
 
 void TestParseProgram(TestRunner& tr) {
@@ -253,6 +337,8 @@ void TestParseProgram(TestRunner& tr) {
     RUN_TEST(tr, parse::TestReturnFromIf);
     RUN_TEST(tr, parse::TestRecursion);
     RUN_TEST(tr, parse::TestRecursion2);
+    RUN_TEST(tr, parse::TestMethodLocals);
     RUN_TEST(tr, parse::TestComplexLogicalExpression);
     RUN_TEST(tr, parse::TestClassicalPolymorphism);
+    RUN_TEST(tr, parse::TestLoops);
 }
\ No newline at end of file
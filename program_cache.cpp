@@ -0,0 +1,734 @@
+#include "program_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <system_error>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MYTHON_CACHE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cache
+  {
+    using namespace std::literals;
+
+    namespace
+      {
+        constexpr std::string_view MAGIC = "MYTHONC\n"sv;
+
+        // Узлы дерева разбора. Номера входят в формат: новые узлы добавляются только в конец
+        enum class Tag : std::uint8_t {
+          Null,
+          Compound,
+          MethodBody,
+          Return,
+          IfElse,
+          Assignment,
+          FieldAssignment,
+          ClassDefinition,
+          Print,
+          Number,
+          String,
+          Bool,
+          None,
+          Variable,
+          MethodCall,
+          NewInstance,
+          Stringify,
+          Not,
+          Or,
+          And,
+          Add,
+          Sub,
+          Mult,
+          Div,
+          Equal,
+          NotEqual,
+          Less,
+          Greater,
+          LessOrEqual,
+          GreaterOrEqual,
+          Negate,
+          While,
+          ForRange,
+          Break,
+          Continue,
+          List,
+          Index,
+          IndexAssignment,
+          Length,
+          ForEach,
+          Dict,
+          Contains,
+        };
+
+        std::uint64_t Fnv1a(std::string_view data) {
+          std::uint64_t hash = 14695981039346656037ULL;
+          for (const char c: data) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+          }
+          return hash;
+        }
+
+        template<typename T>
+        const T *NodeAs(const ast::Statement &node) {
+          return dynamic_cast<const T *>(&node);
+        }
+
+        template<ast::Comparator cmp>
+        bool IsComparison(const ast::Statement &node) {
+          return NodeAs<ast::Comparison<cmp>>(node) != nullptr;
+        }
+
+        // Читает данные, записанные ProgramWriter. Любой выход за границы данных - CacheError
+        class ProgramReader {
+         public:
+          explicit ProgramReader(std::string_view data)
+              : data_(data) {
+          }
+
+          std::unique_ptr<ast::Statement> ReadStatement() {
+            const auto tag = static_cast<Tag>(ReadByte());
+            switch (tag) {
+              case Tag::Null:
+                return nullptr;
+              case Tag::Compound: {
+                auto result = std::make_unique<ast::Compound>();
+                for (auto &statement: ReadStatements()) {
+                  result->AddStatement(std::move(statement));
+                }
+                return result;
+              }
+              case Tag::MethodBody:
+                return std::make_unique<ast::MethodBody>(ReadRequired());
+              case Tag::Return:
+                return std::make_unique<ast::Return>(ReadRequired());
+              case Tag::IfElse: {
+                auto condition = ReadRequired();
+                auto if_body = ReadRequired();
+                return std::make_unique<ast::IfElse>(std::move(condition), std::move(if_body), ReadStatement());
+              }
+              case Tag::Assignment: {
+                const auto var = ReadSymbol();
+                const auto slot = ReadSlot();
+                return std::make_unique<ast::Assignment>(var, slot, ReadRequired());
+              }
+              case Tag::FieldAssignment: {
+                auto object = ReadVariable();
+                const auto field = ReadSymbol();
+                return std::make_unique<ast::FieldAssignment>(std::move(object), field, ReadRequired());
+              }
+              case Tag::ClassDefinition:
+                return std::make_unique<ast::ClassDefinition>(ReadClass());
+              case Tag::Print:
+                return std::make_unique<ast::Print>(ReadStatements());
+              case Tag::Number:
+                return std::make_unique<ast::NumericConst>(runtime::Number(static_cast<int>(ReadInt())));
+              case Tag::String:
+                return std::make_unique<ast::StringConst>(runtime::String(ReadString()));
+              case Tag::Bool:
+                return std::make_unique<ast::BoolConst>(runtime::Bool(ReadByte() != 0));
+              case Tag::None:
+                return std::make_unique<ast::None>();
+              case Tag::Variable:
+                return std::make_unique<ast::VariableValue>(ReadVariable());
+              case Tag::While: {
+                auto condition = ReadRequired();
+                return std::make_unique<ast::While>(std::move(condition), ReadRequired());
+              }
+              case Tag::ForRange: {
+                const auto var = ReadSymbol();
+                const auto slot = ReadSlot();
+                auto begin = ReadRequired();
+                auto end = ReadRequired();
+                return std::make_unique<ast::ForRange>(var, slot, std::move(begin), std::move(end),
+                                                       ReadRequired());
+              }
+              case Tag::ForEach: {
+                const auto var = ReadSymbol();
+                const auto slot = ReadSlot();
+                auto iterable = ReadRequired();
+                return std::make_unique<ast::ForEach>(var, slot, std::move(iterable), ReadRequired());
+              }
+              case Tag::List:
+                return std::make_unique<ast::ListLiteral>(ReadStatements());
+              case Tag::Index: {
+                auto object = ReadRequired();
+                return std::make_unique<ast::Index>(std::move(object), ReadRequired());
+              }
+              case Tag::IndexAssignment: {
+                auto object = ReadRequired();
+                auto index = ReadRequired();
+                return std::make_unique<ast::IndexAssignment>(std::move(object), std::move(index), ReadRequired());
+              }
+              case Tag::Length:
+                return std::make_unique<ast::Length>(ReadRequired());
+              case Tag::Dict: {
+                auto keys = ReadStatements();
+                return std::make_unique<ast::DictLiteral>(std::move(keys), ReadStatements());
+              }
+              case Tag::Contains:
+                return ReadBinary<ast::Contains>();
+              case Tag::Break:
+                return std::make_unique<ast::Break>();
+              case Tag::Continue:
+                return std::make_unique<ast::Continue>();
+              case Tag::MethodCall: {
+                auto object = ReadRequired();
+                const auto method = ReadSymbol();
+                return std::make_unique<ast::MethodCall>(std::move(object), method, ReadStatements());
+              }
+              case Tag::NewInstance: {
+                const auto &cls = ReadClassReference();
+                return std::make_unique<ast::NewInstance>(cls, ReadStatements());
+              }
+              case Tag::Stringify:
+                return std::make_unique<ast::Stringify>(ReadRequired());
+              case Tag::Not:
+                return std::make_unique<ast::Not>(ReadRequired());
+              case Tag::Negate:
+                return std::make_unique<ast::Negate>(ReadRequired());
+              case Tag::Or:
+                return ReadBinary<ast::Or>();
+              case Tag::And:
+                return ReadBinary<ast::And>();
+              case Tag::Add:
+                return ReadBinary<ast::Add>();
+              case Tag::Sub:
+                return ReadBinary<ast::Sub>();
+              case Tag::Mult:
+                return ReadBinary<ast::Mult>();
+              case Tag::Div:
+                return ReadBinary<ast::Div>();
+              case Tag::Equal:
+                return ReadBinary<ast::Comparison<ast::Comparator::Equal>>();
+              case Tag::NotEqual:
+                return ReadBinary<ast::Comparison<ast::Comparator::NotEqual>>();
+              case Tag::Less:
+                return ReadBinary<ast::Comparison<ast::Comparator::Less>>();
+              case Tag::Greater:
+                return ReadBinary<ast::Comparison<ast::Comparator::Greater>>();
+              case Tag::LessOrEqual:
+                return ReadBinary<ast::Comparison<ast::Comparator::LessOrEqual>>();
+              case Tag::GreaterOrEqual:
+                return ReadBinary<ast::Comparison<ast::Comparator::GreaterOrEqual>>();
+            }
+            throw CacheError("unknown node tag"s);
+          }
+
+          std::uint64_t ReadInt() {
+            std::uint64_t result = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+              const auto byte = ReadByte();
+              // Десятый байт содержит лишь старший бит числа
+              if (shift == 63 && byte > 1) {
+                break;
+              }
+              result |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+              if ((byte & 0x80) == 0) {
+                return result;
+              }
+            }
+            throw CacheError("malformed integer"s);
+          }
+
+          std::string_view ReadBytes(std::uint64_t size) {
+            if (size > data_.size() - position_) {
+              throw CacheError("unexpected end of data"s);
+            }
+            const auto result = data_.substr(position_, static_cast<std::size_t>(size));
+            position_ += static_cast<std::size_t>(size);
+            return result;
+          }
+
+          [[nodiscard]] bool AtEnd() const {
+            return position_ == data_.size();
+          }
+
+         private:
+          std::uint8_t ReadByte() {
+            return static_cast<std::uint8_t>(ReadBytes(1).front());
+          }
+
+          // Число элементов: каждый элемент занимает хотя бы байт, поэтому оно не превышает остаток данных
+          std::size_t ReadCount() {
+            const auto count = ReadInt();
+            if (count > data_.size() - position_) {
+              throw CacheError("unexpected end of data"s);
+            }
+            return static_cast<std::size_t>(count);
+          }
+
+          std::string ReadString() {
+            return std::string(ReadBytes(ReadInt()));
+          }
+
+          // Имена интернируются прямо из данных кэша, без промежуточной строки
+          runtime::Symbol ReadSymbol() {
+            return runtime::Symbol(ReadBytes(ReadInt()));
+          }
+
+          std::unique_ptr<ast::Statement> ReadRequired() {
+            auto result = ReadStatement();
+            if (!result) {
+              throw CacheError("missing node"s);
+            }
+            return result;
+          }
+
+          std::vector<std::unique_ptr<ast::Statement>> ReadStatements() {
+            const auto count = ReadCount();
+            std::vector<std::unique_ptr<ast::Statement>> result;
+            for (std::size_t i = 0; i < count; ++i) {
+              result.push_back(ReadRequired());
+            }
+            return result;
+          }
+
+          template<typename Operation>
+          std::unique_ptr<ast::Statement> ReadBinary() {
+            auto lhs = ReadRequired();
+            return std::make_unique<Operation>(std::move(lhs), ReadRequired());
+          }
+
+          // Слот переменной: NO_SLOT либо слот кадра метода, тело которого читается. Иначе повреждённые
+          // данные с верной контрольной суммой привели бы к обращению за пределы кадра или регистров VM
+          std::size_t ReadSlot() {
+            const auto slot = ReadInt();
+            if (slot != runtime::Frame::NO_SLOT && slot >= frame_size_) {
+              throw CacheError("invalid variable slot"s);
+            }
+            return static_cast<std::size_t>(slot);
+          }
+
+          ast::VariableValue ReadVariable() {
+            std::vector<runtime::Symbol> dotted_ids(ReadCount());
+            if (dotted_ids.empty()) {
+              throw CacheError("empty variable name"s);
+            }
+            for (auto &id: dotted_ids) {
+              id = ReadSymbol();
+            }
+            return ast::VariableValue(std::move(dotted_ids), ReadSlot());
+          }
+
+          runtime::ObjectHolder ReadClass() {
+            auto name = ReadString();
+            const runtime::Class *parent = nullptr;
+            if (ReadByte() != 0) {
+              parent = &ReadClassReference();
+            }
+            std::vector<runtime::Method> methods(ReadCount());
+            for (auto &method: methods) {
+              method.name = ReadSymbol();
+              method.formal_params.resize(ReadCount());
+              for (auto &param: method.formal_params) {
+                param = ReadSymbol();
+              }
+              method.frame_size = static_cast<std::size_t>(ReadInt());
+              // Слоты переменных тела проверяются по размеру кадра метода
+              const auto frame_size = std::exchange(frame_size_, method.frame_size);
+              method.body = ReadRequired();
+              frame_size_ = frame_size;
+            }
+            classes_.push_back(runtime::ObjectHolder::Own(runtime::Class(std::move(name), std::move(methods), parent)));
+            return classes_.back();
+          }
+
+          const runtime::Class &ReadClassReference() {
+            const auto index = ReadInt();
+            if (index >= classes_.size()) {
+              throw CacheError("unknown class"s);
+            }
+            return classes_[static_cast<std::size_t>(index)].As<runtime::Class>();
+          }
+
+          std::string_view data_;
+          std::size_t position_ = 0;
+          // Прочитанные классы в порядке определения
+          std::vector<runtime::ObjectHolder> classes_;
+          // Размер кадра метода, тело которого читается; вне методов кадра нет
+          std::size_t frame_size_ = 0;
+        };
+
+        // Файл, отображённый в память только для чтения
+        class MappedFile {
+         public:
+          explicit MappedFile(const std::filesystem::path &path) {
+#ifdef MYTHON_CACHE_MMAP
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+              return;
+            }
+            struct stat info{};
+            if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+              void *data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+              if (data != MAP_FAILED) {
+                data_ = static_cast<const char *>(data);
+                size_ = static_cast<std::size_t>(info.st_size);
+              }
+            }
+            ::close(fd);
+#else
+            std::ifstream input(path, std::ios::binary);
+            buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+            data_ = buffer_.data();
+            size_ = buffer_.size();
+#endif
+          }
+
+          MappedFile(const MappedFile &) = delete;
+          MappedFile &operator=(const MappedFile &) = delete;
+
+          ~MappedFile() {
+#ifdef MYTHON_CACHE_MMAP
+            if (data_ != nullptr) {
+              ::munmap(const_cast<char *>(data_), size_);
+            }
+#endif
+          }
+
+          [[nodiscard]] std::string_view Data() const {
+            return data_ != nullptr ? std::string_view(data_, size_) : std::string_view();
+          }
+
+         private:
+          const char *data_ = nullptr;
+          std::size_t size_ = 0;
+#ifndef MYTHON_CACHE_MMAP
+          std::string buffer_;
+#endif
+        };
+      }  // namespace
+
+    std::uint64_t HashSource(std::string_view source) {
+      return Fnv1a(source);
+    }
+
+    std::filesystem::path CachePath(const std::filesystem::path &directory, std::string_view source) {
+      char name[32];
+      std::snprintf(name, sizeof(name), "%016llx.mythonc", static_cast<unsigned long long>(HashSource(source)));
+      return directory / name;
+    }
+
+    ProgramWriter::ProgramWriter(std::string &output)
+        : output_(output) {
+    }
+
+    void ProgramWriter::WriteStatement(const ast::Statement &node) {
+      if (const auto *compound = NodeAs<ast::Compound>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Compound));
+        WriteStatements(compound->statements_);
+      } else if (const auto *method_body = NodeAs<ast::MethodBody>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::MethodBody));
+        WriteOptional(method_body->body_);
+      } else if (const auto *ret = NodeAs<ast::Return>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Return));
+        WriteOptional(ret->statement_);
+      } else if (const auto *if_else = NodeAs<ast::IfElse>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::IfElse));
+        WriteOptional(if_else->condition_);
+        WriteOptional(if_else->if_body_);
+        WriteOptional(if_else->else_body_);
+      } else if (const auto *while_loop = NodeAs<ast::While>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::While));
+        WriteOptional(while_loop->condition_);
+        WriteOptional(while_loop->body_);
+      } else if (const auto *for_loop = NodeAs<ast::ForRange>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::ForRange));
+        WriteString(for_loop->var_);
+        WriteInt(for_loop->slot_);
+        WriteOptional(for_loop->begin_);
+        WriteOptional(for_loop->end_);
+        WriteOptional(for_loop->body_);
+      } else if (const auto *for_each = NodeAs<ast::ForEach>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::ForEach));
+        WriteString(for_each->var_);
+        WriteInt(for_each->slot_);
+        WriteOptional(for_each->iterable_);
+        WriteOptional(for_each->body_);
+      } else if (NodeAs<ast::Break>(node) != nullptr) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Break));
+      } else if (NodeAs<ast::Continue>(node) != nullptr) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Continue));
+      } else if (const auto *assignment = NodeAs<ast::Assignment>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Assignment));
+        WriteString(assignment->var_);
+        WriteInt(assignment->slot_);
+        WriteOptional(assignment->rv_);
+      } else if (const auto *field_assignment = NodeAs<ast::FieldAssignment>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::FieldAssignment));
+        WriteVariable(field_assignment->object_);
+        WriteString(field_assignment->field_name_);
+        WriteOptional(field_assignment->rv_);
+      } else if (const auto *index_assignment = NodeAs<ast::IndexAssignment>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::IndexAssignment));
+        WriteOptional(index_assignment->object_);
+        WriteOptional(index_assignment->index_);
+        WriteOptional(index_assignment->rv_);
+      } else if (const auto *class_definition = NodeAs<ast::ClassDefinition>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::ClassDefinition));
+        WriteClass(class_definition->cls_.As<runtime::Class>());
+      } else if (const auto *scope = NodeAs<ast::StackScope>(node)) {
+        // Область временных значений создаёт оптимизатор, в кэш записывается исходное дерево
+        WriteStatement(*scope->body_);
+      } else if (const auto *print = NodeAs<ast::Print>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Print));
+        WriteStatements(print->args_);
+      } else if (const auto *number = NodeAs<ast::NumericConst>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Number));
+        WriteInt(static_cast<std::uint64_t>(static_cast<std::int64_t>(number->value_.GetValue())));
+      } else if (const auto *str = NodeAs<ast::StringConst>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::String));
+        WriteString(str->value_.GetValue());
+      } else if (const auto *boolean = NodeAs<ast::BoolConst>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Bool));
+        WriteTag(boolean->value_.GetValue() ? 1 : 0);
+      } else if (NodeAs<ast::None>(node) != nullptr) {
+        WriteTag(static_cast<std::uint8_t>(Tag::None));
+      } else if (const auto *variable = NodeAs<ast::VariableValue>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Variable));
+        WriteVariable(*variable);
+      } else if (const auto *method_call = NodeAs<ast::MethodCall>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::MethodCall));
+        WriteOptional(method_call->object_);
+        WriteString(method_call->method_name_);
+        WriteStatements(method_call->args_);
+      } else if (const auto *new_instance = NodeAs<ast::NewInstance>(node)) {
+        const auto it = std::find(classes_.begin(), classes_.end(), &new_instance->cls_.GetClass());
+        if (it == classes_.end()) {
+          throw CacheError("instance of an undefined class"s);
+        }
+        WriteTag(static_cast<std::uint8_t>(Tag::NewInstance));
+        WriteInt(static_cast<std::uint64_t>(it - classes_.begin()));
+        WriteStatements(new_instance->args_);
+      } else if (const auto *stringify = NodeAs<ast::Stringify>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Stringify));
+        WriteOptional(stringify->argument_);
+      } else if (const auto *not_node = NodeAs<ast::Not>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Not));
+        WriteOptional(not_node->argument_);
+      } else if (const auto *negate = NodeAs<ast::Negate>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Negate));
+        WriteOptional(negate->argument_);
+      } else if (const auto *length = NodeAs<ast::Length>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Length));
+        WriteOptional(length->argument_);
+      } else if (const auto *list = NodeAs<ast::ListLiteral>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::List));
+        WriteStatements(list->items_);
+      } else if (const auto *dict = NodeAs<ast::DictLiteral>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Dict));
+        WriteStatements(dict->keys_);
+        WriteStatements(dict->values_);
+      } else if (const auto *index = NodeAs<ast::Index>(node)) {
+        WriteTag(static_cast<std::uint8_t>(Tag::Index));
+        WriteOptional(index->object_);
+        WriteOptional(index->index_);
+      } else if (const auto *binary = NodeAs<ast::BinaryOperation>(node)) {
+        using ast::Comparator;
+        Tag tag;
+        if (NodeAs<ast::Or>(node) != nullptr) {
+          tag = Tag::Or;
+        } else if (NodeAs<ast::And>(node) != nullptr) {
+          tag = Tag::And;
+        } else if (NodeAs<ast::Add>(node) != nullptr) {
+          tag = Tag::Add;
+        } else if (NodeAs<ast::Sub>(node) != nullptr) {
+          tag = Tag::Sub;
+        } else if (NodeAs<ast::Mult>(node) != nullptr) {
+          tag = Tag::Mult;
+        } else if (NodeAs<ast::Div>(node) != nullptr) {
+          tag = Tag::Div;
+        } else if (NodeAs<ast::Contains>(node) != nullptr) {
+          tag = Tag::Contains;
+        } else if (IsComparison<Comparator::Equal>(node)) {
+          tag = Tag::Equal;
+        } else if (IsComparison<Comparator::NotEqual>(node)) {
+          tag = Tag::NotEqual;
+        } else if (IsComparison<Comparator::Less>(node)) {
+          tag = Tag::Less;
+        } else if (IsComparison<Comparator::Greater>(node)) {
+          tag = Tag::Greater;
+        } else if (IsComparison<Comparator::LessOrEqual>(node)) {
+          tag = Tag::LessOrEqual;
+        } else if (IsComparison<Comparator::GreaterOrEqual>(node)) {
+          tag = Tag::GreaterOrEqual;
+        } else {
+          throw CacheError("unsupported statement"s);
+        }
+        WriteTag(static_cast<std::uint8_t>(tag));
+        WriteOptional(binary->lhs_);
+        WriteOptional(binary->rhs_);
+      } else {
+        throw CacheError("unsupported statement"s);
+      }
+    }
+
+    void ProgramWriter::WriteClass(const runtime::Class &cls) {
+      WriteString(cls.GetName());
+      if (const auto *parent = cls.GetParent()) {
+        const auto it = std::find(classes_.begin(), classes_.end(), parent);
+        if (it == classes_.end()) {
+          throw CacheError("undefined parent class"s);
+        }
+        WriteTag(1);
+        WriteInt(static_cast<std::uint64_t>(it - classes_.begin()));
+      } else {
+        WriteTag(0);
+      }
+      WriteInt(cls.GetMethods().size());
+      for (const auto &method: cls.GetMethods()) {
+        WriteString(method.name);
+        WriteInt(method.formal_params.size());
+        for (const auto &param: method.formal_params) {
+          WriteString(param);
+        }
+        WriteInt(method.frame_size);
+        WriteOptional(method.body);
+      }
+      // Методы класса могут создавать экземпляры только ранее определённых классов
+      classes_.push_back(&cls);
+    }
+
+    void ProgramWriter::WriteVariable(const ast::VariableValue &node) {
+      WriteInt(node.dotted_ids_.size());
+      for (const auto &id: node.dotted_ids_) {
+        WriteString(id);
+      }
+      WriteInt(node.slot_);
+    }
+
+    void ProgramWriter::WriteStatements(const std::vector<std::unique_ptr<ast::Statement>> &statements) {
+      WriteInt(statements.size());
+      for (const auto &statement: statements) {
+        if (!statement) {
+          throw CacheError("null statements are not supported"s);
+        }
+        WriteStatement(*statement);
+      }
+    }
+
+    void ProgramWriter::WriteOptional(const std::unique_ptr<ast::Statement> &node) {
+      if (node) {
+        WriteStatement(*node);
+      } else {
+        WriteTag(static_cast<std::uint8_t>(Tag::Null));
+      }
+    }
+
+    void ProgramWriter::WriteTag(std::uint8_t tag) {
+      output_.push_back(static_cast<char>(tag));
+    }
+
+    // Целые числа записываются в формате LEB128: по 7 бит в байте, старший бит - признак продолжения
+    void ProgramWriter::WriteInt(std::uint64_t value) {
+      while (value >= 0x80) {
+        output_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+      }
+      output_.push_back(static_cast<char>(value));
+    }
+
+    void ProgramWriter::WriteString(std::string_view value) {
+      WriteInt(value.size());
+      output_.append(value);
+    }
+
+    // Формат: MAGIC, версия, длина и хэш исходного текста, длина и контрольная сумма дерева, дерево
+    std::string Serialize(const ast::Statement &program, std::string_view source) {
+      std::string tree;
+      ProgramWriter(tree).WriteStatement(program);
+
+      std::string result(MAGIC);
+      ProgramWriter header(result);
+      header.WriteInt(FORMAT_VERSION);
+      header.WriteInt(source.size());
+      header.WriteInt(HashSource(source));
+      header.WriteInt(tree.size());
+      header.WriteInt(Fnv1a(tree));
+      result += tree;
+      return result;
+    }
+
+    std::unique_ptr<ast::Statement> Deserialize(std::string_view data, std::string_view source) {
+      if (data.substr(0, MAGIC.size()) != MAGIC) {
+        throw CacheError("not a program cache"s);
+      }
+      ProgramReader header(data.substr(MAGIC.size()));
+      if (header.ReadInt() != FORMAT_VERSION) {
+        throw CacheError("unsupported format version"s);
+      }
+      if (header.ReadInt() != source.size() || header.ReadInt() != HashSource(source)) {
+        throw CacheError("stale program cache"s);
+      }
+      const auto size = header.ReadInt();
+      const auto checksum = header.ReadInt();
+      const auto tree = header.ReadBytes(size);
+      if (!header.AtEnd() || Fnv1a(tree) != checksum) {
+        throw CacheError("corrupted program cache"s);
+      }
+      ProgramReader reader(tree);
+      auto result = reader.ReadStatement();
+      if (!result || !reader.AtEnd()) {
+        throw CacheError("corrupted program cache"s);
+      }
+      return result;
+    }
+
+    std::unique_ptr<ast::Statement> Load(const std::filesystem::path &path, std::string_view source) {
+      const MappedFile file(path);
+      try {
+        return Deserialize(file.Data(), source);
+      } catch (const CacheError &) {
+        return nullptr;
+      }
+    }
+
+    bool Store(const std::filesystem::path &path, const ast::Statement &program, std::string_view source) {
+      std::string data;
+      try {
+        data = Serialize(program, source);
+      } catch (const CacheError &) {
+        return false;
+      }
+      // Файл записывается под временным именем и переименовывается, чтобы параллельно
+      // запущенный интерпретатор не прочитал его частично записанным. Имя временного файла
+      // уникально для каждой записи: иначе интерпретаторы, одновременно сохраняющие кэш,
+      // писали бы в один файл и переименовывали бы смесь их данных
+      std::error_code error;
+      if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), error);
+      }
+      std::random_device random;
+      const std::uint64_t suffix = (static_cast<std::uint64_t>(random()) << 32) ^ random();
+      std::ostringstream temporary_name;
+      temporary_name << path.filename().string() << '.' << std::hex << suffix << ".tmp"sv;
+      const auto temporary = path.parent_path() / temporary_name.str();
+      {
+        std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+        output.write(data.data(), static_cast<std::streamsize>(data.size()));
+        output.close();
+        // Ошибка записи может обнаружиться только при сбросе буфера в close
+        if (!output) {
+          std::filesystem::remove(temporary, error);
+          return false;
+        }
+      }
+      std::filesystem::rename(temporary, path, error);
+      if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+      }
+      return true;
+    }
+
+  }  // namespace cache
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "statement.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace cache
+  {
+
+// Версия двоичного формата. Увеличивается при любом изменении формата или узлов дерева разбора:
+// 2 - Negate, 3 - циклы while и for, 4 - списки, 5 - словари и in
+    constexpr std::uint32_t FORMAT_VERSION = 5;
+
+// Ошибка сериализации: дерево содержит неподдерживаемые узлы либо данные кэша повреждены
+    class CacheError
+        : public std::runtime_error {
+     public:
+      using std::runtime_error::runtime_error;
+    };
+
+// Хэш исходного текста программы, по которому ищется её кэш
+    std::uint64_t HashSource(std::string_view source);
+
+// Путь к файлу кэша программы source в каталоге directory
+    std::filesystem::path CachePath(const std::filesystem::path &directory, std::string_view source);
+
+// Сериализует дерево разбора программы, полученной из исходного текста source.
+// Если дерево содержит узлы, которые не порождает парсер, выбрасывает CacheError
+    std::string Serialize(const ast::Statement &program, std::string_view source);
+
+// Восстанавливает дерево разбора программы source из данных data.
+// Если данные повреждены, устарели или относятся к другой программе, выбрасывает CacheError
+    std::unique_ptr<ast::Statement> Deserialize(std::string_view data, std::string_view source);
+
+// Загружает дерево разбора программы source из файла кэша path, отображая файл в память.
+// Возвращает nullptr, если файла нет либо он устарел или повреждён
+    std::unique_ptr<ast::Statement> Load(const std::filesystem::path &path, std::string_view source);
+
+// Сохраняет дерево разбора программы source в файл кэша path.
+// Возвращает false, если дерево нельзя сериализовать или файл не удалось записать
+    bool Store(const std::filesystem::path &path, const ast::Statement &program, std::string_view source);
+
+// Записывает дерево разбора в двоичный формат кэша
+    class ProgramWriter {
+     public:
+      explicit ProgramWriter(std::string &output);
+
+      void WriteStatement(const ast::Statement &node);
+      void WriteInt(std::uint64_t value);
+
+     private:
+      void WriteClass(const runtime::Class &cls);
+      void WriteVariable(const ast::VariableValue &node);
+      void WriteStatements(const std::vector<std::unique_ptr<ast::Statement>> &statements);
+      void WriteOptional(const std::unique_ptr<ast::Statement> &node);
+      void WriteTag(std::uint8_t tag);
+      void WriteString(std::string_view value);
+
+      std::string &output_;
+      // Классы, определения которых уже записаны
+      std::vector<const runtime::Class *> classes_;
+    };
+
+  }  // namespace cache
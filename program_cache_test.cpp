@@ -0,0 +1,213 @@
+#include "lexer.h"
+#include "optimizer.h"
+#include "parse.h"
+#include "program_cache.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+#include "vm.h"
+
+#include <fstream>
+
+using namespace std;
+
+namespace cache {
+
+namespace {
+
+const string PROGRAM = R"(
+class Shape:
+  def __init__(name):
+    self.name = name
+
+  def area():
+    return 0
+
+  def __eq__(other):
+    return self.area() == other.area()
+
+  def __str__():
+    return self.name + ':' + str(self.area())
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.name = 'rect'
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+  def __lt__(other):
+    return self.area() < other.area()
+
+class Factory:
+  def make(w, h):
+    if w == h:
+      side = w
+      return Rect(side, side)
+    else:
+      return Rect(w, h)
+
+f = Factory()
+a = f.make(2, 3)
+b = f.make(4, 4)
+print a, b, a < b, a > b, a <= b, a >= b, a == a, a != b
+print 10 / 3 - 1, -7, 'x' + "y", True and not False, None or 0, Shape('s')
+)"s;
+
+using test_program::Parse;
+using test_program::Run;
+
+void TestRoundTrip() {
+    const auto parsed = Parse(PROGRAM);
+    const auto data = Serialize(*parsed, PROGRAM);
+    const auto loaded = Deserialize(data, PROGRAM);
+
+    const string expected = "rect:6 rect:16 True False True False True True\n2 -7 xy True False s:0\n"s;
+    ASSERT_EQUAL(Run(*parsed, vm::Backend::TreeWalker), expected);
+    ASSERT_EQUAL(Run(*loaded, vm::Backend::TreeWalker), expected);
+    ASSERT_EQUAL(Run(*loaded, vm::Backend::Bytecode), expected);
+    // Восстановленное дерево совпадает с исходным вплоть до слотов кадров вызова
+    ASSERT_EQUAL(Serialize(*loaded, PROGRAM), data);
+}
+
+void TestLoops() {
+    const string source = R"(
+class A:
+  def f(n):
+    total = 0
+    for i in range(1, n):
+      if i == 3:
+        continue
+      total = total + i
+    while total > 5:
+      total = total - 5
+      if total == 7:
+        break
+    return total
+
+a = A()
+print a.f(6)
+for i in range(2):
+  print i
+)"s;
+    const auto data = Serialize(*Parse(source), source);
+    const auto loaded = Deserialize(data, source);
+    ASSERT_EQUAL(Run(*loaded, vm::Backend::TreeWalker), "7\n0\n1\n"s);
+    ASSERT_EQUAL(Run(*loaded, vm::Backend::Bytecode), "7\n0\n1\n"s);
+    ASSERT_EQUAL(Serialize(*loaded, source), data);
+}
+
+void TestLists() {
+    const string source = R"(
+x = [1, 'a', [None]]
+x[2][0] = len(x)
+x.append(x[0] + 1)
+for item in x:
+  print item
+)"s;
+    const auto data = Serialize(*Parse(source), source);
+    const auto loaded = Deserialize(data, source);
+    ASSERT_EQUAL(Run(*loaded, vm::Backend::TreeWalker), "1\na\n[3]\n2\n"s);
+    ASSERT_EQUAL(Run(*loaded, vm::Backend::Bytecode), "1\na\n[3]\n2\n"s);
+    ASSERT_EQUAL(Serialize(*loaded, source), data);
+}
+
+void TestDicts() {
+    const string source = R"(
+d = {'a': 1, 2: [3]}
+d['b'] = len(d)
+print d, 'a' in d, 3 not in d
+)"s;
+    const auto data = Serialize(*Parse(source), source);
+    const auto loaded = Deserialize(data, source);
+    ASSERT_EQUAL(Run(*loaded, vm::Backend::TreeWalker), "{a: 1, 2: [3], b: 2} True True\n"s);
+    ASSERT_EQUAL(Run(*loaded, vm::Backend::Bytecode), "{a: 1, 2: [3], b: 2} True True\n"s);
+    ASSERT_EQUAL(Serialize(*loaded, source), data);
+}
+
+void TestRejectsInvalidData() {
+    const string source = "x = 1\nprint x\n"s;
+    const auto data = Serialize(*Parse(source), source);
+    ASSERT(Deserialize(data, source) != nullptr);
+
+    // Данные другой программы
+    ASSERT_THROWS(Deserialize(data, "x = 2\nprint x\n"s), CacheError);
+    // Другая версия формата
+    auto other_version = data;
+    other_version[8] = static_cast<char>(FORMAT_VERSION + 1);
+    ASSERT_THROWS(Deserialize(other_version, source), CacheError);
+    ASSERT_THROWS(Deserialize("garbage"s, source), CacheError);
+    ASSERT_THROWS(Deserialize(""s, source), CacheError);
+    // Любое усечение и любой изменённый байт обнаруживаются
+    for (size_t size = 0; size < data.size(); ++size) {
+        ASSERT_THROWS(Deserialize(data.substr(0, size), source), CacheError);
+    }
+    for (size_t i = 0; i < data.size(); ++i) {
+        auto corrupted = data;
+        corrupted[i] = static_cast<char>(corrupted[i] ^ 0x5A);
+        ASSERT_THROWS(Deserialize(corrupted, source), CacheError);
+    }
+
+    // Слот переменной за пределами кадра метода при верной контрольной сумме
+    const string method_source = "class A:\n  def f(x):\n    y = x\n    return y\n"s;
+    auto program = Parse(method_source);
+    ASSERT(Deserialize(Serialize(*program, method_source), method_source) != nullptr);
+    auto& definition = *opt::TreeAccess::CompoundStatements(*program)->front();
+    opt::TreeAccess::DefinedClass(dynamic_cast<ast::ClassDefinition&>(definition)).GetMethods().front().frame_size = 2;
+    ASSERT_THROWS(Deserialize(Serialize(*program, method_source), method_source), CacheError);
+}
+
+void TestFiles() {
+    const auto directory = filesystem::temp_directory_path() / "mython_cache_test"s;
+    filesystem::remove_all(directory);
+    const auto path = CachePath(directory, PROGRAM);
+    ASSERT(Load(path, PROGRAM) == nullptr);
+
+    ASSERT(Store(path, *Parse(PROGRAM), PROGRAM));
+    auto loaded = Load(path, PROGRAM);
+    ASSERT(loaded != nullptr);
+    ASSERT_EQUAL(Run(*loaded, vm::Backend::Bytecode), Run(*Parse(PROGRAM), vm::Backend::Bytecode));
+    // Повторная запись заменяет файл, временные файлы записи не остаются в каталоге
+    ASSERT(Store(path, *Parse(PROGRAM), PROGRAM));
+    ASSERT_EQUAL(distance(filesystem::directory_iterator(directory), filesystem::directory_iterator()), 1);
+
+    // Изменённый исходный текст получает другой файл кэша, а старый файл ему не подходит
+    const string changed = PROGRAM + "print 1\n"s;
+    ASSERT(CachePath(directory, changed) != path);
+    ASSERT(Load(path, changed) == nullptr);
+
+    {
+        ofstream output(path, ios::binary | ios::trunc);
+        output << "MYTHONC\n"s << "broken"s;
+    }
+    ASSERT(Load(path, PROGRAM) == nullptr);
+    filesystem::remove_all(directory);
+}
+
+struct Unsupported : ast::Statement {
+    runtime::ObjectHolder Execute(runtime::Closure&, runtime::Context&) override {
+        return {};
+    }
+};
+
+void TestUnsupportedNodes() {
+    ast::Compound program(make_unique<Unsupported>());
+    ASSERT_THROWS(Serialize(program, ""s), CacheError);
+    ASSERT(!Store(filesystem::temp_directory_path() / "mython_unsupported.mythonc"s, program, ""s));
+    ASSERT(!filesystem::exists(filesystem::temp_directory_path() / "mython_unsupported.mythonc"s));
+}
+
+}  // namespace
+
+void RunProgramCacheTests(TestRunner& tr) {
+    RUN_TEST(tr, cache::TestRoundTrip);
+    RUN_TEST(tr, cache::TestLoops);
+    RUN_TEST(tr, cache::TestLists);
+    RUN_TEST(tr, cache::TestDicts);
+    RUN_TEST(tr, cache::TestRejectsInvalidData);
+    RUN_TEST(tr, cache::TestFiles);
+    RUN_TEST(tr, cache::TestUnsupportedNodes);
+}
+
+}  // namespace cache
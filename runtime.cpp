@@ -1,32 +1,121 @@
 #include "runtime.h"
 
+#include "jit.h"
+
 #include <algorithm>
 #include <cassert>
+#include <deque>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace runtime
   {
     using namespace std::literals;
     namespace
       {
-        const std::string STR_METHOD = "__str__"s;
-        const std::string EQ_METHOD = "__eq__"s;
-        const std::string LT_METHOD = "__lt__"s;
+        // Таблица интернированных имён методов
+        class SelectorTable {
+         public:
+          Selector Intern(std::string_view name) {
+            if (const auto it = selectors_.find(name); it != selectors_.end()) {
+              return it->second;
+            }
+            const auto selector = static_cast<Selector>(names_.size());
+            const std::string &stored = names_.emplace_back(name);
+            selectors_.emplace(stored, selector);
+            return selector;
+          }
+
+          std::optional<Selector> Find(std::string_view name) const {
+            if (const auto it = selectors_.find(name); it != selectors_.end()) {
+              return it->second;
+            }
+            return std::nullopt;
+          }
+
+          const std::string &GetName(Selector selector) const {
+            return names_.at(selector);
+          }
+
+         private:
+          // deque не перемещает строки, поэтому ключи-string_view остаются действительными
+          std::deque<std::string> names_;
+          std::unordered_map<std::string_view, Selector> selectors_;
+        };
+
+        SelectorTable &GetSelectorTable() {
+          static SelectorTable table;
+          return table;
+        }
+
+        const Selector STR_METHOD = InternSelector("__str__"sv);
+        const Selector EQ_METHOD = InternSelector("__eq__"sv);
+        const Selector LT_METHOD = InternSelector("__lt__"sv);
+        const Selector APPEND_METHOD = InternSelector("append"sv);
+        const Selector POP_METHOD = InternSelector("pop"sv);
+        const Selector HASH_METHOD = InternSelector("__hash__"sv);
+
+        const Symbol SELF = "self"sv;
+
+        // Устанавливает флаг на время обхода вложенных объектов, в том числе при исключении
+        class RecursionGuard {
+         public:
+          explicit RecursionGuard(bool &flag)
+              : flag_(flag) {
+            flag_ = true;
+          }
+
+          RecursionGuard(const RecursionGuard &) = delete;
+          RecursionGuard &operator=(const RecursionGuard &) = delete;
+
+          ~RecursionGuard() {
+            flag_ = false;
+          }
+
+         private:
+          bool &flag_;
+        };
       }
 
-    ObjectHolder::ObjectHolder(std::shared_ptr<Object> data)
-        : data_(std::move(data)) {
+    Selector InternSelector(std::string_view name) {
+      return GetSelectorTable().Intern(name);
     }
 
-    void ObjectHolder::AssertIsValid() const {
-      assert(data_ != nullptr);
+    std::optional<Selector> FindSelector(std::string_view name) {
+      return GetSelectorTable().Find(name);
+    }
+
+    const std::string &GetSelectorName(Selector selector) {
+      return GetSelectorTable().GetName(selector);
     }
 
-    ObjectHolder ObjectHolder::Share(Object &object) {
-      // Возвращаем невладеющий shared_ptr (его deleter ничего не делает)
-      return ObjectHolder(std::shared_ptr<Object>(&object, [](auto * /*p*/) { /* do nothing */ }));
+    namespace immortal
+      {
+        // Объекты создаются однократно и никогда не уничтожаются
+        Bool &True() {
+          static Bool *const value = new Bool(true);
+          return *value;
+        }
+
+        Bool &False() {
+          static Bool *const value = new Bool(false);
+          return *value;
+        }
+
+        Number *SmallNumbers::Create() {
+          auto *numbers = static_cast<Number *>(::operator new(sizeof(Number) * (MAX - MIN + 1)));
+          for (int value = MIN; value <= MAX; ++value) {
+            new(numbers + (value - MIN)) Number(value);
+          }
+          return numbers;
+        }
+      }  // namespace immortal
+
+    void ObjectHolder::AssertIsValid() const {
+      assert(Get() != nullptr);
     }
 
     ObjectHolder ObjectHolder::None() {
@@ -43,31 +132,307 @@ namespace runtime
       return Get();
     }
 
-    Object *ObjectHolder::Get() const {
-      return data_.get();
+    Frame::Frame(std::size_t size)
+        : size_(size) {
+      if (size > INLINE_SLOTS) {
+        heap_slots_ = std::make_unique<Slot[]>(size);
+        slots_ = heap_slots_.get();
+      } else {
+        slots_ = inline_slots_.data();
+      }
+    }
+
+    void StackRegion::Release(std::size_t mark) {
+      if (mark >= entries_.size()) {
+        return;
+      }
+      for (auto i = entries_.size(); i > mark; --i) {
+        entries_[i - 1].object->~Object();
+      }
+      current_block_ = entries_[mark].block;
+      blocks_[current_block_].used = entries_[mark].offset;
+      entries_.resize(mark);
     }
 
-    ObjectHolder::operator bool() const {
-      return Get() != nullptr;
+    void *StackRegion::Allocate(std::size_t size, std::size_t alignment) {
+      while (true) {
+        if (current_block_ < blocks_.size()) {
+          auto &block = blocks_[current_block_];
+          const std::size_t offset = (block.used + alignment - 1) / alignment * alignment;
+          if (offset + size <= block.size) {
+            block.used = offset + size;
+            return block.data.get() + offset;
+          }
+          if (current_block_ + 1 == blocks_.size()) {
+            blocks_.push_back({});
+          }
+          ++current_block_;
+        } else {
+          blocks_.push_back({});
+        }
+        auto &next = blocks_[current_block_];
+        if (next.size < size + alignment) {
+          next.size = std::max(BLOCK_SIZE, size + alignment);
+          next.data = std::make_unique<std::byte[]>(next.size);
+        }
+        next.used = 0;
+      }
     }
 
     bool IsTrue(const ObjectHolder &object) {
-      if (const auto *bool_ptr = object.TryAs<Bool>()) {
-        return bool_ptr->GetValue();
+      switch (object.GetKind()) {
+        case ObjectKind::Bool:
+          return object.As<Bool>().GetValue();
+        case ObjectKind::Number:
+          return object.As<Number>().GetValue() != 0;
+        case ObjectKind::String:
+          return object.As<String>().Size() != 0;
+        case ObjectKind::List:
+          return object.As<List>().Size() != 0;
+        case ObjectKind::Dict:
+          return object.As<Dict>().Size() != 0;
+        default:
+          return false;
+      }
+    }
+
+    List::List() {
+      SetKind(ObjectKind::List);
+    }
+
+    List::List(std::vector<ObjectHolder> items)
+        : items_(std::move(items)) {
+      SetKind(ObjectKind::List);
+    }
+
+    void List::Print(std::ostream &os, Context &context) {
+      if (printing_) {
+        os << "[...]"sv;
+        return;
       }
-      if (const auto *number_ptr = object.TryAs<Number>()) {
-        return number_ptr->GetValue();
+      printing_ = true;
+      os << '[';
+      for (std::size_t i = 0; i < items_.size(); ++i) {
+        if (i > 0) {
+          os << ", "sv;
+        }
+        if (items_[i]) {
+          items_[i]->Print(os, context);
+        } else {
+          os << "None"sv;
+        }
       }
-      if (const auto *string_ptr = object.TryAs<String>()) {
-        return !string_ptr->GetValue().empty();
+      os << ']';
+      printing_ = false;
+    }
+
+    ObjectHolder &List::At(int index) {
+      const auto size = static_cast<std::int64_t>(items_.size());
+      const std::int64_t position = index < 0 ? index + size : index;
+      if (position < 0 || position >= size) {
+        throw std::runtime_error("list index out of range"s);
       }
-      return false;
+      return items_[static_cast<std::size_t>(position)];
+    }
 
+    ObjectHolder List::Call(Selector method, const ObjectHolder *args, std::size_t argument_count) {
+      if (method == APPEND_METHOD && argument_count == 1) {
+        Append(args[0]);
+        return {};
+      }
+      if (method == POP_METHOD && argument_count == 0) {
+        if (items_.empty()) {
+          throw std::runtime_error("pop from empty list"s);
+        }
+        ObjectHolder item = std::move(items_.back());
+        items_.pop_back();
+        return item;
+      }
+      throw std::runtime_error("list has no method "s + GetSelectorName(method));
+    }
+
+    std::uint64_t Hash(const ObjectHolder &object, Context &context) {
+      switch (object.GetKind()) {
+        case ObjectKind::None:
+          return 0;
+        case ObjectKind::Number:
+          return static_cast<std::uint64_t>(object.As<Number>().GetValue());
+        case ObjectKind::Bool:
+          return object.As<Bool>().GetValue() ? 1 : 0;
+        case ObjectKind::String:
+          return std::hash<std::string>{}(object.As<String>().GetValue());
+        case ObjectKind::Class:
+          return reinterpret_cast<std::uintptr_t>(object.Get());
+        case ObjectKind::ClassInstance: {
+          auto &instance = object.As<ClassInstance>();
+          if (const Method *method = instance.FindMethod(HASH_METHOD, 0)) {
+            const auto hash = instance.Call(*method, {}, context);
+            if (hash.GetKind() != ObjectKind::Number) {
+              throw std::runtime_error("__hash__ must return a number"s);
+            }
+            return static_cast<std::uint64_t>(hash.As<Number>().GetValue());
+          }
+          return reinterpret_cast<std::uintptr_t>(object.Get());
+        }
+        default:
+          throw std::runtime_error("unhashable type"s);
+      }
+    }
+
+    namespace
+      {
+        // Сравнивает искомый ключ key с ключом stored, уже хранящимся в словаре или списке
+        bool KeysEqual(const ObjectHolder &key, const ObjectHolder &stored, Context &context) {
+          const ObjectKind kind = key.GetKind();
+          if (kind == ObjectKind::ClassInstance) {
+            return key.Get() == stored.Get()
+                   || (key.As<ClassInstance>().HasMethod(EQ_METHOD, 1) && Equal(key, stored, context));
+          }
+          if (kind != stored.GetKind()) {
+            return false;
+          }
+          if (kind == ObjectKind::Class) {
+            return key.Get() == stored.Get();
+          }
+          return Equal(key, stored, context);
+        }
+
+        constexpr std::size_t DICT_INITIAL_SIZE = 8;
+        constexpr int DICT_INITIAL_SHIFT = 61;
+      }
+
+    Dict::Dict()
+        : indices_(DICT_INITIAL_SIZE, EMPTY)
+        , shift_(DICT_INITIAL_SHIFT) {
+      SetKind(ObjectKind::Dict);
+    }
+
+    void Dict::Print(std::ostream &os, Context &context) {
+      if (printing_) {
+        os << "{...}"sv;
+        return;
+      }
+      printing_ = true;
+      const auto print = [&os, &context](const ObjectHolder &object) {
+        if (object) {
+          object->Print(os, context);
+        } else {
+          os << "None"sv;
+        }
+      };
+      os << '{';
+      for (std::size_t i = 0; i < entries_.size(); ++i) {
+        if (i > 0) {
+          os << ", "sv;
+        }
+        print(entries_[i].key);
+        os << ": "sv;
+        print(entries_[i].value);
+      }
+      os << '}';
+      printing_ = false;
+    }
+
+    std::size_t Dict::Probe(const ObjectHolder &key, std::uint64_t hash, Context &context) const {
+      const std::size_t mask = indices_.size() - 1;
+      for (std::size_t position = (hash * 0x9E3779B97F4A7C15ULL) >> shift_;; position = (position + 1) & mask) {
+        const std::uint32_t index = indices_[position];
+        if (index == EMPTY || (entries_[index].hash == hash && KeysEqual(key, entries_[index].key, context))) {
+          return position;
+        }
+      }
+    }
+
+    const ObjectHolder *Dict::Find(const ObjectHolder &key, Context &context) const {
+      const std::uint32_t index = indices_[Probe(key, Hash(key, context), context)];
+      return index == EMPTY ? nullptr : &entries_[index].value;
+    }
+
+    void Dict::Set(const ObjectHolder &key, ObjectHolder value, Context &context) {
+      const std::uint64_t hash = Hash(key, context);
+      std::size_t position = Probe(key, hash, context);
+      if (indices_[position] != EMPTY) {
+        entries_[indices_[position]].value = std::move(value);
+        return;
+      }
+      // Заполненность таблицы индексов не превышает 3/4
+      if ((entries_.size() + 1) * 4 > indices_.size() * 3) {
+        Grow();
+        position = Probe(key, hash, context);
+      }
+      indices_[position] = static_cast<std::uint32_t>(entries_.size());
+      entries_.push_back({hash, key, std::move(value)});
+    }
+
+    void Dict::Grow() {
+      indices_.assign(indices_.size() * 2, EMPTY);
+      --shift_;
+      const std::size_t mask = indices_.size() - 1;
+      for (std::size_t i = 0; i < entries_.size(); ++i) {
+        std::size_t position = (entries_[i].hash * 0x9E3779B97F4A7C15ULL) >> shift_;
+        while (indices_[position] != EMPTY) {
+          position = (position + 1) & mask;
+        }
+        indices_[position] = static_cast<std::uint32_t>(i);
+      }
+    }
+
+    namespace
+      {
+        ObjectHolder &ListItem(List &list, const ObjectHolder &index) {
+          if (index.GetKind() != ObjectKind::Number) {
+            throw std::runtime_error("list indices must be numbers"s);
+          }
+          return list.At(index.As<Number>().GetValue());
+        }
+      }
+
+    ObjectHolder GetItem(const ObjectHolder &container, const ObjectHolder &index, Context &context) {
+      if (auto *list = container.TryAs<List>()) {
+        return ListItem(*list, index);
+      }
+      if (const auto *dict = container.TryAs<Dict>()) {
+        if (const ObjectHolder *value = dict->Find(index, context)) {
+          return *value;
+        }
+        throw std::runtime_error("key not found in dict"s);
+      }
+      throw std::runtime_error("object is not subscriptable"s);
+    }
+
+    void SetItem(const ObjectHolder &container, const ObjectHolder &index, ObjectHolder value, Context &context) {
+      if (auto *list = container.TryAs<List>()) {
+        ListItem(*list, index) = std::move(value);
+      } else if (auto *dict = container.TryAs<Dict>()) {
+        dict->Set(index, std::move(value), context);
+      } else {
+        throw std::runtime_error("object does not support item assignment"s);
+      }
+    }
+
+    bool Contains(const ObjectHolder &container, const ObjectHolder &item, Context &context) {
+      switch (container.GetKind()) {
+        case ObjectKind::Dict:
+          return container.As<Dict>().Find(item, context) != nullptr;
+        case ObjectKind::List: {
+          const auto &items = container.As<List>().GetItems();
+          return std::any_of(items.begin(), items.end(), [&item, &context](const ObjectHolder &stored) {
+            return KeysEqual(item, stored, context);
+          });
+        }
+        case ObjectKind::String:
+          if (item.GetKind() != ObjectKind::String) {
+            throw std::runtime_error("'in <string>' requires string as left operand"s);
+          }
+          return container.As<String>().GetValue().find(item.As<String>().GetValue()) != std::string::npos;
+        default:
+          throw std::runtime_error("argument of 'in' is not a container"s);
+      }
     }
 
     void ClassInstance::Print(std::ostream &os, Context &context) {
-      if (HasMethod(STR_METHOD, 0)) {
-        const auto obj = Call(STR_METHOD, {}, context);
+      if (const Method *method = FindMethod(STR_METHOD, 0)) {
+        const auto obj = Call(*method, {}, context);
         if (const auto obj_ptr = obj.Get()) {
           obj_ptr->Print(os, context);
         }
@@ -77,57 +442,201 @@ namespace runtime
     }
 
     bool ClassInstance::HasMethod(const std::string &method, size_t argument_count) const {
-      const auto *method_ptr = cls_.GetMethod(method);
-      return method_ptr != nullptr && method_ptr->formal_params.size() == argument_count;
+      const auto selector = FindSelector(method);
+      return selector && HasMethod(*selector, argument_count);
+    }
+
+    bool ClassInstance::HasMethod(Selector method, size_t argument_count) const {
+      return FindMethod(method, argument_count) != nullptr;
+    }
+
+    Shape::Shape(const Shape &parent, Symbol name)
+        : names_(parent.names_) {
+      names_.push_back(name);
     }
 
-    Closure &ClassInstance::Fields() {
-      return closure_;
+    const Shape &Shape::Empty() {
+      static const Shape empty;
+      return empty;
     }
 
-    const Closure &ClassInstance::Fields() const {
-      return closure_;
+    std::uint32_t Shape::Find(Symbol name) const {
+      const auto it = std::find(names_.begin(), names_.end(), name);
+      return it != names_.end() ? static_cast<std::uint32_t>(it - names_.begin()) : NO_SLOT;
+    }
+
+    const Shape &Shape::AddField(Symbol name) const {
+      for (const auto &[field, shape]: transitions_) {
+        if (field == name) {
+          return *shape;
+        }
+      }
+      return *transitions_.emplace_back(name, std::unique_ptr<Shape>(new Shape(*this, name))).second;
     }
 
     ClassInstance::ClassInstance(const Class &cls)
-        : cls_(cls) {
+        : cls_(cls)
+        , shape_(&Shape::Empty()) {
+      SetKind(ObjectKind::ClassInstance);
+    }
+
+    ObjectHolder *ClassInstance::FindField(Symbol name) {
+      const std::uint32_t slot = shape_->Find(name);
+      return slot != Shape::NO_SLOT ? &GetSlot(slot) : nullptr;
+    }
+
+    const ObjectHolder *ClassInstance::FindField(Symbol name) const {
+      const std::uint32_t slot = shape_->Find(name);
+      return slot != Shape::NO_SLOT ? &GetSlot(slot) : nullptr;
+    }
+
+    ObjectHolder &ClassInstance::AddField(Symbol name) {
+      if (ObjectHolder *field = FindField(name)) {
+        return *field;
+      }
+      return Transition(shape_->AddField(name));
+    }
+
+    ObjectHolder &ClassInstance::Transition(const Shape &next) {
+      const auto slot = static_cast<std::uint32_t>(shape_->Size());
+      assert(next.Size() == slot + 1);
+      shape_ = &next;
+      if (slot >= INLINE_FIELDS) {
+        overflow_fields_.emplace_back();
+      }
+      return GetSlot(slot);
+    }
+
+    ObjectHolder *FieldCache::FindSlow(ClassInstance &instance, Symbol name) {
+      const std::uint32_t slot = instance.GetShape().Find(name);
+      if (slot == Shape::NO_SLOT) {
+        return nullptr;
+      }
+      ++FIELD_CACHE_STATS.misses;
+      shape_ = &instance.GetShape();
+      parent_ = nullptr;
+      slot_ = slot;
+      return &instance.GetSlot(slot);
+    }
+
+    ObjectHolder &FieldCache::AddSlow(ClassInstance &instance, Symbol name) {
+      ++FIELD_CACHE_STATS.misses;
+      const Shape &shape = instance.GetShape();
+      if (const std::uint32_t slot = shape.Find(name); slot != Shape::NO_SLOT) {
+        shape_ = &shape;
+        parent_ = nullptr;
+        slot_ = slot;
+        return instance.GetSlot(slot);
+      }
+      const Shape &next = shape.AddField(name);
+      shape_ = &next;
+      parent_ = &shape;
+      slot_ = static_cast<std::uint32_t>(shape.Size());
+      return instance.Transition(next);
     }
 
     ObjectHolder ClassInstance::Call(const std::string &method,
                                      const std::vector<ObjectHolder> &actual_args,
                                      Context &context) {
-      if (HasMethod(method, actual_args.size())) {
-        Closure closure;
-        const auto method_ptr = cls_.GetMethod(method);
+      const auto selector = FindSelector(method);
+      if (!selector) {
+        throw std::runtime_error("Nothing to call"s);
+      }
+      return Call(*selector, actual_args, context);
+    }
+
+    ObjectHolder ClassInstance::Call(Selector method, const std::vector<ObjectHolder> &actual_args,
+                                     Context &context) {
+      if (const Method *method_ptr = FindMethod(method, actual_args.size())) {
+        return Call(*method_ptr, actual_args, context);
+      }
+      throw std::runtime_error("Nothing to call"s);
+    }
+
+    ObjectHolder ClassInstance::Call(const Method &method, const std::vector<ObjectHolder> &actual_args,
+                                     Context &context) {
+      assert(method.formal_params.size() == actual_args.size());
+      if (ObjectHolder result; jit::TryCall(method, *this, actual_args.data(), actual_args.size(), result)) {
+        return result;
+      }
+      Closure closure;
+      auto *const body_ptr = method.body.get();
+      if (method.frame_size > 0) {
+        Frame frame(method.frame_size);
+        frame.Bind(0) = ObjectHolder::Share(*this);
         for (size_t i = 0; i < actual_args.size(); ++i) {
-          closure.emplace(method_ptr->formal_params.at(i), actual_args[i]);
+          frame.Bind(i + 1) = actual_args[i];
         }
-        closure.emplace("self"s, ObjectHolder::Share(*this));
-        auto* const body_ptr = method_ptr->body.get();
-        const auto result = body_ptr->Execute(closure, context);
-        return result;
-      } else {
-        throw std::runtime_error("Nothing to call"s);
+        closure.SetFrame(&frame);
+        return body_ptr->Execute(closure, context);
+      }
+      for (size_t i = 0; i < actual_args.size(); ++i) {
+        closure.emplace(method.formal_params.at(i), actual_args[i]);
       }
+      closure.emplace(SELF, ObjectHolder::Share(*this));
+      return body_ptr->Execute(closure, context);
     }
 
     Class::Class(std::string name, std::vector<Method> methods, const Class *parent)
         : name_(std::move(name))
         , methods_(std::move(methods))
         , parent_(parent) {
-    }
-
-    const Method *Class::GetMethod(const std::string &name) const {
+      static std::uint64_t next_id = 0;
+      id_ = ++next_id;
+      SetKind(ObjectKind::Class);
+      if (parent_ != nullptr) {
+        dispatch_table_ = parent_->dispatch_table_;
+      }
+      // Собственные методы перекрывают унаследованные. Из одноимённых методов класса
+      // используется объявленный первым
+      std::vector<bool> own(dispatch_table_.size());
       for (const auto &method: methods_) {
-        if (method.name == name) {
-          return &method;
+        const Selector selector = InternSelector(method.name);
+        if (selector >= dispatch_table_.size()) {
+          dispatch_table_.resize(selector + 1, nullptr);
+          own.resize(selector + 1, false);
+        }
+        if (!own[selector]) {
+          dispatch_table_[selector] = &method;
+          own[selector] = true;
         }
       }
-      if (parent_ != nullptr) {
-        return parent_->GetMethod(name);
-      } else {
-        return nullptr;
+    }
+
+    const Method *InlineCache::FindSlow(const ClassInstance &instance, Selector selector,
+                                        std::size_t argument_count) {
+      const Method *method = instance.FindMethod(selector, argument_count);
+      if (megamorphic_) {
+        ++INLINE_CACHE_STATS.megamorphic;
+        return method;
+      }
+      ++INLINE_CACHE_STATS.misses;
+      if (size_ == POLYMORPHIC_LIMIT) {
+        megamorphic_ = true;
+        size_ = 0;
+        ++INLINE_CACHE_STATS.megamorphic_sites;
+        return method;
+      }
+      if (size_ == 1) {
+        ++INLINE_CACHE_STATS.polymorphic_sites;
+      }
+      entries_[size_++] = {instance.GetClass().GetId(), method};
+      return method;
+    }
+
+    InlineCache::State InlineCache::GetState() const {
+      if (megamorphic_) {
+        return State::Megamorphic;
+      }
+      if (size_ == 0) {
+        return State::Empty;
       }
+      return size_ == 1 ? State::Monomorphic : State::Polymorphic;
+    }
+
+    const Method *Class::GetMethod(const std::string &name) const {
+      const auto selector = FindSelector(name);
+      return selector ? GetMethod(*selector) : nullptr;
     }
 
     [[nodiscard]] const std::string &Class::GetName() const {
@@ -142,46 +651,191 @@ namespace runtime
       os << (GetValue() ? "True"sv : "False"sv);
     }
 
-    bool Equal(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context) {
-      if (!lhs && !rhs) {
-        return true;
+    String::String(ObjectHolder left, ObjectHolder right, std::size_t size)
+        : left_(std::move(left))
+        , right_(std::move(right))
+        , size_(size) {
+      SetKind(ObjectKind::String);
+    }
+
+    ObjectHolder String::Concat(const ObjectHolder &lhs, const ObjectHolder &rhs, StackRegion *region) {
+      const auto &lhs_str = lhs.As<String>();
+      const auto &rhs_str = rhs.As<String>();
+      const std::size_t size = lhs_str.Size() + rhs_str.Size();
+      const auto place = [region](String &&str) {
+        return region != nullptr ? region->Make(std::move(str)) : ObjectHolder::Own(std::move(str));
+      };
+      if (size < MIN_ROPE_SIZE) {
+        return place(String{lhs_str.GetValue() + rhs_str.GetValue()});
       }
-      if (lhs.TryAs<Number>() && rhs.TryAs<Number>()) {
-        return lhs.TryAs<Number>()->GetValue() == rhs.TryAs<Number>()->GetValue();
+      // Строка, которой никто не владеет, может быть уничтожена раньше узла, поэтому узел хранит её копию.
+      // Копия узла конкатенации разделяет с ним части и не копирует текст
+      const auto part = [](const ObjectHolder &str) {
+        return str.IsOwning() ? str : ObjectHolder::Own(String{str.As<String>()});
+      };
+      return place(String{part(lhs), part(rhs), size});
+    }
+
+    ObjectHolder String::ConcatTemporary(const ObjectHolder &lhs, const ObjectHolder &rhs, StackRegion *region) {
+      const auto &rhs_str = rhs.As<String>();
+      // На узел конкатенации rhs дешевле сослаться, чем копировать его текст
+      if (lhs.UseCount() != 1 || rhs_str.IsRope()) {
+        return Concat(lhs, rhs, region);
       }
-      if (lhs.TryAs<String>() && rhs.TryAs<String>()) {
-        const auto &lhs_str = lhs.TryAs<String>()->GetValue();
-        const auto &rhs_str = rhs.TryAs<String>()->GetValue();
-        return lhs_str == rhs_str;
+      auto &lhs_str = lhs.As<String>();
+      String *target = &lhs_str;
+      if (lhs_str.IsRope()) {
+        if (lhs_str.right_.UseCount() != 1 || lhs_str.right_.As<String>().IsRope()) {
+          return Concat(lhs, rhs, region);
+        }
+        target = &lhs_str.right_.As<String>();
+        lhs_str.size_ += rhs_str.Size();
       }
-      if (lhs.TryAs<Bool>() && rhs.TryAs<Bool>()) {
-        return lhs.TryAs<Bool>()->GetValue() == rhs.TryAs<Bool>()->GetValue();
+      // append увеличивает буфер с запасом, поэтому цепочка присоединений копирует текст амортизированно O(1) раз
+      target->value_ += rhs_str.value_;
+      return lhs;
+    }
+
+    template<typename Fn>
+    void String::ForEachChunk(Fn &&fn) const {
+      if (!left_) {
+        fn(value_);
+        return;
       }
-      auto *lhs_ptr = lhs.TryAs<ClassInstance>();
-      if (lhs_ptr != nullptr && lhs_ptr->HasMethod(EQ_METHOD, 1)) {
-        return IsTrue(lhs_ptr->Call(EQ_METHOD, {rhs}, context));
+      // Обход без рекурсии: глубина дерева частей равна числу последовательных присоединений
+      std::vector<const String *> pending{this};
+      while (!pending.empty()) {
+        const String *str = pending.back();
+        pending.pop_back();
+        if (str->left_) {
+          pending.push_back(&str->right_.As<String>());
+          pending.push_back(&str->left_.As<String>());
+        } else {
+          fn(str->value_);
+        }
       }
-      throw std::runtime_error("Cannot compare objects"s);
     }
 
-    bool Less(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context) {
-      if (!lhs && !rhs) {
-        throw std::runtime_error("Cannot compare objects for less"s);
+    void String::Print(std::ostream &os, [[maybe_unused]] Context &context) {
+      ForEachChunk([&os](const std::string &chunk) {
+        os << chunk;
+      });
+    }
+
+    void String::Flatten() const {
+      std::string value;
+      value.reserve(size_);
+      ForEachChunk([&value](const std::string &chunk) {
+        value += chunk;
+      });
+      value_ = std::move(value);
+      ReleaseParts();
+    }
+
+    void String::ReleaseParts() const {
+      if (!left_) {
+        return;
       }
-      if (lhs.TryAs<Number>() && rhs.TryAs<Number>()) {
-        return lhs.TryAs<Number>()->GetValue() < rhs.TryAs<Number>()->GetValue();
+      std::vector<ObjectHolder> pending;
+      pending.push_back(std::move(left_));
+      pending.push_back(std::move(right_));
+      while (!pending.empty()) {
+        ObjectHolder part = std::move(pending.back());
+        pending.pop_back();
+        // Части последней ссылки на узел забираются до его уничтожения, чтобы деструктор не рекурсировал
+        if (part.UseCount() == 1) {
+          const auto &str = part.As<String>();
+          if (str.left_) {
+            pending.push_back(std::move(str.left_));
+            pending.push_back(std::move(str.right_));
+          }
+        }
       }
-      if (lhs.TryAs<String>() && rhs.TryAs<String>()) {
-        const auto &lhs_str = lhs.TryAs<String>()->GetValue();
-        const auto &rhs_str = rhs.TryAs<String>()->GetValue();
-        return lhs_str < rhs_str;
+    }
+
+    bool Equal(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context) {
+      static InlineCache eq_cache;
+      return Equal(lhs, rhs, context, eq_cache);
+    }
+
+    bool Equal(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context, InlineCache &eq_cache) {
+      const ObjectKind lhs_kind = lhs.GetKind();
+      if (lhs_kind == rhs.GetKind()) {
+        switch (lhs_kind) {
+          case ObjectKind::None:
+            return true;
+          case ObjectKind::Number:
+            return lhs.As<Number>().GetValue() == rhs.As<Number>().GetValue();
+          case ObjectKind::String:
+            return lhs.As<String>().GetValue() == rhs.As<String>().GetValue();
+          case ObjectKind::Bool:
+            return lhs.As<Bool>().GetValue() == rhs.As<Bool>().GetValue();
+          case ObjectKind::List: {
+            const auto &lhs_list = lhs.As<List>();
+            // Повторное сравнение списка, содержащего сам себя, считается равенством: итог решают остальные элементы
+            if (lhs.Get() == rhs.Get() || lhs_list.comparing_) {
+              return true;
+            }
+            RecursionGuard guard(lhs_list.comparing_);
+            const auto &lhs_items = lhs_list.GetItems();
+            const auto &rhs_items = rhs.As<List>().GetItems();
+            return lhs_items.size() == rhs_items.size()
+                   && std::equal(lhs_items.begin(), lhs_items.end(), rhs_items.begin(),
+                                 [&context](const ObjectHolder &lhs_item, const ObjectHolder &rhs_item) {
+                                   return Equal(lhs_item, rhs_item, context);
+                                 });
+          }
+          case ObjectKind::Dict: {
+            const auto &lhs_dict = lhs.As<Dict>();
+            if (lhs.Get() == rhs.Get() || lhs_dict.comparing_) {
+              return true;
+            }
+            RecursionGuard guard(lhs_dict.comparing_);
+            const auto &rhs_dict = rhs.As<Dict>();
+            const auto &entries = lhs_dict.GetEntries();
+            return lhs_dict.Size() == rhs_dict.Size()
+                   && std::all_of(entries.begin(), entries.end(), [&rhs_dict, &context](const Dict::Entry &entry) {
+                     const ObjectHolder *value = rhs_dict.Find(entry.key, context);
+                     return value != nullptr && Equal(entry.value, *value, context);
+                   });
+          }
+          default:
+            break;
+        }
       }
-      if (lhs.TryAs<Bool>() && rhs.TryAs<Bool>()) {
-        return lhs.TryAs<Bool>()->GetValue() < rhs.TryAs<Bool>()->GetValue();
+      if (lhs_kind == ObjectKind::ClassInstance) {
+        auto &lhs_instance = lhs.As<ClassInstance>();
+        if (const Method *method = eq_cache.Find(lhs_instance, EQ_METHOD, 1)) {
+          return IsTrue(lhs_instance.Call(*method, {rhs}, context));
+        }
       }
-      auto *lhs_ptr = lhs.TryAs<ClassInstance>();
-      if (lhs_ptr != nullptr && lhs_ptr->HasMethod(LT_METHOD, 1)) {
-        return IsTrue(lhs_ptr->Call(LT_METHOD, {rhs}, context));
+      throw std::runtime_error("Cannot compare objects"s);
+    }
+
+    bool Less(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context) {
+      static InlineCache lt_cache;
+      return Less(lhs, rhs, context, lt_cache);
+    }
+
+    bool Less(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context, InlineCache &lt_cache) {
+      const ObjectKind lhs_kind = lhs.GetKind();
+      if (lhs_kind == rhs.GetKind()) {
+        switch (lhs_kind) {
+          case ObjectKind::Number:
+            return lhs.As<Number>().GetValue() < rhs.As<Number>().GetValue();
+          case ObjectKind::String:
+            return lhs.As<String>().GetValue() < rhs.As<String>().GetValue();
+          case ObjectKind::Bool:
+            return lhs.As<Bool>().GetValue() < rhs.As<Bool>().GetValue();
+          default:
+            break;
+        }
+      }
+      if (lhs_kind == ObjectKind::ClassInstance) {
+        auto &lhs_instance = lhs.As<ClassInstance>();
+        if (const Method *method = lt_cache.Find(lhs_instance, LT_METHOD, 1)) {
+          return IsTrue(lhs_instance.Call(*method, {rhs}, context));
+        }
       }
       throw std::runtime_error("Cannot compare objects for less"s);
     }
@@ -1,8 +1,22 @@
 #pragma once
 
+#include "flat_hash_map.h"
+#include "symbol.h"
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -19,30 +33,310 @@ namespace runtime
       ~Context() = default;
     };
 
+// Тип объекта Mython. Задаётся при создании объекта и позволяет определять тип без dynamic_cast.
+// Значения, начиная с User, предназначены для пользовательских наследников Object:
+// такой наследник задаёт свой тип через SetKind в конструкторе и специализирует OBJECT_KIND
+    enum class ObjectKind : unsigned char {
+      None,  // пустой ObjectHolder, у объектов не встречается
+      Other,  // тип неизвестен, для определения типа используется dynamic_cast
+      Number,
+      String,
+      Bool,
+      Class,
+      ClassInstance,
+      List,
+      Dict,
+      User = 64,
+    };
+
+// Интрузивный счётчик ссылок объекта.
+// По умолчанию неатомарный (интерпретатор однопоточный), атомарный при сборке с MYTHON_ATOMIC_REFCOUNT.
+// При копировании объекта счётчик не копируется: копия ещё никем не владеется
+    class RefCount {
+     public:
+      RefCount() = default;
+
+      RefCount(const RefCount & /*other*/) noexcept {
+      }
+
+      RefCount &operator=(const RefCount & /*other*/) noexcept {
+        return *this;
+      }
+
+      void Increment() noexcept {
+#ifdef MYTHON_ATOMIC_REFCOUNT
+        count_.fetch_add(1, std::memory_order_relaxed);
+#else
+        ++count_;
+#endif
+      }
+
+      // Уменьшает счётчик и возвращает true, если ссылок на объект больше не осталось
+      bool Decrement() noexcept {
+#ifdef MYTHON_ATOMIC_REFCOUNT
+        return count_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+#else
+        return --count_ == 0;
+#endif
+      }
+
+      [[nodiscard]] std::uint32_t Get() const noexcept {
+#ifdef MYTHON_ATOMIC_REFCOUNT
+        return count_.load(std::memory_order_relaxed);
+#else
+        return count_;
+#endif
+      }
+
+     private:
+#ifdef MYTHON_ATOMIC_REFCOUNT
+      std::atomic<std::uint32_t> count_{0};
+#else
+      std::uint32_t count_ = 0;
+#endif
+    };
+
 // Базовый класс для всех объектов языка Mython
     class Object {
      public:
       virtual ~Object() = default;
       // выводит в os своё представление в виде строки
       virtual void Print(std::ostream &os, Context &context) = 0;
+
+      [[nodiscard]] ObjectKind GetKind() const {
+        return kind_;
+      }
+
+     protected:
+      // Вызывается из конструкторов наследников, у которых есть собственный тип
+      void SetKind(ObjectKind kind) {
+        kind_ = kind;
+      }
+
+     private:
+      friend class ObjectHolder;
+
+      RefCount ref_count_;
+      ObjectKind kind_ = ObjectKind::Other;
+    };
+
+// Тип, который имеют объекты класса T (и только они).
+// Для классов, не специализирующих OBJECT_KIND, TryAs использует dynamic_cast
+    template<typename T>
+    inline constexpr ObjectKind OBJECT_KIND = ObjectKind::Other;
+
+    namespace detail
+      {
+        template<typename T>
+        constexpr ObjectKind ValueKind() {
+          if constexpr (std::is_same_v<T, int>) {
+            return ObjectKind::Number;
+          } else {
+            return ObjectKind::Other;
+          }
+        }
+      }  // namespace detail
+
+// Объект-значение, хранящий значение типа T
+    template<typename T>
+    class ValueObject
+        : public Object {
+     public:
+      ValueObject(T v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+          : value_(v) {
+        SetKind(detail::ValueKind<T>());
+      }
+
+      void Print(std::ostream &os, [[maybe_unused]] Context &context) override {
+        os << value_;
+      }
+
+      [[nodiscard]] const T &GetValue() const {
+        return value_;
+      }
+
+     protected:
+      ValueObject(T v, ObjectKind kind)
+          : value_(v) {
+        SetKind(kind);
+      }
+
+     private:
+      T value_;
+    };
+
+// Числовое значение
+    using Number = ValueObject<int>;
+
+// Логическое значение
+    class Bool
+        : public ValueObject<bool> {
+     public:
+      Bool(bool v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+          : ValueObject<bool>(v, ObjectKind::Bool) {
+      }
+
+      void Print(std::ostream &os, Context &context) override;
     };
 
+#ifndef MYTHON_SMALL_NUMBER_MIN
+#define MYTHON_SMALL_NUMBER_MIN (-128)
+#endif
+#ifndef MYTHON_SMALL_NUMBER_MAX
+#define MYTHON_SMALL_NUMBER_MAX 1024
+#endif
+
+// Неуничтожимые объекты, общие для всего процесса: True, False и кэш малых чисел.
+// ObjectHolder ссылается на них без владения, поэтому их выдача не выделяет память
+// и не меняет счётчики ссылок. None представлен пустым ObjectHolder и объекта не требует
+    namespace immortal
+      {
+        Bool &True();
+        Bool &False();
+
+        // Диапазон кэша малых чисел задаётся макросами MYTHON_SMALL_NUMBER_MIN и MYTHON_SMALL_NUMBER_MAX
+        class SmallNumbers {
+         public:
+          static constexpr int MIN = MYTHON_SMALL_NUMBER_MIN;
+          static constexpr int MAX = MYTHON_SMALL_NUMBER_MAX;
+          static_assert(MIN <= MAX);
+
+          // Возвращает объект кэша со значением value либо nullptr, если value вне диапазона кэша
+          [[nodiscard]] static Number *Find(int value) {
+            if (value < MIN || value > MAX) {
+              return nullptr;
+            }
+            static Number *const numbers = Create();
+            return numbers + (value - MIN);
+          }
+
+         private:
+          static Number *Create();
+        };
+      }  // namespace immortal
+
+// Счётчики размещения объектов через ObjectHolder::Own.
+// Показывают, сколько объектов попало в кучу и сколько выделений памяти удалось избежать
+    struct AllocationStats {
+      std::uint64_t heap_objects = 0;  // объекты, размещённые в куче
+      std::uint64_t immediate_numbers = 0;  // числа вне кэша, сохранённые внутри ObjectHolder
+      std::uint64_t cached_numbers = 0;  // числа, выданные из кэша малых чисел
+      std::uint64_t immortal_bools = 0;  // значения True и False
+      std::uint64_t stack_objects = 0;  // временные объекты, размещённые в StackRegion
+
+      [[nodiscard]] std::uint64_t AvoidedAllocations() const {
+        return immediate_numbers + cached_numbers + immortal_bools + stack_objects;
+      }
+    };
+
+    inline AllocationStats ALLOCATION_STATS;
+
+    class String;
+    class StackRegion;
+    class InlineCache;
+    class Class;
+    class ClassInstance;
+    class List;
+    class Dict;
+
+    template<>
+    inline constexpr ObjectKind OBJECT_KIND<Number> = ObjectKind::Number;
+    template<>
+    inline constexpr ObjectKind OBJECT_KIND<String> = ObjectKind::String;
+    template<>
+    inline constexpr ObjectKind OBJECT_KIND<Bool> = ObjectKind::Bool;
+    template<>
+    inline constexpr ObjectKind OBJECT_KIND<Class> = ObjectKind::Class;
+    template<>
+    inline constexpr ObjectKind OBJECT_KIND<ClassInstance> = ObjectKind::ClassInstance;
+    template<>
+    inline constexpr ObjectKind OBJECT_KIND<List> = ObjectKind::List;
+    template<>
+    inline constexpr ObjectKind OBJECT_KIND<Dict> = ObjectKind::Dict;
+
 // Специальный класс-обёртка, предназначенный для хранения объекта в Mython-программе
+// Числа вне кэша малых чисел хранятся непосредственно внутри ObjectHolder (immediate-значения)
+// и не требуют выделения памяти в куче. Остальные объекты размещаются в куче, временем их жизни
+// управляет интрузивный счётчик ссылок Object. Невладеющий ObjectHolder счётчик не использует
     class ObjectHolder {
      public:
       // Создаёт пустое значение
       ObjectHolder() = default;
 
+      ObjectHolder(const ObjectHolder &other)
+          : tag_(other.tag_) {
+        CopyFrom(other);
+      }
+
+      ObjectHolder(ObjectHolder &&other) noexcept
+          : tag_(other.tag_) {
+        MoveFrom(other);
+      }
+
+      ObjectHolder &operator=(const ObjectHolder &other) {
+        if (this != &other) {
+          // Сначала захватываем ссылку, затем освобождаем свою: other может жить внутри нашего объекта
+          ObjectHolder copy(other);
+          *this = std::move(copy);
+        }
+        return *this;
+      }
+
+      ObjectHolder &operator=(ObjectHolder &&other) noexcept {
+        if (this != &other) {
+          Object *released = Detach();
+          tag_ = other.tag_;
+          MoveFrom(other);
+          ReleaseOwned(released);
+        }
+        return *this;
+      }
+
+      ~ObjectHolder() {
+        ReleaseOwned(Detach());
+      }
+
       // Возвращает ObjectHolder, владеющий объектом типа T
       // Тип T - конкретный класс-наследник Object.
-      // object копируется или перемещается в кучу
+      // Bool и малые числа берутся из неуничтожимых объектов, остальные числа сохраняются внутри
+      // ObjectHolder, прочие объекты копируются или перемещаются в кучу
       template<typename T>
       [[nodiscard]] static ObjectHolder Own(T &&object) {
-        return ObjectHolder(std::make_shared<T>(std::forward<T>(object)));
+        using Type = std::decay_t<T>;
+        if constexpr (std::is_same_v<Type, Number>) {
+          if (Number *cached = immortal::SmallNumbers::Find(object.GetValue())) {
+            ++ALLOCATION_STATS.cached_numbers;
+            return Share(*cached);
+          }
+          ++ALLOCATION_STATS.immediate_numbers;
+          return ObjectHolder(static_cast<const Number &>(object));
+        } else if constexpr (std::is_same_v<Type, Bool>) {
+          return object.GetValue() ? True() : False();
+        } else {
+          ++ALLOCATION_STATS.heap_objects;
+          return ObjectHolder(new Type(std::forward<T>(object)));
+        }
       }
 
-      // Создаёт ObjectHolder, не владеющий объектом (аналог слабой ссылки)
-      [[nodiscard]] static ObjectHolder Share(Object &object);
+      // Возвращают ObjectHolder, ссылающиеся на неуничтожимые объекты True и False
+      [[nodiscard]] static ObjectHolder True() {
+        ++ALLOCATION_STATS.immortal_bools;
+        return Share(immortal::True());
+      }
+
+      [[nodiscard]] static ObjectHolder False() {
+        ++ALLOCATION_STATS.immortal_bools;
+        return Share(immortal::False());
+      }
+
+      // Создаёт ObjectHolder, не владеющий объектом (аналог слабой ссылки).
+      // Не выделяет память и не изменяет счётчик ссылок объекта
+      [[nodiscard]] static ObjectHolder Share(Object &object) {
+        ObjectHolder result;
+        result.ptr_ = &object;
+        result.tag_ = Tag::Borrowed;
+        return result;
+      }
       // Создаёт пустой ObjectHolder, соответствующий значению None
       [[nodiscard]] static ObjectHolder None();
 
@@ -52,51 +346,426 @@ namespace runtime
 
       Object *operator->() const;
 
-      [[nodiscard]] Object *Get() const;
+      // Для immediate-значений возвращает указатель на объект внутри ObjectHolder,
+      // он действителен, пока жив и не изменён сам ObjectHolder
+      [[nodiscard]] Object *Get() const {
+        switch (tag_) {
+          case Tag::Owned:
+          case Tag::Borrowed:
+            return ptr_;
+          case Tag::Number:
+            return ImmediateNumber();
+          default:
+            return nullptr;
+        }
+      }
+
+      // Возвращает тип хранимого объекта либо ObjectKind::None для пустого ObjectHolder
+      [[nodiscard]] ObjectKind GetKind() const {
+        switch (tag_) {
+          case Tag::Owned:
+          case Tag::Borrowed:
+            return ptr_->GetKind();
+          case Tag::Number:
+            return ObjectKind::Number;
+          default:
+            return ObjectKind::None;
+        }
+      }
 
       // Возвращает указатель на объект типа T либо nullptr, если внутри ObjectHolder не хранится
       // объект данного типа
       template<typename T>
       [[nodiscard]] T *TryAs() const {
-        return dynamic_cast<T *>(this->Get());
+        constexpr ObjectKind kind = OBJECT_KIND<std::remove_cv_t<T>>;
+        if constexpr (kind == ObjectKind::Number) {
+          if (tag_ == Tag::Number) {
+            return ImmediateNumber();
+          }
+        }
+        if constexpr (kind != ObjectKind::Other) {
+          return GetKind() == kind ? static_cast<T *>(Get()) : nullptr;
+        } else {
+          return dynamic_cast<T *>(Get());
+        }
+      }
+
+      // Возвращает ссылку на объект типа T. Тип хранимого объекта должен совпадать с T
+      template<typename T>
+      [[nodiscard]] T &As() const {
+        static_assert(OBJECT_KIND<std::remove_cv_t<T>> != ObjectKind::Other);
+        assert(GetKind() == OBJECT_KIND<std::remove_cv_t<T>>);
+        return *static_cast<T *>(Get());
+      }
+
+      // Возвращает true, если значение хранится внутри ObjectHolder без объекта в куче
+      [[nodiscard]] bool IsImmediate() const {
+        return tag_ == Tag::Number;
+      }
+
+      // Возвращает true, если ObjectHolder владеет объектом в куче (а не ссылается на него через Share)
+      [[nodiscard]] bool IsOwning() const {
+        return tag_ == Tag::Owned;
+      }
+
+      // Возвращает число владеющих ObjectHolder, ссылающихся на объект в куче, иначе 0
+      [[nodiscard]] std::uint32_t UseCount() const {
+        return tag_ == Tag::Owned ? ptr_->ref_count_.Get() : 0;
       }
 
       // Возвращает true, если ObjectHolder не пуст
-      explicit operator bool() const;
+      explicit operator bool() const {
+        return tag_ != Tag::Empty;
+      }
 
      private:
-      explicit ObjectHolder(std::shared_ptr<Object> data);
+      enum class Tag : unsigned char {
+        Empty,
+        Owned,
+        Borrowed,
+        Number,
+      };
+
+      // Принимает во владение объект, созданный в куче
+      explicit ObjectHolder(Object *owned)
+          : ptr_(owned)
+          , tag_(Tag::Owned) {
+        owned->ref_count_.Increment();
+      }
+
+      explicit ObjectHolder(const Number &number)
+          : tag_(Tag::Number) {
+        new(&storage_) Number(number);
+      }
+
       void AssertIsValid() const;
 
-      std::shared_ptr<Object> data_;
+      [[nodiscard]] Number *ImmediateNumber() const {
+        return std::launder(reinterpret_cast<Number *>(&storage_));
+      }
+
+      // Копирует значение other в ObjectHolder, tag_ которого уже совпадает с other.tag_
+      void CopyFrom(const ObjectHolder &other) {
+        switch (tag_) {
+          case Tag::Owned:
+            other.ptr_->ref_count_.Increment();
+            ptr_ = other.ptr_;
+            break;
+          case Tag::Borrowed:
+            ptr_ = other.ptr_;
+            break;
+          case Tag::Number:
+            new(&storage_) Number(*other.ImmediateNumber());
+            break;
+          default:
+            break;
+        }
+      }
+
+      // Забирает значение other, оставляя его пустым. Счётчик ссылок не меняется
+      void MoveFrom(ObjectHolder &other) {
+        if (tag_ == Tag::Owned || tag_ == Tag::Borrowed) {
+          ptr_ = other.ptr_;
+        } else {
+          CopyFrom(other);
+        }
+        other.tag_ = Tag::Empty;
+      }
+
+      // Делает ObjectHolder пустым и возвращает объект, владение которым надо освободить.
+      // У immediate-значений тривиальное разрушение, поэтому их деструктор не вызывается
+      Object *Detach() {
+        Object *owned = tag_ == Tag::Owned ? ptr_ : nullptr;
+        tag_ = Tag::Empty;
+        return owned;
+      }
+
+      static void ReleaseOwned(Object *owned) {
+        if (owned != nullptr && owned->ref_count_.Decrement()) {
+          delete owned;
+        }
+      }
+
+      union {
+        Object *ptr_;
+        mutable std::aligned_storage_t<sizeof(Number), alignof(Number)> storage_;
+      };
+      Tag tag_ = Tag::Empty;
     };
 
-// Объект-значение, хранящий значение типа T
-    template<typename T>
-    class ValueObject
+/*
+ * Строковое значение. Строка хранится либо непрерывно (плоская строка), либо как узел конкатенации
+ * (rope), ссылающийся на две строки-части: тогда конкатенация длинных строк не копирует их текст,
+ * и построение строки многократным присоединением линейно по её длине, а не квадратично.
+ * Print выводит части узла по порядку без склейки. GetValue склеивает текст узла при первом
+ * обращении (сравнение, хеширование, поиск подстроки), запоминает его и освобождает части.
+ * Части узла - всегда строки, которыми узел владеет: строки, размещённые в StackRegion
+ * или принадлежащие дереву разбора, при конкатенации копируются (см. Concat)
+ */
+    class String
         : public Object {
      public:
-      ValueObject(T v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
-          : value_(v) {
+      // Строки короче этой длины конкатенация склеивает сразу: копировать их дешевле, чем заводить узел
+      static constexpr std::size_t MIN_ROPE_SIZE = 256;
+
+      String(std::string value)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+          : value_(std::move(value)) {
+        SetKind(ObjectKind::String);
       }
 
-      void Print(std::ostream &os, [[maybe_unused]] Context &context) override {
-        os << value_;
+      String(const String &other) = default;
+      String(String &&other) noexcept = default;
+      String &operator=(const String &) = delete;
+      String &operator=(String &&) = delete;
+
+      // Части длинной цепочки конкатенаций освобождаются без рекурсии
+      ~String() override {
+        ReleaseParts();
       }
 
-      [[nodiscard]] const T &GetValue() const {
+      // Возвращает строку lhs + rhs, размещённую в region, а при region == nullptr - в куче
+      [[nodiscard]] static ObjectHolder Concat(const ObjectHolder &lhs, const ObjectHolder &rhs,
+                                               StackRegion *region);
+      // Как Concat, но lhs - временное значение, которое больше нигде не используется. Если других ссылок
+      // на строку lhs нет, текст rhs дописывается на месте в её буфер (у узла конкатенации - в буфер правой
+      // части), и результатом становится сама lhs
+      [[nodiscard]] static ObjectHolder ConcatTemporary(const ObjectHolder &lhs, const ObjectHolder &rhs,
+                                                        StackRegion *region);
+
+      void Print(std::ostream &os, Context &context) override;
+
+      // Возвращает текст строки, склеивая части узла конкатенации
+      [[nodiscard]] const std::string &GetValue() const {
+        if (left_) {
+          Flatten();
+        }
         return value_;
       }
 
+      // Длина строки. Не склеивает части узла
+      [[nodiscard]] std::size_t Size() const {
+        return left_ ? size_ : value_.size();
+      }
+
+      // Возвращает true, если строка - ещё не склеенный узел конкатенации
+      [[nodiscard]] bool IsRope() const {
+        return static_cast<bool>(left_);
+      }
+
      private:
-      T value_;
+      String(ObjectHolder left, ObjectHolder right, std::size_t size);
+
+      // Вызывает fn для каждого плоского фрагмента строки слева направо
+      template<typename Fn>
+      void ForEachChunk(Fn &&fn) const;
+
+      void Flatten() const;
+      void ReleaseParts() const;
+
+      // Текст плоской строки, у узла конкатенации пуст до склейки
+      mutable std::string value_;
+      // Части узла конкатенации, у плоской строки пусты
+      mutable ObjectHolder left_;
+      mutable ObjectHolder right_;
+      // Длина узла конкатенации
+      std::size_t size_ = 0;
+    };
+
+// Кадр вызова метода. Параметрам и локальным переменным метода при разборе программы назначаются
+// номера слотов: слот 0 занимает self, слоты 1..n - формальные параметры, далее - локальные переменные
+    class Frame {
+     public:
+      static constexpr std::size_t NO_SLOT = static_cast<std::size_t>(-1);
+
+      explicit Frame(std::size_t size);
+
+      Frame(const Frame &) = delete;
+      Frame &operator=(const Frame &) = delete;
+
+      // Возвращает значение слота либо nullptr, если слоту ещё не присвоено значение
+      [[nodiscard]] ObjectHolder *Find(std::size_t slot) {
+        assert(slot < size_);
+        return slots_[slot].bound ? &slots_[slot].value : nullptr;
+      }
+
+      // Возвращает ссылку на значение слота, помечая слот как имеющий значение
+      ObjectHolder &Bind(std::size_t slot) {
+        assert(slot < size_);
+        slots_[slot].bound = true;
+        return slots_[slot].value;
+      }
+
+      [[nodiscard]] std::size_t Size() const {
+        return size_;
+      }
+
+      // Освобождает значения слотов, начиная с first, для повторного вызова того же метода в этом кадре
+      void Reset(std::size_t first) {
+        for (std::size_t slot = first; slot < size_; ++slot) {
+          slots_[slot] = Slot{};
+        }
+      }
+
+     private:
+      struct Slot {
+        ObjectHolder value;
+        bool bound = false;
+      };
+
+      // Кадры большинства методов помещаются в слоты внутри Frame и не требуют выделения памяти
+      static constexpr std::size_t INLINE_SLOTS = 8;
+
+      std::size_t size_;
+      Slot *slots_;
+      std::array<Slot, INLINE_SLOTS> inline_slots_;
+      std::unique_ptr<Slot[]> heap_slots_;
+    };
+
+// Область размещения временных объектов, которые не покидают вычисляющее их выражение
+// (см. проход escape в optimizer.h). Объекты размещаются в заранее выделенных блоках памяти
+// и уничтожаются все сразу при возврате к запомненной границе. Границы освобождаются в порядке,
+// обратном получению, как кадры стека
+    class StackRegion {
+     public:
+      StackRegion() = default;
+      StackRegion(const StackRegion &) = delete;
+      StackRegion &operator=(const StackRegion &) = delete;
+
+      ~StackRegion() {
+        Release(0);
+      }
+
+      // Размещает копию object в области и возвращает не владеющий ей ObjectHolder.
+      // Объект живёт до вызова Release с границей, полученной до его размещения
+      template<typename T>
+      [[nodiscard]] ObjectHolder Make(T &&object) {
+        using Type = std::decay_t<T>;
+        const std::size_t block = current_block_;
+        const std::size_t offset = blocks_.empty() ? 0 : blocks_[current_block_].used;
+        auto *result = new(Allocate(sizeof(Type), alignof(Type))) Type(std::forward<T>(object));
+        entries_.push_back({result, block, offset});
+        ++ALLOCATION_STATS.stack_objects;
+        return ObjectHolder::Share(*result);
+      }
+
+      // Возвращает текущую границу области
+      [[nodiscard]] std::size_t Mark() const {
+        return entries_.size();
+      }
+
+      // Уничтожает объекты, размещённые после границы mark, и освобождает занятую ими память
+      void Release(std::size_t mark);
+
+      // Уничтожает объекты, размещённые в области за время своей жизни, в том числе при исключении
+      class Scope {
+       public:
+        explicit Scope(StackRegion &region)
+            : region_(region)
+            , mark_(region.Mark()) {
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope() {
+          region_.Release(mark_);
+        }
+
+       private:
+        StackRegion &region_;
+        std::size_t mark_;
+      };
+
+     private:
+      static constexpr std::size_t BLOCK_SIZE = 4096;
+
+      struct Block {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size = 0;
+        std::size_t used = 0;
+      };
+
+      // Объект и положение вершины области до его размещения
+      struct Entry {
+        Object *object;
+        std::size_t block;
+        std::size_t offset;
+      };
+
+      void *Allocate(std::size_t size, std::size_t alignment);
+
+      std::vector<Block> blocks_;
+      std::size_t current_block_ = 0;
+      std::vector<Entry> entries_;
     };
 
-// Таблица символов, связывающая имя объекта с его значением
-    using Closure = std::unordered_map<std::string, ObjectHolder>;
+    inline StackRegion STACK_REGION;
+
+// Прерывание итерации цикла
+    enum class LoopControl : std::uint8_t {
+      None,
+      Break,
+      Continue,
+    };
+
+// Таблица символов, связывающая имя объекта с его значением.
+// При вызове метода, переменным которого назначены слоты, Closure пуста и ссылается на кадр вызова
+    class Closure
+        : public FlatHashMap<Symbol, ObjectHolder> {
+     public:
+      using FlatHashMap::FlatHashMap;
+
+      // Возвращает кадр вызова метода либо nullptr
+      [[nodiscard]] Frame *GetFrame() const {
+        return frame_;
+      }
+
+      void SetFrame(Frame *frame) {
+        frame_ = frame;
+      }
+
+      // Признак выполненного оператора return. Пока он установлен, Compound не выполняет
+      // оставшиеся инструкции, а MethodBody сбрасывает его и возвращает результат метода
+      [[nodiscard]] bool IsReturning() const {
+        return returning_;
+      }
+
+      void SetReturning(bool returning) {
+        returning_ = returning;
+      }
+
+      // Оператор break или continue, прервавший тело цикла. Цикл сбрасывает его после каждой итерации
+      [[nodiscard]] LoopControl GetLoopControl() const {
+        return loop_control_;
+      }
+
+      void SetLoopControl(LoopControl loop_control) {
+        loop_control_ = loop_control;
+      }
+
+      // Признак return, break или continue: Compound не выполняет оставшиеся инструкции
+      [[nodiscard]] bool IsInterrupted() const {
+        return returning_ || loop_control_ != LoopControl::None;
+      }
+
+      // Признак хвостового вызова (см. ast::TailCall): MethodBody выполняет тело метода заново
+      [[nodiscard]] bool IsTailCall() const {
+        return tail_call_;
+      }
+
+      void SetTailCall(bool tail_call) {
+        tail_call_ = tail_call;
+      }
+
+     private:
+      Frame *frame_ = nullptr;
+      bool returning_ = false;
+      bool tail_call_ = false;
+      LoopControl loop_control_ = LoopControl::None;
+    };
 
 // Проверяет, содержится ли в object значение, приводимое к True
-// Для отличных от нуля чисел, True и непустых строк возвращается true. В остальных случаях - false.
+// Для отличных от нуля чисел, True, непустых строк, списков и словарей возвращается true. В остальных случаях - false.
     bool IsTrue(const ObjectHolder &object);
 
 // Интерфейс для выполнения действий над объектами Mython
@@ -108,28 +777,46 @@ namespace runtime
       virtual ObjectHolder Execute(Closure &closure, Context &context) = 0;
     };
 
-// Строковое значение
-    using String = ValueObject<std::string>;
-// Числовое значение
-    using Number = ValueObject<int>;
+// Идентификатор имени метода (селектор). Имена методов интернируются при разборе программы,
+// поэтому поиск метода в классе выполняется по номеру, без сравнения строк
+    using Selector = std::uint32_t;
 
-// Логическое значение
-    class Bool
-        : public ValueObject<bool> {
-     public:
-      using ValueObject<bool>::ValueObject;
+// Возвращает селектор имени name, регистрируя имя при первом обращении
+    Selector InternSelector(std::string_view name);
+// Возвращает селектор имени name, если такое имя уже зарегистрировано
+    std::optional<Selector> FindSelector(std::string_view name);
+// Возвращает имя, соответствующее селектору
+    const std::string &GetSelectorName(Selector selector);
 
-      void Print(std::ostream &os, Context &context) override;
+// Состояние JIT-компиляции метода (см. jit.h)
+    struct MethodJit {
+      // Машинный код метода: принимает значения параметров, при выходе за пределы
+      // поддерживаемого подмножества выставляет *bailout и возвращает управление интерпретатору
+      using Entry = std::int32_t (*)(const std::int64_t *args, std::int32_t *bailout);
+
+      // Число вызовов метода интерпретатором
+      std::uint32_t call_count = 0;
+      // Метод нельзя скомпилировать
+      bool rejected = false;
+      // Идентификатор класса self, для которого скомпилирован машинный код
+      std::uint64_t class_id = 0;
+      Entry entry = nullptr;
+      // Владеет памятью машинного кода
+      std::shared_ptr<void> code;
     };
 
 // Метод класса
     struct Method {
       // Имя метода
-      std::string name;
+      Symbol name;
       // Имена формальных параметров метода
-      std::vector<std::string> formal_params;
+      std::vector<Symbol> formal_params;
       // Тело метода
       std::unique_ptr<Executable> body;
+      // Число слотов в кадре вызова (см. Frame) либо 0, если тело метода использует только Closure
+      std::size_t frame_size = 0;
+      // Счётчик вызовов и машинный код метода
+      mutable MethodJit jit{};
     };
 
 // Класс
@@ -143,9 +830,35 @@ namespace runtime
       // Возвращает указатель на метод name или nullptr, если метод с таким именем отсутствует
       [[nodiscard]] const Method *GetMethod(const std::string &name) const;
 
+      // Возвращает указатель на метод с селектором selector (с учётом унаследованных методов)
+      // или nullptr, если такого метода нет
+      [[nodiscard]] const Method *GetMethod(Selector selector) const {
+        return selector < dispatch_table_.size() ? dispatch_table_[selector] : nullptr;
+      }
+
       // Возвращает имя класса
       [[nodiscard]] const std::string &GetName() const;
 
+      // Возвращает родительский класс либо nullptr для базового класса
+      [[nodiscard]] const Class *GetParent() const {
+        return parent_;
+      }
+
+      // Возвращает собственные (не унаследованные) методы класса
+      [[nodiscard]] const std::vector<Method> &GetMethods() const {
+        return methods_;
+      }
+      // Позволяет преобразовывать тела методов, не меняя их набор (см. optimizer.h)
+      std::vector<Method> &GetMethods() {
+        return methods_;
+      }
+
+      // Возвращает уникальный идентификатор класса. В отличие от адреса, идентификатор
+      // уничтоженного класса никогда не достаётся новому классу
+      [[nodiscard]] std::uint64_t GetId() const {
+        return id_;
+      }
+
       // Выводит в os строку "Class <имя класса>", например "Class cat"
       void Print(std::ostream &os, Context &context) override;
 
@@ -153,13 +866,61 @@ namespace runtime
       std::string name_;
       std::vector<Method> methods_;
       const Class *parent_;
+      std::uint64_t id_;
+      // Методы класса и его предков, индексированные селектором. Строится при создании класса
+      std::vector<const Method *> dispatch_table_;
+    };
+
+/*
+ * Форма экземпляра класса (скрытый класс): имена полей в порядке их добавления. Номер поля в этом
+ * порядке - номер слота, в котором экземпляр хранит значение поля.
+ * Экземпляры, получившие поля в одном порядке, разделяют одну форму. Формы образуют дерево переходов
+ * с корнем Shape::Empty(): добавление поля переводит экземпляр в дочернюю форму. Формы живут до конца
+ * программы, поэтому адрес формы однозначно её идентифицирует и служит ключом кэшей полей
+ */
+    class Shape {
+     public:
+      static constexpr std::uint32_t NO_SLOT = UINT32_MAX;
+
+      Shape(const Shape &) = delete;
+      Shape &operator=(const Shape &) = delete;
+
+      // Форма экземпляра без полей
+      static const Shape &Empty();
 
+      // Возвращает слот поля name либо NO_SLOT. Имена сравниваются как символы, по указателю
+      [[nodiscard]] std::uint32_t Find(Symbol name) const;
+      // Возвращает форму с добавленным полем name, создавая её при первом обращении
+      [[nodiscard]] const Shape &AddField(Symbol name) const;
+
+      [[nodiscard]] std::size_t Size() const {
+        return names_.size();
+      }
+
+      [[nodiscard]] Symbol GetName(std::uint32_t slot) const {
+        return names_[slot];
+      }
+
+     private:
+      Shape() = default;
+      Shape(const Shape &parent, Symbol name);
+
+      std::vector<Symbol> names_;
+      // Дочерние формы. Переходов из формы обычно один-два, поэтому они ищутся перебором
+      mutable std::vector<std::pair<Symbol, std::unique_ptr<Shape>>> transitions_;
     };
 
+    template<typename Instance>
+    class FieldsView;
+
 // Экземпляр класса
     class ClassInstance
         : public Object {
      public:
+      // Число полей, значения которых хранятся в самом объекте. Значения остальных полей
+      // хранятся в отдельном массиве
+      static constexpr std::size_t INLINE_FIELDS = 4;
+
       explicit ClassInstance(const Class &cls);
 
       /*
@@ -176,21 +937,385 @@ namespace runtime
        */
       ObjectHolder Call(const std::string &method, const std::vector<ObjectHolder> &actual_args,
                         Context &context);
+      ObjectHolder Call(Selector method, const std::vector<ObjectHolder> &actual_args, Context &context);
+      // Вызывает найденный ранее метод класса объекта. Число аргументов должно совпадать с числом параметров
+      ObjectHolder Call(const Method &method, const std::vector<ObjectHolder> &actual_args, Context &context);
 
       // Возвращает true, если объект имеет метод method, принимающий argument_count параметров
       [[nodiscard]] bool HasMethod(const std::string &method, size_t argument_count) const;
+      [[nodiscard]] bool HasMethod(Selector method, size_t argument_count) const;
+
+      // Возвращает метод method, принимающий argument_count параметров, либо nullptr
+      [[nodiscard]] const Method *FindMethod(Selector method, size_t argument_count) const {
+        const Method *method_ptr = cls_.GetMethod(method);
+        return method_ptr != nullptr && method_ptr->formal_params.size() == argument_count ? method_ptr : nullptr;
+      }
+
+      // Возвращает класс объекта
+      [[nodiscard]] const Class &GetClass() const {
+        return cls_;
+      }
+
+      // Возвращает форму объекта
+      [[nodiscard]] const Shape &GetShape() const {
+        return *shape_;
+      }
+
+      // Возвращает значение поля, хранящееся в слоте slot формы объекта
+      [[nodiscard]] ObjectHolder &GetSlot(std::uint32_t slot) {
+        return slot < INLINE_FIELDS ? inline_fields_[slot] : overflow_fields_[slot - INLINE_FIELDS];
+      }
+
+      [[nodiscard]] const ObjectHolder &GetSlot(std::uint32_t slot) const {
+        return slot < INLINE_FIELDS ? inline_fields_[slot] : overflow_fields_[slot - INLINE_FIELDS];
+      }
+
+      // Возвращает поле name либо nullptr, если такого поля нет
+      [[nodiscard]] ObjectHolder *FindField(Symbol name);
+      [[nodiscard]] const ObjectHolder *FindField(Symbol name) const;
+      // Возвращает поле name, добавляя пустое поле при его отсутствии
+      ObjectHolder &AddField(Symbol name);
+      // Переводит объект в форму next, полученную из текущей добавлением одного поля. Возвращает новое поле
+      ObjectHolder &Transition(const Shape &next);
+
+      // Возвращает представление полей объекта с интерфейсом, совместимым с Closure
+      [[nodiscard]] FieldsView<ClassInstance> Fields();
+      [[nodiscard]] FieldsView<const ClassInstance> Fields() const;
 
-      // Возвращает ссылку на Closure, содержащий поля объекта
-      [[nodiscard]] Closure &Fields();
-      // Возвращает константную ссылку на Closure, содержащую поля объекта
-      [[nodiscard]] const Closure &Fields() const;
      private:
       const Class &cls_;
-      Closure closure_;
+      const Shape *shape_;
+      std::array<ObjectHolder, INLINE_FIELDS> inline_fields_;
+      std::vector<ObjectHolder> overflow_fields_;
+    };
+
+// Представление полей экземпляра Instance (ClassInstance либо const ClassInstance) с интерфейсом,
+// совместимым с Closure: поиск по имени и обход пар (имя, значение) в порядке добавления полей
+    template<typename Instance>
+    class FieldsView {
+      using Holder = std::conditional_t<std::is_const_v<Instance>, const ObjectHolder, ObjectHolder>;
+
+     public:
+      using value_type = std::pair<Symbol, Holder &>;
+
+      class iterator {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FieldsView::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        // Позволяет обращаться к паре через it->first и it->second
+        struct Arrow {
+          value_type pair;
+
+          const value_type *operator->() const {
+            return &pair;
+          }
+        };
+
+        iterator(Instance &instance, std::uint32_t slot)
+            : instance_(&instance)
+            , slot_(slot) {
+        }
+
+        value_type operator*() const {
+          return {instance_->GetShape().GetName(slot_), instance_->GetSlot(slot_)};
+        }
+
+        Arrow operator->() const {
+          return {**this};
+        }
+
+        iterator &operator++() {
+          ++slot_;
+          return *this;
+        }
+
+        bool operator==(const iterator &other) const {
+          return instance_ == other.instance_ && slot_ == other.slot_;
+        }
+
+        bool operator!=(const iterator &other) const {
+          return !(*this == other);
+        }
+
+       private:
+        Instance *instance_;
+        std::uint32_t slot_;
+      };
+
+      explicit FieldsView(Instance &instance)
+          : instance_(instance) {
+      }
+
+      [[nodiscard]] std::size_t size() const {
+        return instance_.GetShape().Size();
+      }
+
+      [[nodiscard]] bool empty() const {
+        return size() == 0;
+      }
+
+      [[nodiscard]] iterator begin() const {
+        return {instance_, 0};
+      }
+
+      [[nodiscard]] iterator end() const {
+        return {instance_, static_cast<std::uint32_t>(size())};
+      }
+
+      [[nodiscard]] iterator find(Symbol name) const {
+        const std::uint32_t slot = instance_.GetShape().Find(name);
+        return slot == Shape::NO_SLOT ? end() : iterator{instance_, slot};
+      }
+
+      [[nodiscard]] std::size_t count(Symbol name) const {
+        return instance_.GetShape().Find(name) == Shape::NO_SLOT ? 0 : 1;
+      }
+
+      // Возвращает значение поля name. Если поля нет, выбрасывает out_of_range
+      [[nodiscard]] Holder &at(Symbol name) const {
+        Holder *value = instance_.FindField(name);
+        if (value == nullptr) {
+          throw std::out_of_range("no field " + name.GetText());
+        }
+        return *value;
+      }
+
+      // Возвращает значение поля name, добавляя пустое поле при его отсутствии
+      ObjectHolder &operator[](Symbol name) const {
+        return instance_.AddField(name);
+      }
+
+     private:
+      Instance &instance_;
+    };
+
+    inline FieldsView<ClassInstance> ClassInstance::Fields() {
+      return FieldsView<ClassInstance>(*this);
+    }
+
+    inline FieldsView<const ClassInstance> ClassInstance::Fields() const {
+      return FieldsView<const ClassInstance>(*this);
+    }
+
+// Счётчики обращений к кэшам полей
+    struct FieldCacheStats {
+      std::uint64_t hits = 0;  // форма экземпляра совпала с формой в кэше
+      std::uint64_t misses = 0;  // поле найдено по имени и добавлено в кэш
+    };
+
+    inline FieldCacheStats FIELD_CACHE_STATS;
+
+// Кэш поля в точке обращения к нему (узле дерева разбора или инструкции байткода): последняя форма
+// экземпляра, встреченная в этой точке, и слот поля в экземплярах этой формы. Для присваивания кэш
+// также помнит переход, добавивший поле: экземпляр родительской формы переводится в дочернюю без поиска
+    class FieldCache {
+     public:
+      // Возвращает поле name экземпляра instance либо nullptr. Имя для одной точки обращения не меняется
+      [[nodiscard]] ObjectHolder *Find(ClassInstance &instance, Symbol name) {
+        if (&instance.GetShape() == shape_) {
+          ++FIELD_CACHE_STATS.hits;
+          return &instance.GetSlot(slot_);
+        }
+        return FindSlow(instance, name);
+      }
+
+      // Возвращает поле name экземпляра instance, добавляя пустое поле при его отсутствии
+      ObjectHolder &Add(ClassInstance &instance, Symbol name) {
+        const Shape *shape = &instance.GetShape();
+        if (shape == shape_) {
+          ++FIELD_CACHE_STATS.hits;
+          return instance.GetSlot(slot_);
+        }
+        if (shape == parent_) {
+          ++FIELD_CACHE_STATS.hits;
+          return instance.Transition(*shape_);
+        }
+        return AddSlow(instance, name);
+      }
+
+     private:
+      ObjectHolder *FindSlow(ClassInstance &instance, Symbol name);
+      ObjectHolder &AddSlow(ClassInstance &instance, Symbol name);
+
+      const Shape *shape_ = nullptr;
+      // Форма без поля, добавление поля к которой даёт форму shape_, либо nullptr
+      const Shape *parent_ = nullptr;
+      std::uint32_t slot_ = 0;
+    };
+
+// Встроенный список. Элементы хранятся в непрерывном массиве, поэтому обращение по индексу
+// не требует вызовов методов
+    class List
+        : public Object {
+     public:
+      List();
+      explicit List(std::vector<ObjectHolder> items);
+
+      // Выводит элементы через запятую в квадратных скобках, например "[1, a, None]".
+      // Список, содержащий сам себя, выводится как "[...]"
+      void Print(std::ostream &os, Context &context) override;
+
+      [[nodiscard]] std::size_t Size() const {
+        return items_.size();
+      }
+
+      [[nodiscard]] const std::vector<ObjectHolder> &GetItems() const {
+        return items_;
+      }
+
+      // Возвращает элемент с индексом index. Отрицательный индекс отсчитывается от конца списка.
+      // Для индекса вне списка выбрасывает runtime_error
+      [[nodiscard]] ObjectHolder &At(int index);
+
+      void Append(ObjectHolder item) {
+        items_.push_back(std::move(item));
+      }
+
+      // Вызывает встроенный метод списка (append, pop) с argument_count аргументами из args.
+      // Для неизвестного метода выбрасывает runtime_error
+      ObjectHolder Call(Selector method, const ObjectHolder *args, std::size_t argument_count);
+
+     private:
+      friend bool Equal(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context, InlineCache &eq_cache);
+
+      std::vector<ObjectHolder> items_;
+      // Список выводится: защищает Print от бесконечной рекурсии
+      bool printing_ = false;
+      // Элементы списка сравниваются: защищает Equal от бесконечной рекурсии
+      mutable bool comparing_ = false;
+    };
+
+/*
+ * Возвращает хеш ключа словаря. Числа, строки, значения Bool и None хешируются по значению,
+ * классы - по адресу. Экземпляр класса с методом __hash__ хешируется по числу, которое вернул
+ * этот метод, остальные экземпляры - по адресу. Для других объектов выбрасывает runtime_error
+ */
+    std::uint64_t Hash(const ObjectHolder &object, Context &context);
+
+// Встроенный словарь. Записи хранятся в порядке добавления в непрерывном массиве, а ключ ищется
+// в отдельной таблице индексов записей с открытой адресацией и линейным пробированием.
+// Таблица из 32-битных индексов компактна, поэтому пробирование обычно не выходит за одну кэш-линию.
+// Ключи сравниваются функцией Equal; ключи разных встроенных типов не равны друг другу,
+// а экземпляр класса без метода __eq__ равен только самому себе
+    class Dict
+        : public Object {
+     public:
+      struct Entry {
+        std::uint64_t hash = 0;
+        ObjectHolder key;
+        ObjectHolder value;
+      };
+
+      Dict();
+
+      // Выводит пары в порядке добавления, например "{a: 1, 2: None}".
+      // Словарь, содержащий сам себя, выводится как "{...}"
+      void Print(std::ostream &os, Context &context) override;
+
+      [[nodiscard]] std::size_t Size() const {
+        return entries_.size();
+      }
+
+      [[nodiscard]] const std::vector<Entry> &GetEntries() const {
+        return entries_;
+      }
+
+      // Возвращает значение ключа key либо nullptr, если ключа в словаре нет
+      [[nodiscard]] const ObjectHolder *Find(const ObjectHolder &key, Context &context) const;
+      // Связывает ключ key со значением value, добавляя ключ при необходимости
+      void Set(const ObjectHolder &key, ObjectHolder value, Context &context);
+
+     private:
+      friend bool Equal(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context, InlineCache &eq_cache);
+
+      static constexpr std::uint32_t EMPTY = UINT32_MAX;
+
+      // Возвращает позицию таблицы индексов, занятую ключом key, либо первую свободную позицию
+      [[nodiscard]] std::size_t Probe(const ObjectHolder &key, std::uint64_t hash, Context &context) const;
+      // Удваивает таблицу индексов и заново раскладывает в ней записи
+      void Grow();
+
+      std::vector<Entry> entries_;
+      // Индексы записей entries_ либо EMPTY. Размер - степень двойки,
+      // позиция ключа выбирается по старшим битам произведения хеша на 2^64 / φ
+      std::vector<std::uint32_t> indices_;
+      int shift_;
+      bool printing_ = false;
+      // Значения словаря сравниваются: защищает Equal от бесконечной рекурсии
+      mutable bool comparing_ = false;
+    };
+
+// Возвращает элемент index списка или значение ключа index словаря container.
+// Если container не список и не словарь либо элемента нет, выбрасывает runtime_error
+    ObjectHolder GetItem(const ObjectHolder &container, const ObjectHolder &index, Context &context);
+// Присваивает value элементу index списка или ключу index словаря container
+    void SetItem(const ObjectHolder &container, const ObjectHolder &index, ObjectHolder value, Context &context);
+// Возвращает результат item in container: наличие ключа в словаре, элемента в списке
+// или подстроки в строке. Для остальных container выбрасывает runtime_error
+    bool Contains(const ObjectHolder &container, const ObjectHolder &item, Context &context);
+
+// Счётчики обращений к inline-кэшам методов
+    struct InlineCacheStats {
+      std::uint64_t hits = 0;  // метод найден в кэше
+      std::uint64_t misses = 0;  // метод найден через таблицу методов класса и добавлен в кэш
+      std::uint64_t megamorphic = 0;  // поиск в точке вызова, которая перестала кэшировать
+      std::uint64_t polymorphic_sites = 0;  // точки вызова, увидевшие больше одного класса
+      std::uint64_t megamorphic_sites = 0;  // точки вызова, увидевшие больше POLYMORPHIC_LIMIT классов
+    };
+
+    inline InlineCacheStats INLINE_CACHE_STATS;
+
+// Inline-кэш точки вызова метода: запоминает результат поиска метода для классов, которые
+// встречались в этой точке. Сначала кэш мономорфный, затем хранит до POLYMORPHIC_LIMIT классов,
+// после чего становится мегаморфным и каждый раз ищет метод в таблице методов класса
+    class InlineCache {
+     public:
+      static constexpr std::size_t POLYMORPHIC_LIMIT = 4;
+
+      enum class State {
+        Empty,
+        Monomorphic,
+        Polymorphic,
+        Megamorphic,
+      };
+
+      // Возвращает метод selector объекта instance, принимающий argument_count параметров, либо nullptr
+      // Селектор и число параметров для одной точки вызова не должны меняться
+      [[nodiscard]] const Method *Find(const ClassInstance &instance, Selector selector,
+                                       std::size_t argument_count) {
+        const std::uint64_t class_id = instance.GetClass().GetId();
+        for (std::size_t i = 0; i < size_; ++i) {
+          if (entries_[i].class_id == class_id) {
+            ++INLINE_CACHE_STATS.hits;
+            return entries_[i].method;
+          }
+        }
+        return FindSlow(instance, selector, argument_count);
+      }
+
+      [[nodiscard]] State GetState() const;
+
+     private:
+      struct Entry {
+        std::uint64_t class_id = 0;
+        const Method *method = nullptr;
+      };
+
+      const Method *FindSlow(const ClassInstance &instance, Selector selector, std::size_t argument_count);
+
+      std::array<Entry, POLYMORPHIC_LIMIT> entries_;
+      std::size_t size_ = 0;
+      bool megamorphic_ = false;
     };
 
 /*
- * Возвращает true, если lhs и rhs содержат одинаковые числа, строки или значения типа Bool.
+ * Возвращает true, если lhs и rhs содержат одинаковые числа, строки или значения типа Bool,
+ * либо списки одинаковой длины с попарно равными элементами, либо словари с одинаковыми ключами
+ * и равными значениями этих ключей.
  * Если lhs - объект с методом __eq__, функция возвращает результат вызова lhs.__eq__(rhs),
  * приведённый к типу Bool. Если lhs и rhs имеют значение None, функция возвращает true.
  * В остальных случаях функция выбрасывает исключение runtime_error.
@@ -207,6 +1332,9 @@ namespace runtime
  * Параметр context задаёт контекст для выполнения метода __lt__
  */
     bool Less(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context);
+// Варианты Equal и Less, которые ищут методы __eq__ и __lt__ через inline-кэш точки сравнения
+    bool Equal(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context, InlineCache &eq_cache);
+    bool Less(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context, InlineCache &lt_cache);
 // Возвращает значение, противоположное Equal(lhs, rhs, context)
     bool NotEqual(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context);
 // Возвращает значение lhs>rhs, используя функции Equal и Less
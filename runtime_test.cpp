@@ -52,6 +52,26 @@ private:
 
 int Logger::instance_count = 0;
 
+constexpr ObjectKind TAGGED_KIND = static_cast<ObjectKind>(static_cast<int>(ObjectKind::User) + 1);
+
+class Tagged : public Object {
+public:
+    Tagged() {
+        SetKind(TAGGED_KIND);
+    }
+
+    void Print(ostream& os, [[maybe_unused]] Context& context) override {
+        os << "tagged"sv;
+    }
+};
+
+}  // namespace
+
+template <>
+inline constexpr ObjectKind OBJECT_KIND<Tagged> = TAGGED_KIND;
+
+namespace {
+
 void TestNumber() {
     Number num(127);
 
@@ -71,6 +91,109 @@ void TestString() {
     ASSERT_EQUAL(word.GetValue(), "hello!"s);
 }
 
+void TestStringRope() {
+    DummyContext context;
+    const auto text = [](char c) {
+        return string(String::MIN_ROPE_SIZE, c);
+    };
+
+    // Короткие строки склеиваются сразу
+    auto short_str = String::Concat(ObjectHolder::Own(String{"ab"s}), ObjectHolder::Own(String{"cd"s}), nullptr);
+    ASSERT(!short_str.As<String>().IsRope());
+    ASSERT_EQUAL(short_str.As<String>().GetValue(), "abcd"s);
+
+    // Длинные строки становятся частями узла без копирования
+    auto lhs = ObjectHolder::Own(String{text('a')});
+    auto rhs = ObjectHolder::Own(String{text('b')});
+    auto rope = String::Concat(lhs, rhs, nullptr);
+    auto &rope_str = rope.As<String>();
+    ASSERT(rope_str.IsRope());
+    ASSERT_EQUAL(lhs.UseCount(), 2U);
+    ASSERT_EQUAL(rope_str.Size(), 2 * String::MIN_ROPE_SIZE);
+    ASSERT(IsTrue(rope));
+
+    // Print выводит части, не склеивая их
+    rope_str.Print(context.output, context);
+    ASSERT_EQUAL(context.output.str(), text('a') + text('b'));
+    ASSERT(rope_str.IsRope());
+
+    // Сравнение и хеширование склеивают строку и освобождают части
+    const auto flat = ObjectHolder::Own(String{text('a') + text('b')});
+    ASSERT_EQUAL(Hash(rope, context), Hash(flat, context));
+    ASSERT(Equal(rope, flat, context));
+    ASSERT(!rope_str.IsRope());
+    ASSERT_EQUAL(lhs.UseCount(), 1U);
+    ASSERT(Less(lhs, rope, context));
+
+    // Строка без владельца копируется в узел и может быть уничтожена раньше него
+    auto borrowed = make_unique<String>(text('c'));
+    rope = String::Concat(ObjectHolder::Share(*borrowed), rhs, nullptr);
+    borrowed.reset();
+    ASSERT_EQUAL(rope.As<String>().GetValue(), text('c') + text('b'));
+
+    // Узел в StackRegion владеет частями, размещёнными в куче
+    {
+        StackRegion region;
+        auto temp = String::Concat(lhs, rhs, &region);
+        ASSERT(!temp.IsOwning());
+        ASSERT_EQUAL(lhs.UseCount(), 2U);
+        rope = String::Concat(temp, rhs, nullptr);
+    }
+    ASSERT_EQUAL(rope.As<String>().GetValue(), text('a') + text('b') + text('b'));
+    ASSERT_EQUAL(lhs.UseCount(), 1U);
+
+    // Длинная цепочка присоединений выводится, склеивается и уничтожается без рекурсии
+    constexpr size_t APPENDS = 100'000;
+    const auto piece = ObjectHolder::Own(String{text('d')});
+    auto chain = ObjectHolder::Own(String{""s});
+    for (size_t i = 0; i < APPENDS; ++i) {
+        chain = String::Concat(chain, piece, nullptr);
+    }
+    ASSERT_EQUAL(chain.As<String>().Size(), APPENDS * String::MIN_ROPE_SIZE);
+    ostringstream out;
+    chain->Print(out, context);
+    ASSERT_EQUAL(out.str().size(), APPENDS * String::MIN_ROPE_SIZE);
+    auto copy = chain;
+    chain = String::Concat(chain, piece, nullptr);
+    copy = {};
+    ASSERT_EQUAL(chain.As<String>().GetValue().size(), (APPENDS + 1) * String::MIN_ROPE_SIZE);
+    chain = String::Concat(chain, piece, nullptr);
+    chain = {};
+    ASSERT_EQUAL(piece.UseCount(), 1U);
+}
+
+void TestConcatTemporary() {
+    // Строка без других ссылок дополняется на месте
+    auto temp = ObjectHolder::Own(String{"ab"s});
+    const Object* object = temp.Get();
+    const auto rhs = ObjectHolder::Own(String{"cd"s});
+    temp = String::ConcatTemporary(temp, rhs, nullptr);
+    ASSERT_EQUAL(temp.Get(), object);
+    ASSERT_EQUAL(temp.As<String>().GetValue(), "abcd"s);
+    ASSERT_EQUAL(rhs.As<String>().GetValue(), "cd"s);
+
+    // Строка, на которую ссылается переменная, и строка без владельца не изменяются
+    auto variable = temp;
+    auto result = String::ConcatTemporary(temp, rhs, nullptr);
+    ASSERT(result.Get() != object);
+    ASSERT_EQUAL(variable.As<String>().GetValue(), "abcd"s);
+    String constant{"ef"s};
+    result = String::ConcatTemporary(ObjectHolder::Share(constant), rhs, nullptr);
+    ASSERT_EQUAL(constant.GetValue(), "ef"s);
+    ASSERT_EQUAL(result.As<String>().GetValue(), "efcd"s);
+
+    // У узла конкатенации дополняется правая часть, если она тоже не разделяется
+    const auto head = ObjectHolder::Own(String{string(String::MIN_ROPE_SIZE, 'a')});
+    auto rope = String::Concat(head, ObjectHolder::Own(String{"b"s}), nullptr);
+    object = rope.Get();
+    rope = String::ConcatTemporary(rope, rhs, nullptr);
+    ASSERT_EQUAL(rope.Get(), object);
+    ASSERT(rope.As<String>().IsRope());
+    ASSERT_EQUAL(rope.As<String>().Size(), String::MIN_ROPE_SIZE + 3);
+    ASSERT_EQUAL(rope.As<String>().GetValue(), string(String::MIN_ROPE_SIZE, 'a') + "bcd"s);
+    ASSERT_EQUAL(head.As<String>().GetValue(), string(String::MIN_ROPE_SIZE, 'a'));
+}
+
 void TestBool() {
     Bool t(true);
     ASSERT_EQUAL(t.GetValue(), true);
@@ -180,6 +303,29 @@ void TestMethodInvocation() {
     ASSERT_THROWS(child_inst.Call("test"s, {ObjectHolder::None()}, context), runtime_error);
 }
 
+void TestFrameInvocation() {
+    DummyContext context;
+    Frame* passed_frame = nullptr;
+    size_t passed_closure_size = 0;
+    auto body = [&](Closure& closure, [[maybe_unused]] Context& ctx) {
+        passed_frame = closure.GetFrame();
+        passed_closure_size = closure.size();
+        ASSERT_EQUAL(passed_frame->Size(), 4U);
+        ASSERT(passed_frame->Find(3) == nullptr);
+        return *passed_frame->Find(2);
+    };
+    vector<Method> methods;
+    methods.push_back({"test"s, {"arg1"s, "arg2"s}, make_unique<TestMethodBody>(body), 4});
+    Class cls{"Frames"s, std::move(methods), nullptr};
+    ClassInstance instance{cls};
+
+    auto res = instance.Call("test"s, {ObjectHolder::Own(Number{1}), ObjectHolder::Own(String{"abc"s})},
+                             context);
+    ASSERT(passed_frame != nullptr);
+    ASSERT_EQUAL(passed_closure_size, 0U);
+    ASSERT_EQUAL(res.TryAs<String>()->GetValue(), "abc"s);
+}
+
 void TestNonowning() {
     ASSERT_EQUAL(Logger::instance_count, 0);
     Logger logger(784);
@@ -242,12 +388,163 @@ void TestMove() {
     }
 }
 
+void TestRefCount() {
+    ASSERT_EQUAL(Logger::instance_count, 0);
+    {
+        auto one = ObjectHolder::Own(Logger(1));
+        ASSERT(one.IsOwning());
+        ASSERT_EQUAL(one.UseCount(), 1U);
+        {
+            ObjectHolder two = one;
+            ASSERT_EQUAL(one.UseCount(), 2U);
+            ASSERT(two.Get() == one.Get());
+
+            // Невладеющая ссылка не меняет счётчик
+            auto shared = ObjectHolder::Share(*one);
+            ASSERT(!shared.IsOwning());
+            ASSERT_EQUAL(shared.UseCount(), 0U);
+            ASSERT_EQUAL(one.UseCount(), 2U);
+
+            two = two;  // NOLINT
+            ASSERT_EQUAL(one.UseCount(), 2U);
+            two = ObjectHolder::None();
+            ASSERT_EQUAL(one.UseCount(), 1U);
+            ASSERT_EQUAL(Logger::instance_count, 1);
+        }
+        ObjectHolder three = std::move(one);
+        ASSERT_EQUAL(three.UseCount(), 1U);
+        one = three;
+        ASSERT_EQUAL(three.UseCount(), 2U);
+        three = ObjectHolder::Own(Logger(2));
+        ASSERT_EQUAL(one.UseCount(), 1U);
+        ASSERT_EQUAL(Logger::instance_count, 2);
+    }
+    ASSERT_EQUAL(Logger::instance_count, 0);
+
+    // Копия объекта начинает с собственным счётчиком
+    Logger logger(3);
+    auto owned = ObjectHolder::Own(Logger(logger));
+    auto copy = ObjectHolder::Own(Logger(*owned.TryAs<Logger>()));
+    ASSERT_EQUAL(owned.UseCount(), 1U);
+    ASSERT_EQUAL(copy.UseCount(), 1U);
+}
+
 void TestNullptr() {
     ObjectHolder oh;
     ASSERT(!oh);
     ASSERT(!oh.Get());
 }
 
+void TestImmediate() {
+    DummyContext context;
+
+    auto num = ObjectHolder::Own(Number{100'042});
+    ASSERT(num);
+    ASSERT(num.IsImmediate());
+    ASSERT(num.TryAs<Number>() != nullptr && num.TryAs<Number>()->GetValue() == 100'042);
+    ASSERT(num.TryAs<Object>() == num.Get());
+    ASSERT(num.TryAs<Bool>() == nullptr);
+    ASSERT(num.TryAs<String>() == nullptr);
+
+    ObjectHolder copy = num;
+    ASSERT(copy.IsImmediate());
+    ASSERT(copy.Get() != num.Get());
+    ASSERT_EQUAL(copy.TryAs<Number>()->GetValue(), 100'042);
+
+    Number boxed{100'042};
+    auto shared = ObjectHolder::Share(boxed);
+    ASSERT(!shared.IsImmediate());
+    ASSERT(Equal(num, shared, context));
+    ASSERT(Equal(shared, num, context));
+    ASSERT(Less(ObjectHolder::Own(Number{100'041}), shared, context));
+    ASSERT(!Less(shared, ObjectHolder::Own(Number{100'041}), context));
+
+    auto yes = ObjectHolder::Own(Bool{true});
+    ASSERT(IsTrue(yes));
+    ASSERT(!IsTrue(ObjectHolder::Own(Bool{false})));
+    ASSERT(yes.TryAs<Number>() == nullptr);
+    Bool boxed_yes{true};
+    ASSERT(Equal(yes, ObjectHolder::Share(boxed_yes), context));
+
+    num->Print(context.output, context);
+    context.output << ' ';
+    yes->Print(context.output, context);
+    ASSERT_EQUAL(context.output.str(), "100042 True"s);
+
+    ObjectHolder moved = std::move(num);
+    ASSERT(!num);  // NOLINT
+    ASSERT_EQUAL(moved.TryAs<Number>()->GetValue(), 100'042);
+
+    moved = ObjectHolder::Own(String{"str"s});
+    ASSERT(!moved.IsImmediate());
+    ASSERT(moved.TryAs<Number>() == nullptr);
+    ASSERT_EQUAL(moved.TryAs<String>()->GetValue(), "str"s);
+}
+
+void TestImmortal() {
+    const AllocationStats before = ALLOCATION_STATS;
+
+    auto yes = ObjectHolder::Own(Bool{true});
+    auto no = ObjectHolder::Own(Bool{false});
+    ASSERT(yes.Get() == &immortal::True());
+    ASSERT(no.Get() == &immortal::False());
+    ASSERT(ObjectHolder::True().Get() == yes.Get());
+    ASSERT(ObjectHolder::False().Get() == no.Get());
+    ASSERT(!yes.IsOwning() && !yes.IsImmediate());
+    ASSERT_EQUAL(yes.UseCount(), 0U);
+
+    using immortal::SmallNumbers;
+    auto zero = ObjectHolder::Own(Number{0});
+    ASSERT(zero.Get() == ObjectHolder::Own(Number{0}).Get());
+    ASSERT(!zero.IsOwning() && !zero.IsImmediate());
+    ASSERT(ObjectHolder::Own(Number{SmallNumbers::MIN}).Get() == SmallNumbers::Find(SmallNumbers::MIN));
+    ASSERT(ObjectHolder::Own(Number{SmallNumbers::MAX}).Get() == SmallNumbers::Find(SmallNumbers::MAX));
+    ASSERT(ObjectHolder::Own(Number{SmallNumbers::MIN - 1}).IsImmediate());
+    ASSERT(ObjectHolder::Own(Number{SmallNumbers::MAX + 1}).IsImmediate());
+    ASSERT(SmallNumbers::Find(SmallNumbers::MAX + 1) == nullptr);
+    ASSERT_EQUAL(SmallNumbers::Find(-1)->GetValue(), -1);
+
+    const AllocationStats& after = ALLOCATION_STATS;
+    ASSERT_EQUAL(after.heap_objects, before.heap_objects);
+    ASSERT_EQUAL(after.immortal_bools - before.immortal_bools, 4U);
+    ASSERT_EQUAL(after.cached_numbers - before.cached_numbers, 4U);
+    ASSERT_EQUAL(after.immediate_numbers - before.immediate_numbers, 2U);
+
+    auto str = ObjectHolder::Own(String{"heap"s});
+    ASSERT_EQUAL(after.heap_objects - before.heap_objects, 1U);
+}
+
+void TestObjectKind() {
+    ASSERT(ObjectHolder::None().GetKind() == ObjectKind::None);
+    ASSERT(ObjectHolder::Own(Number{1}).GetKind() == ObjectKind::Number);
+    ASSERT(ObjectHolder::Own(Bool{true}).GetKind() == ObjectKind::Bool);
+    ASSERT(ObjectHolder::Own(String{"s"s}).GetKind() == ObjectKind::String);
+
+    Number boxed{5};
+    ASSERT(ObjectHolder::Share(boxed).GetKind() == ObjectKind::Number);
+    ASSERT(ObjectHolder::Share(boxed).TryAs<Number>() == &boxed);
+    ASSERT(ObjectHolder::Share(boxed).TryAs<String>() == nullptr);
+
+    Class cls{"Test"s, {}, nullptr};
+    ClassInstance instance{cls};
+    ASSERT(ObjectHolder::Share(cls).GetKind() == ObjectKind::Class);
+    ASSERT(ObjectHolder::Share(cls).TryAs<Class>() == &cls);
+    ASSERT(ObjectHolder::Share(cls).TryAs<ClassInstance>() == nullptr);
+    ASSERT(ObjectHolder::Share(instance).GetKind() == ObjectKind::ClassInstance);
+    ASSERT(ObjectHolder::Share(instance).TryAs<ClassInstance>() == &instance);
+
+    // Объекты без собственного типа определяются через dynamic_cast
+    Logger logger;
+    ASSERT(ObjectHolder::Share(logger).GetKind() == ObjectKind::Other);
+    ASSERT(ObjectHolder::Share(logger).TryAs<Logger>() == &logger);
+    ASSERT(ObjectHolder::Share(logger).TryAs<Number>() == nullptr);
+
+    Tagged tagged;
+    ASSERT(ObjectHolder::Share(tagged).GetKind() == TAGGED_KIND);
+    ASSERT(ObjectHolder::Share(tagged).TryAs<Tagged>() == &tagged);
+    ASSERT(ObjectHolder::Share(tagged).TryAs<ClassInstance>() == nullptr);
+}
+
 void TestIsTrue() {
     {
         ASSERT(!IsTrue(ObjectHolder::Own(Bool{false})));
@@ -518,7 +815,9 @@ void TestClassInstance() {
     Class cls{"Test"s, move(methods), nullptr};
     ClassInstance instance{cls};
 
-    ASSERT_EQUAL(&instance.Fields(), &const_cast<const ClassInstance&>(instance).Fields());
+    // Константное и неконстантное представления полей показывают одни и те же поля
+    instance.Fields()["x"s] = ObjectHolder::Own(Number{1});
+    ASSERT_EQUAL(&instance.Fields().at("x"s), &const_cast<const ClassInstance&>(instance).Fields().at("x"s));
     ASSERT(instance.HasMethod("__str__"s, 0));
 
     ostringstream out;
@@ -529,17 +828,386 @@ void TestClassInstance() {
     ASSERT_THROWS(instance.Call("missing_method"s, {}, ctx), runtime_error);
 }
 
+void TestShapes() {
+    Class cls{"Point"s, {}, nullptr};
+    ClassInstance a{cls};
+    ClassInstance b{cls};
+    ClassInstance c{cls};
+    ASSERT_EQUAL(&a.GetShape(), &Shape::Empty());
+    a.Fields()["x"s] = ObjectHolder::Own(Number{1});
+    a.Fields()["y"s] = ObjectHolder::Own(Number{2});
+    b.Fields()["x"s] = ObjectHolder::Own(Number{3});
+    b.Fields()["y"s] = ObjectHolder::Own(Number{4});
+    c.Fields()["y"s] = ObjectHolder::Own(Number{5});
+    c.Fields()["x"s] = ObjectHolder::Own(Number{6});
+    // Поля, добавленные в одном порядке, дают одну форму
+    ASSERT_EQUAL(&a.GetShape(), &b.GetShape());
+    ASSERT(&a.GetShape() != &c.GetShape());
+    ASSERT_EQUAL(a.GetShape().Find("y"sv), 1U);
+    ASSERT_EQUAL(c.GetShape().Find("y"sv), 0U);
+    ASSERT_EQUAL(a.GetShape().Find("z"sv), Shape::NO_SLOT);
+    ASSERT_EQUAL(b.FindField("y"sv)->As<Number>().GetValue(), 4);
+    ASSERT(b.FindField("z"sv) == nullptr);
+    ASSERT_THROWS((void)b.Fields().at("z"s), out_of_range);
+
+    // Поля сверх INLINE_FIELDS хранятся в отдельном массиве, обход идёт в порядке добавления
+    for (int i = 0; i < 10; ++i) {
+        a.Fields()["f"s + to_string(i)] = ObjectHolder::Own(Number{i});
+    }
+    ASSERT_EQUAL(a.Fields().size(), 12U);
+    ASSERT_EQUAL(a.Fields().count("f9"s), 1U);
+    ASSERT_EQUAL(a.Fields().at("f9"s).As<Number>().GetValue(), 9);
+    vector<string> names;
+    for (const auto& [name, value] : a.Fields()) {
+        ASSERT(value);
+        names.push_back(name);
+    }
+    ASSERT_EQUAL(names.size(), 12U);
+    ASSERT_EQUAL(names[1], "y"s);
+    ASSERT_EQUAL(names[11], "f9"s);
+    const ClassInstance copy = a;
+    ASSERT_EQUAL(&copy.GetShape(), &a.GetShape());
+    ASSERT_EQUAL(copy.Fields().at("f7"s).As<Number>().GetValue(), 7);
+
+    // Кэш поля запоминает форму и слот, а для присваивания - переход к дочерней форме
+    FieldCache read;
+    FieldCache write;
+    const auto stats = FIELD_CACHE_STATS;
+    ClassInstance b_copy = b;
+    b_copy.Fields()["y"s] = ObjectHolder::Own(Number{9});
+    ASSERT_EQUAL(read.Find(b, "y"sv)->As<Number>().GetValue(), 4);
+    ASSERT_EQUAL(read.Find(b_copy, "y"sv)->As<Number>().GetValue(), 9);
+    ASSERT(read.Find(c, "z"sv) == nullptr);
+    ClassInstance d{cls};
+    ClassInstance e{cls};
+    write.Add(d, "x"s) = ObjectHolder::Own(Number{7});
+    write.Add(e, "x"s) = ObjectHolder::Own(Number{8});
+    ASSERT_EQUAL(&e.GetShape(), &d.GetShape());
+    ASSERT_EQUAL(e.Fields().at("x"s).As<Number>().GetValue(), 8);
+    ASSERT_EQUAL(FIELD_CACHE_STATS.hits - stats.hits, 2U);
+    ASSERT_EQUAL(FIELD_CACHE_STATS.misses - stats.misses, 2U);
+}
+
+void TestList() {
+    List list;
+    ASSERT(!IsTrue(ObjectHolder::Share(list)));
+    list.Append(ObjectHolder::Own(Number{1}));
+    list.Append(ObjectHolder::Own(String{"a"s}));
+    list.Append(ObjectHolder::None());
+    ASSERT_EQUAL(list.Size(), 3U);
+    ASSERT(IsTrue(ObjectHolder::Share(list)));
+    ASSERT_EQUAL(list.At(0).As<Number>().GetValue(), 1);
+    ASSERT_EQUAL(list.At(-2).As<String>().GetValue(), "a"s);
+    ASSERT_THROWS((void)list.At(3), runtime_error);
+    ASSERT_THROWS((void)list.At(-4), runtime_error);
+
+    DummyContext context;
+    list.Print(context.output, context);
+    ASSERT_EQUAL(context.output.str(), "[1, a, None]"s);
+
+    // Список, содержащий сам себя
+    auto nested = ObjectHolder::Own(List{});
+    nested.As<List>().Append(nested);
+    ostringstream out;
+    nested->Print(out, context);
+    ASSERT_EQUAL(out.str(), "[[...]]"s);
+    // Сравнение списков, содержащих сами себя, не уходит в бесконечную рекурсию
+    ASSERT(Equal(nested, nested, context));
+    auto other = ObjectHolder::Own(List{});
+    other.As<List>().Append(other);
+    ASSERT(Equal(nested, other, context));
+    other.As<List>().Append(ObjectHolder::Own(Number{1}));
+    ASSERT(!Equal(nested, other, context));
+    other.As<List>().At(0) = {};
+    nested.As<List>().At(0) = {};
+
+    const auto copy = ObjectHolder::Own(List{list.GetItems()});
+    ASSERT(Equal(ObjectHolder::Share(list), copy, context));
+    copy.As<List>().At(0) = ObjectHolder::Own(Number{2});
+    ASSERT(!Equal(ObjectHolder::Share(list), copy, context));
+    ASSERT(!Equal(ObjectHolder::Share(list), ObjectHolder::Own(List{}), context));
+
+    const auto append = InternSelector("append"s);
+    const auto item = ObjectHolder::True();
+    ASSERT(!list.Call(append, &item, 1));
+    ASSERT_EQUAL(list.Size(), 4U);
+    ASSERT_THROWS(list.Call(InternSelector("push"s), &item, 1), runtime_error);
+    ASSERT_THROWS(list.Call(append, nullptr, 0), runtime_error);
+
+    ASSERT_EQUAL(GetItem(ObjectHolder::Share(list), ObjectHolder::Own(Number{3}), context).As<Bool>().GetValue(), true);
+    ASSERT_THROWS(GetItem(ObjectHolder::Own(Number{1}), ObjectHolder::Own(Number{0}), context), runtime_error);
+    ASSERT_THROWS(GetItem(ObjectHolder::Share(list), ObjectHolder::Own(String{"0"s}), context), runtime_error);
+    ASSERT(Contains(ObjectHolder::Share(list), ObjectHolder::Own(String{"a"s}), context));
+    ASSERT(!Contains(ObjectHolder::Share(list), ObjectHolder::Own(Number{5}), context));
+
+    // pop удаляет и возвращает последний элемент
+    const auto pop = InternSelector("pop"s);
+    ASSERT(list.Call(pop, nullptr, 0).As<Bool>().GetValue());
+    ASSERT_EQUAL(list.Size(), 3U);
+    ASSERT_THROWS(list.Call(pop, &item, 1), runtime_error);
+    ASSERT_THROWS(List{}.Call(pop, nullptr, 0), runtime_error);
+}
+
+void TestDict() {
+    DummyContext context;
+    Dict dict;
+    ASSERT(!IsTrue(ObjectHolder::Share(dict)));
+    const auto one = ObjectHolder::Own(Number{1});
+    dict.Set(one, ObjectHolder::Own(String{"one"s}), context);
+    dict.Set(ObjectHolder::True(), ObjectHolder::Own(Number{2}), context);
+    dict.Set(ObjectHolder::Own(String{"a"s}), ObjectHolder::None(), context);
+    dict.Set(ObjectHolder::None(), ObjectHolder::Own(Number{3}), context);
+    ASSERT_EQUAL(dict.Size(), 4U);
+    ASSERT(IsTrue(ObjectHolder::Share(dict)));
+    // Ключи разных типов не равны, даже если их хеши совпадают
+    ASSERT_EQUAL(dict.Find(one, context)->As<String>().GetValue(), "one"s);
+    ASSERT_EQUAL(dict.Find(ObjectHolder::True(), context)->As<Number>().GetValue(), 2);
+    ASSERT(dict.Find(ObjectHolder::False(), context) == nullptr);
+    ASSERT(dict.Find(ObjectHolder::Own(String{"1"s}), context) == nullptr);
+    // Повторное присваивание заменяет значение, не меняя порядок ключей
+    dict.Set(ObjectHolder::Own(Number{1}), ObjectHolder::Own(Number{10}), context);
+    ASSERT_EQUAL(dict.Size(), 4U);
+    dict.Print(context.output, context);
+    ASSERT_EQUAL(context.output.str(), "{1: 10, True: 2, a: None, None: 3}"s);
+
+    // Таблица индексов расширяется, все ключи остаются доступны
+    Dict large;
+    for (int i = 0; i < 10000; ++i) {
+        large.Set(ObjectHolder::Own(String{to_string(i)}), ObjectHolder::Own(Number{i}), context);
+        large.Set(ObjectHolder::Own(Number{i * 1024}), ObjectHolder::Own(Number{i}), context);
+    }
+    ASSERT_EQUAL(large.Size(), 20000U);
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_EQUAL(large.Find(ObjectHolder::Own(String{to_string(i)}), context)->As<Number>().GetValue(), i);
+        ASSERT_EQUAL(large.Find(ObjectHolder::Own(Number{i * 1024}), context)->As<Number>().GetValue(), i);
+    }
+    ASSERT(large.Find(ObjectHolder::Own(Number{1}), context) == nullptr);
+
+    // Словари равны независимо от порядка добавления ключей
+    const auto lhs = ObjectHolder::Own(Dict{});
+    const auto rhs = ObjectHolder::Own(Dict{});
+    SetItem(lhs, ObjectHolder::Own(Number{1}), ObjectHolder::Own(Number{2}), context);
+    SetItem(lhs, ObjectHolder::Own(String{"b"s}), ObjectHolder::None(), context);
+    SetItem(rhs, ObjectHolder::Own(String{"b"s}), ObjectHolder::None(), context);
+    ASSERT(!Equal(lhs, rhs, context));
+    SetItem(rhs, ObjectHolder::Own(Number{1}), ObjectHolder::Own(Number{2}), context);
+    ASSERT(Equal(lhs, rhs, context));
+    SetItem(rhs, ObjectHolder::Own(Number{1}), ObjectHolder::Own(Number{3}), context);
+    ASSERT(!Equal(lhs, rhs, context));
+
+    ASSERT_EQUAL(GetItem(lhs, ObjectHolder::Own(Number{1}), context).As<Number>().GetValue(), 2);
+    ASSERT_THROWS(GetItem(lhs, ObjectHolder::Own(Number{2}), context), runtime_error);
+    ASSERT(Contains(lhs, ObjectHolder::Own(String{"b"s}), context));
+    ASSERT(!Contains(lhs, ObjectHolder::Own(String{"c"s}), context));
+    ASSERT_THROWS(SetItem(lhs, ObjectHolder::Own(List{}), ObjectHolder::None(), context), runtime_error);
+    ASSERT_THROWS((void)Hash(lhs, context), runtime_error);
+    ASSERT(Contains(ObjectHolder::Own(String{"hello"s}), ObjectHolder::Own(String{"ell"s}), context));
+    ASSERT_THROWS(Contains(ObjectHolder::Own(Number{1}), one, context), runtime_error);
+}
+
+void TestFlatHashMap() {
+    FlatHashMap<string, int> map = {{"a"s, 1}, {"b"s, 2}};
+    ASSERT_EQUAL(map.size(), 2U);
+    ASSERT_EQUAL(map.at("a"s), 1);
+    ASSERT_THROWS(map.at("c"s), out_of_range);
+    ASSERT(map.find("c"s) == map.end());
+    ASSERT_EQUAL(map.count("b"s), 1U);
+    // emplace и insert не заменяют существующее значение
+    ASSERT(!map.emplace("a"s, 10).second);
+    ASSERT(!map.insert({"b"s, 20}).second);
+    ASSERT_EQUAL(map.at("a"s), 1);
+    map["c"s] = 3;
+    ASSERT_EQUAL(map.size(), 3U);
+
+    // Таблица расширяется далеко за пределы одной группы, все ключи остаются доступны
+    for (int i = 0; i < 10000; ++i) {
+        map["key"s + to_string(i)] = i;
+    }
+    ASSERT_EQUAL(map.size(), 10003U);
+    for (int i = 0; i < 10000; ++i) {
+        const string key = "key"s + to_string(i);
+        ASSERT_EQUAL(map.at(key), i);
+        ASSERT_EQUAL(map.find(key)->second, i);
+    }
+    ASSERT(map.find("key10000"s) == map.end());
+    size_t total = 0;
+    for (const auto& [key, value] : map) {
+        total += value;
+    }
+    ASSERT_EQUAL(total, 6U + 9999U * 10000U / 2U);
+
+    // Копия независима от исходной таблицы, перемещённая таблица пуста
+    FlatHashMap<string, int> copy = map;
+    copy["a"s] = 100;
+    ASSERT_EQUAL(map.at("a"s), 1);
+    ASSERT_EQUAL(copy.at("a"s), 100);
+    FlatHashMap<string, int> moved = std::move(copy);
+    ASSERT_EQUAL(moved.size(), 10003U);
+    ASSERT(copy.empty());
+    moved.clear();
+    ASSERT(moved.empty());
+    ASSERT(moved.find("a"s) == moved.end());
+    moved["a"s] = 5;
+    ASSERT_EQUAL(moved.at("a"s), 5);
+}
+
+void TestSymbols() {
+    const Symbol name = "counter"s;
+    const auto stats = GetSymbolStats();
+    // Повторное интернирование возвращает тот же символ, не добавляя записей в таблицу
+    const Symbol same = "counter"sv;
+    ASSERT(name == same);
+    ASSERT_EQUAL(&name.GetText(), &same.GetText());
+    ASSERT_EQUAL(name.GetHash(), hash<string_view>{}("counter"sv));
+    ASSERT_EQUAL(GetSymbolStats().symbols, stats.symbols);
+    ASSERT_EQUAL(GetSymbolStats().interned, stats.interned + 1);
+    ASSERT(name != Symbol("count"s));
+    ASSERT(Symbol() == Symbol(""s));
+
+    // Сравнение с обычными строками не интернирует их
+    const auto before = GetSymbolStats().symbols;
+    ASSERT(name == "counter"s);
+    ASSERT(name != "other_counter"sv);
+    ASSERT("counter" == name);
+    ASSERT_EQUAL(GetSymbolStats().symbols, before);
+    ostringstream os;
+    os << name;
+    ASSERT_EQUAL(os.str(), "counter"s);
+
+    // Closure ищет переменные по символу
+    Closure closure;
+    closure[name] = ObjectHolder::Own(Number{1});
+    ASSERT_EQUAL(closure.at("counter"s).As<Number>().GetValue(), 1);
+    ASSERT_EQUAL(closure.begin()->first.GetText(), "counter"s);
+}
+
+void TestDispatchTable() {
+    auto returns = [](int value) {
+        return make_unique<TestMethodBody>([value](Closure&, Context&) {
+            return ObjectHolder::Own(Number{value});
+        });
+    };
+
+    // Глубокая иерархия: каждый уровень добавляет свой метод и перекрывает "value"
+    constexpr int DEPTH = 50;
+    vector<unique_ptr<Class>> hierarchy;
+    for (int level = 0; level < DEPTH; ++level) {
+        vector<Method> methods;
+        methods.push_back({"value"s, {}, returns(level)});
+        methods.push_back({"level_"s + to_string(level), {}, returns(level)});
+        if (level == 0) {
+            // Из одноимённых методов класса используется объявленный первым
+            methods.push_back({"value"s, {}, returns(-1)});
+            methods.push_back({"base"s, {"x"s}, returns(100)});
+        }
+        const Class* parent = hierarchy.empty() ? nullptr : hierarchy.back().get();
+        hierarchy.push_back(make_unique<Class>("Level"s + to_string(level), move(methods), parent));
+    }
+
+    DummyContext context;
+    const Class& base = *hierarchy.front();
+    const Class& leaf = *hierarchy.back();
+    ClassInstance base_inst{base};
+    ClassInstance leaf_inst{leaf};
+
+    ASSERT(Equal(base_inst.Call("value"s, {}, context), ObjectHolder::Own(Number{0}), context));
+    ASSERT(Equal(leaf_inst.Call("value"s, {}, context), ObjectHolder::Own(Number{DEPTH - 1}), context));
+    ASSERT(Equal(leaf_inst.Call("level_0"s, {}, context), ObjectHolder::Own(Number{0}), context));
+    ASSERT(Equal(leaf_inst.Call("base"s, {ObjectHolder::None()}, context),
+                 ObjectHolder::Own(Number{100}), context));
+    ASSERT(!base_inst.HasMethod("level_1"s, 0));
+    ASSERT(!leaf_inst.HasMethod("base"s, 0));
+    ASSERT(!leaf_inst.HasMethod("never_interned_method_name"s, 0));
+
+    for (int level = 0; level < DEPTH; ++level) {
+        const string name = "level_"s + to_string(level);
+        const auto selector = FindSelector(name);
+        ASSERT(selector.has_value());
+        ASSERT_EQUAL(GetSelectorName(*selector), name);
+        ASSERT_EQUAL(InternSelector(name), *selector);
+        ASSERT(leaf.GetMethod(name) != nullptr);
+        ASSERT_EQUAL(leaf.GetMethod(name), leaf.GetMethod(*selector));
+        ASSERT_EQUAL(leaf.GetMethod(*selector), hierarchy[level]->GetMethod(*selector));
+    }
+    ASSERT(leaf.GetMethod("never_interned_method_name"s) == nullptr);
+}
+
+void TestInlineCache() {
+    const Selector selector = InternSelector("cached"s);
+    vector<unique_ptr<Class>> classes;
+    for (size_t i = 0; i <= InlineCache::POLYMORPHIC_LIMIT; ++i) {
+        vector<Method> methods;
+        methods.push_back({"cached"s, {}, make_unique<TestMethodBody>(nullptr)});
+        classes.push_back(make_unique<Class>("C"s + to_string(i), move(methods), nullptr));
+    }
+
+    InlineCache cache;
+    ASSERT(cache.GetState() == InlineCache::State::Empty);
+
+    INLINE_CACHE_STATS = {};
+    ClassInstance first{*classes[0]};
+    ASSERT_EQUAL(cache.Find(first, selector, 0), classes[0]->GetMethod(selector));
+    ASSERT_EQUAL(cache.Find(first, selector, 0), classes[0]->GetMethod(selector));
+    ASSERT(cache.GetState() == InlineCache::State::Monomorphic);
+    ASSERT_EQUAL(INLINE_CACHE_STATS.misses, 1U);
+    ASSERT_EQUAL(INLINE_CACHE_STATS.hits, 1U);
+
+    // Несовпадение числа аргументов тоже кэшируется
+    InlineCache arity_cache;
+    ASSERT(arity_cache.Find(first, selector, 1) == nullptr);
+    ASSERT(arity_cache.Find(first, selector, 1) == nullptr);
+    ASSERT_EQUAL(INLINE_CACHE_STATS.hits, 2U);
+
+    for (size_t i = 1; i < InlineCache::POLYMORPHIC_LIMIT; ++i) {
+        ClassInstance instance{*classes[i]};
+        ASSERT_EQUAL(cache.Find(instance, selector, 0), classes[i]->GetMethod(selector));
+        ASSERT(cache.GetState() == InlineCache::State::Polymorphic);
+    }
+    ASSERT_EQUAL(INLINE_CACHE_STATS.polymorphic_sites, 1U);
+
+    ClassInstance last{*classes.back()};
+    ASSERT_EQUAL(cache.Find(last, selector, 0), classes.back()->GetMethod(selector));
+    ASSERT(cache.GetState() == InlineCache::State::Megamorphic);
+    ASSERT_EQUAL(cache.Find(first, selector, 0), classes[0]->GetMethod(selector));
+    ASSERT_EQUAL(INLINE_CACHE_STATS.megamorphic_sites, 1U);
+    ASSERT_EQUAL(INLINE_CACHE_STATS.megamorphic, 1U);
+
+    // Класс, созданный на месте уничтоженного, не должен получить его метод из кэша
+    InlineCache stale_cache;
+    {
+        vector<Method> methods;
+        methods.push_back({"cached"s, {}, make_unique<TestMethodBody>(nullptr)});
+        Class temporary{"Temporary"s, move(methods), nullptr};
+        ClassInstance instance{temporary};
+        ASSERT(stale_cache.Find(instance, selector, 0) != nullptr);
+    }
+    Class replacement{"Replacement"s, {}, nullptr};
+    ClassInstance instance{replacement};
+    ASSERT(stale_cache.Find(instance, selector, 0) == nullptr);
+}
+
 }  // namespace
 
 void RunObjectsTests(TestRunner& tr) {
     RUN_TEST(tr, runtime::TestNumber);
     RUN_TEST(tr, runtime::TestString);
+    RUN_TEST(tr, runtime::TestStringRope);
+    RUN_TEST(tr, runtime::TestConcatTemporary);
     RUN_TEST(tr, runtime::TestBool);
     RUN_TEST(tr, runtime::TestMethodInvocation);
+    RUN_TEST(tr, runtime::TestFrameInvocation);
+    RUN_TEST(tr, runtime::TestObjectKind);
     RUN_TEST(tr, runtime::TestIsTrue);
     RUN_TEST(tr, runtime::TestComparison);
     RUN_TEST(tr, runtime::TestClass);
     RUN_TEST(tr, runtime::TestClassInstance);
+    RUN_TEST(tr, runtime::TestShapes);
+    RUN_TEST(tr, runtime::TestList);
+    RUN_TEST(tr, runtime::TestDict);
+    RUN_TEST(tr, runtime::TestFlatHashMap);
+    RUN_TEST(tr, runtime::TestSymbols);
+    RUN_TEST(tr, runtime::TestDispatchTable);
+    RUN_TEST(tr, runtime::TestInlineCache);
 }
 
 void RunObjectHolderTests(TestRunner& tr) {
@@ -547,6 +1215,9 @@ void RunObjectHolderTests(TestRunner& tr) {
     RUN_TEST(tr, runtime::TestOwning);
     RUN_TEST(tr, runtime::TestMove);
     RUN_TEST(tr, runtime::TestNullptr);
+    RUN_TEST(tr, runtime::TestRefCount);
+    RUN_TEST(tr, runtime::TestImmediate);
+    RUN_TEST(tr, runtime::TestImmortal);
 }
 
 }  // namespace runtime
\ No newline at end of file
@@ -13,52 +13,120 @@ namespace ast
 
     namespace
       {
-        const std::string ADD_METHOD = "__add__"s;
-        const std::string INIT_METHOD = "__init__"s;
+        const runtime::Selector ADD_METHOD = runtime::InternSelector("__add__"sv);
+        const runtime::Selector INIT_METHOD = runtime::InternSelector("__init__"sv);
+
+        // Подменяет кадр вызова в closure на время выполнения подставленного тела метода
+        class FrameScope {
+         public:
+          FrameScope(Closure &closure, runtime::Frame &frame)
+              : closure_(closure)
+              , saved_(closure.GetFrame()) {
+            closure_.SetFrame(&frame);
+          }
+
+          FrameScope(const FrameScope &) = delete;
+          FrameScope &operator=(const FrameScope &) = delete;
+
+          ~FrameScope() {
+            closure_.SetFrame(saved_);
+          }
+
+         private:
+          Closure &closure_;
+          runtime::Frame *saved_;
+        };
+
+        // Возвращает строку value, размещённую в region либо, если region не задан, в куче
+        ObjectHolder MakeString(std::string value, runtime::StackRegion *region) {
+          if (region != nullptr) {
+            return region->Make(runtime::String{std::move(value)});
+          }
+          return ObjectHolder::Own(runtime::String{std::move(value)});
+        }
+
+        // Сбрасывает break и continue после итерации цикла. Возвращает true, если цикл завершается
+        // оператором break либо return
+        bool EndIteration(Closure &closure) {
+          if (closure.IsReturning()) {
+            return true;
+          }
+          const bool stop = closure.GetLoopControl() == runtime::LoopControl::Break;
+          closure.SetLoopControl(runtime::LoopControl::None);
+          return stop;
+        }
+
+        // Возвращает ссылку на переменную name: слот кадра, если он назначен, иначе элемент closure.
+        // Ссылка на элемент Closure действительна только до следующей вставки в closure
+        ObjectHolder &BindVariable(Closure &closure, std::size_t slot, runtime::Symbol name) {
+          if (runtime::Frame *frame = closure.GetFrame(); frame != nullptr && slot != runtime::Frame::NO_SLOT) {
+            return frame->Bind(slot);
+          }
+          return closure[name];
+        }
+
+        runtime::StackRegion *RegionIf(bool in_stack_region) {
+          return in_stack_region ? &runtime::STACK_REGION : nullptr;
+        }
        } // namespace
 
-    class RuntimeReturnExeption;
+    VariableValue::VariableValue(runtime::Symbol var_name)
+        : dotted_ids_{var_name} {
+    }
 
-    VariableValue::VariableValue(const std::string &var_name) {
-      dotted_ids_.push_back(var_name);
+    VariableValue::VariableValue(std::vector<runtime::Symbol> dotted_ids)
+        : dotted_ids_(std::move(dotted_ids))
+        , field_caches_(dotted_ids_.size() - 1) {
     }
 
-    VariableValue::VariableValue(std::vector<std::string> dotted_ids)
-        : dotted_ids_(std::move(dotted_ids)) {
+    VariableValue::VariableValue(std::vector<runtime::Symbol> dotted_ids, std::size_t slot)
+        : dotted_ids_(std::move(dotted_ids))
+        , slot_(slot)
+        , field_caches_(dotted_ids_.size() - 1) {
     }
 
     ObjectHolder VariableValue::Execute(Closure &closure, Context & /* context */) {
-      Closure *closure_ptr = &closure;
-      for (size_t i = 0; i < dotted_ids_.size(); ++i) {
-        const std::string &field_name = dotted_ids_[i];
-        if (closure_ptr->count(field_name) == 0) {
-          throw std::runtime_error("Cant find var"s);
-        }
-        if (i == dotted_ids_.size() - 1) {
-          return closure_ptr->at(field_name);
-        }
-        auto ptr_obj = closure_ptr->at(field_name).TryAs<runtime::ClassInstance>();
+      const ObjectHolder *value = nullptr;
+      if (runtime::Frame *frame = closure.GetFrame(); frame != nullptr && slot_ != runtime::Frame::NO_SLOT) {
+        value = frame->Find(slot_);
+      } else if (const auto it = closure.find(dotted_ids_.front()); it != closure.end()) {
+        value = &it->second;
+      }
+      if (value == nullptr) {
+        throw std::runtime_error("Cant find var"s);
+      }
+      for (size_t i = 1; i < dotted_ids_.size(); ++i) {
+        auto ptr_obj = value->TryAs<runtime::ClassInstance>();
         if (!ptr_obj) {
           throw std::runtime_error("This isn't object"s);
         }
-        closure_ptr = &ptr_obj->Fields();
+        value = field_caches_[i - 1].Find(*ptr_obj, dotted_ids_[i]);
+        if (value == nullptr) {
+          throw std::runtime_error("Cant find var"s);
+        }
       }
-      return {};
+      return *value;
+    }
+
+    Assignment::Assignment(runtime::Symbol var, std::unique_ptr<Statement> rv)
+        : var_(var)
+        , rv_(std::move(rv)) {
     }
 
-    Assignment::Assignment(std::string var, std::unique_ptr<Statement> rv)
-        : var_(std::move(var))
+    Assignment::Assignment(runtime::Symbol var, std::size_t slot, std::unique_ptr<Statement> rv)
+        : var_(var)
+        , slot_(slot)
         , rv_(std::move(rv)) {
     }
 
     ObjectHolder Assignment::Execute(Closure &closure, Context &context) {
-      closure[var_] = rv_->Execute(closure, context);
-      return closure[var_];
+      auto value = rv_->Execute(closure, context);
+      return BindVariable(closure, slot_, var_) = std::move(value);
     }
 
-    FieldAssignment::FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv)
+    FieldAssignment::FieldAssignment(VariableValue object, runtime::Symbol field_name, std::unique_ptr<Statement> rv)
         : object_(std::move(object))
-        , field_name_(std::move(field_name))
+        , field_name_(field_name)
         , rv_(std::move(rv)) {
     }
 
@@ -66,12 +134,67 @@ namespace ast
       const auto obj = object_.Execute(closure, context);
       const auto class_inst_ptr = obj.TryAs<runtime::ClassInstance>();
       if (class_inst_ptr) {
-        class_inst_ptr->Fields()[field_name_] = rv_->Execute(closure, context);
-        return class_inst_ptr->Fields()[field_name_];
+        // Значение вычисляется до поиска поля: выражение может добавить объекту поля
+        auto value = rv_->Execute(closure, context);
+        return field_cache_.Add(*class_inst_ptr, field_name_) = std::move(value);
       }
       throw std::runtime_error("Cant find field"s);
     }
 
+    ListLiteral::ListLiteral(std::vector<std::unique_ptr<Statement>> items)
+        : items_(std::move(items)) {
+    }
+
+    ObjectHolder ListLiteral::Execute(Closure &closure, Context &context) {
+      std::vector<ObjectHolder> items;
+      items.reserve(items_.size());
+      for (const auto &item: items_) {
+        items.push_back(item->Execute(closure, context));
+      }
+      return ObjectHolder::Own(runtime::List(std::move(items)));
+    }
+
+    DictLiteral::DictLiteral(std::vector<std::unique_ptr<Statement>> keys,
+                             std::vector<std::unique_ptr<Statement>> values)
+        : keys_(std::move(keys))
+        , values_(std::move(values)) {
+    }
+
+    ObjectHolder DictLiteral::Execute(Closure &closure, Context &context) {
+      auto result = ObjectHolder::Own(runtime::Dict());
+      auto &dict = result.As<runtime::Dict>();
+      for (std::size_t i = 0; i < keys_.size(); ++i) {
+        const auto key = keys_[i]->Execute(closure, context);
+        dict.Set(key, values_[i]->Execute(closure, context), context);
+      }
+      return result;
+    }
+
+    Index::Index(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index)
+        : object_(std::move(object))
+        , index_(std::move(index)) {
+    }
+
+    ObjectHolder Index::Execute(Closure &closure, Context &context) {
+      const auto object = object_->Execute(closure, context);
+      return runtime::GetItem(object, index_->Execute(closure, context), context);
+    }
+
+    IndexAssignment::IndexAssignment(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index,
+                                     std::unique_ptr<Statement> rv)
+        : object_(std::move(object))
+        , index_(std::move(index))
+        , rv_(std::move(rv)) {
+    }
+
+    ObjectHolder IndexAssignment::Execute(Closure &closure, Context &context) {
+      const auto object = object_->Execute(closure, context);
+      const auto index = index_->Execute(closure, context);
+      auto value = rv_->Execute(closure, context);
+      runtime::SetItem(object, index, value, context);
+      return value;
+    }
+
     NewInstance::NewInstance(const runtime::Class &class_)
         : cls_(class_) {
     }
@@ -81,69 +204,136 @@ namespace ast
         , args_(std::move(args)) {
     }
 
+    ObjectHolder InlinedMethod::Execute(ObjectHolder self, const std::vector<std::unique_ptr<Statement>> &args,
+                                        Closure &closure, Context &context) const {
+      runtime::Frame frame(method->frame_size);
+      frame.Bind(0) = std::move(self);
+      // Аргументы вычисляются в кадре вызывающего метода
+      for (std::size_t i = 0; i < args.size(); ++i) {
+        frame.Bind(i + 1) = args[i]->Execute(closure, context);
+      }
+      FrameScope scope(closure, frame);
+      return body->Execute(closure, context);
+    }
+
     ObjectHolder NewInstance::Execute(Closure &closure, Context &context) {
-      std::vector<runtime::ObjectHolder> actual_args;
-      for (const auto& arg : args_) {
-        actual_args.push_back(arg->Execute(closure, context));
+      if (init_.body) {
+        init_.Execute(ObjectHolder::Share(cls_), args_, closure, context);
+      } else {
+        std::vector<runtime::ObjectHolder> actual_args;
+        for (const auto &arg: args_) {
+          actual_args.push_back(arg->Execute(closure, context));
+        }
+        if (const runtime::Method *init = cls_.FindMethod(INIT_METHOD, args_.size())) {
+          cls_.Call(*init, actual_args, context);
+        }
       }
-      if (cls_.HasMethod(INIT_METHOD, args_.size())) {
-        cls_.Call(INIT_METHOD, actual_args, context);
+      if (in_stack_region_) {
+        return runtime::STACK_REGION.Make(runtime::ClassInstance{cls_});
       }
       return runtime::ObjectHolder::Own(runtime::ClassInstance{cls_});
     }
 
-    MethodCall::MethodCall(std::unique_ptr<Statement> object, std::string method_name,
+    MethodCall::MethodCall(std::unique_ptr<Statement> object, runtime::Symbol method_name,
                            std::vector<std::unique_ptr<Statement>> args)
         : object_(std::move(object))
-        , method_name_(std::move(method_name))
+        , method_name_(method_name)
+        , selector_(runtime::InternSelector(method_name_))
         , args_(std::move(args)) {
     }
 
     ObjectHolder MethodCall::Execute(Closure &closure, Context &context) {
-      const auto obj = object_->Execute(closure, context);
+      return Call(object_->Execute(closure, context), closure, context);
+    }
+
+    ObjectHolder MethodCall::Call(const ObjectHolder &obj, Closure &closure, Context &context) {
       const auto class_instance_ptr = obj.TryAs<runtime::ClassInstance>();
-      if (obj && class_instance_ptr && class_instance_ptr->HasMethod(method_name_, args_.size())) {
+      if (class_instance_ptr == nullptr) {
+        if (auto *list = obj.TryAs<runtime::List>()) {
+          std::vector<runtime::ObjectHolder> actual_args;
+          actual_args.reserve(args_.size());
+          for (const auto &arg: args_) {
+            actual_args.push_back(arg->Execute(closure, context));
+          }
+          return list->Call(selector_, actual_args.data(), actual_args.size());
+        }
+        return {};
+      }
+      if (const runtime::Method *method = cache_.Find(*class_instance_ptr, selector_, args_.size())) {
         std::vector<runtime::ObjectHolder> actual_args;
         for (const auto &arg: args_) {
           actual_args.push_back(arg->Execute(closure, context));
         }
-        return class_instance_ptr->Call(method_name_, actual_args, context);
+        return class_instance_ptr->Call(*method, actual_args, context);
       }
       return {};
     }
 
+    InlinedCall::InlinedCall(std::unique_ptr<Statement> object, runtime::Symbol method,
+                             std::vector<std::unique_ptr<Statement>> args, InlinedMethod inlined)
+        : MethodCall(std::move(object), method, std::move(args))
+        , inlined_(std::move(inlined)) {
+    }
+
+    ObjectHolder InlinedCall::Execute(Closure &closure, Context &context) {
+      auto obj = object_->Execute(closure, context);
+      const auto *instance = obj.TryAs<runtime::ClassInstance>();
+      // Проверка, защищающая подстановку: у класса объекта тот же метод, что и при подстановке
+      if (instance == nullptr || instance->GetClass().GetMethod(selector_) != inlined_.method) {
+        return Call(obj, closure, context);
+      }
+      return inlined_.Execute(std::move(obj), args_, closure, context);
+    }
+
+    TailCall::TailCall(std::unique_ptr<Statement> object, runtime::Symbol method,
+                       std::vector<std::unique_ptr<Statement>> args, const runtime::Method *callee)
+        : MethodCall(std::move(object), method, std::move(args))
+        , callee_(callee) {
+    }
+
+    ObjectHolder TailCall::Execute(Closure &closure, Context &context) {
+      auto obj = object_->Execute(closure, context);
+      const auto *instance = obj.TryAs<runtime::ClassInstance>();
+      runtime::Frame *frame = closure.GetFrame();
+      if (frame == nullptr || instance == nullptr || instance->GetClass().GetMethod(selector_) != callee_) {
+        return Call(obj, closure, context);
+      }
+      // Аргументы вычисляются до изменения кадра: они могут ссылаться на параметры текущего вызова
+      std::vector<ObjectHolder> actual_args;
+      actual_args.reserve(args_.size());
+      for (const auto &arg: args_) {
+        actual_args.push_back(arg->Execute(closure, context));
+      }
+      frame->Reset(1);
+      for (std::size_t i = 0; i < actual_args.size(); ++i) {
+        frame->Bind(i + 1) = std::move(actual_args[i]);
+      }
+      closure.SetTailCall(true);
+      return {};
+    }
+
     void Compound::AddStatement(std::unique_ptr<Statement> stmt) {
       statements_.push_back(std::move(stmt));
     }
 
     ObjectHolder Compound::Execute(Closure &closure, Context &context) {
       for (const auto &statement: statements_) {
-        statement->Execute(closure, context);
+        auto result = statement->Execute(closure, context);
+        if (closure.IsInterrupted()) {
+          return result;
+        }
       }
       return {};
     }
 
-    class RuntimeReturnExeption
-        : public std::exception {
-     public:
-      explicit RuntimeReturnExeption(const runtime::ObjectHolder &obj)
-          : obj_(obj) {
-      }
-
-      runtime::ObjectHolder GetValue() {
-        return obj_;
-      }
-
-     private:
-      runtime::ObjectHolder obj_;
-    };
-
     Return::Return(std::unique_ptr<Statement> statement)
         : statement_(std::move(statement)) {
     }
 
     ObjectHolder Return::Execute(Closure &closure, Context &context) {
-      throw RuntimeReturnExeption(statement_->Execute(closure, context));
+      auto result = statement_->Execute(closure, context);
+      closure.SetReturning(true);
+      return result;
     }
 
     MethodBody::MethodBody(std::unique_ptr<Statement> &&body)
@@ -151,13 +341,17 @@ namespace ast
     }
 
     ObjectHolder MethodBody::Execute(Closure &closure, Context &context) {
-
-      try {
-        body_->Execute(closure, context);
-      } catch (RuntimeReturnExeption &runtimeReturnExeption) {
-        return runtimeReturnExeption.GetValue();
+      auto result = body_->Execute(closure, context);
+      // TailCall записал в кадр аргументы следующего вызова: тело выполняется заново
+      while (closure.IsTailCall()) {
+        closure.SetTailCall(false);
+        closure.SetReturning(false);
+        result = body_->Execute(closure, context);
+      }
+      if (closure.IsReturning()) {
+        closure.SetReturning(false);
+        return result;
       }
-
       return {};
     }
 
@@ -167,7 +361,7 @@ namespace ast
 
     ObjectHolder ClassDefinition::Execute(Closure &closure, Context & /* context */) {
       const auto obj = cls_.TryAs<runtime::Class>();
-      closure[obj->GetName()] = std::move(cls_);
+      closure[obj->GetName()] = cls_;
       return {};
     }
 
@@ -203,21 +397,31 @@ namespace ast
     }
 
     ObjectHolder Stringify::Execute(Closure &closure, Context &context) {
-      auto obj = argument_->Execute(closure, context);
+      return Apply(argument_->Execute(closure, context), RegionIf(in_stack_region_));
+    }
+
+    ObjectHolder Stringify::Apply(const ObjectHolder &obj, runtime::StackRegion *region) {
       if (!obj) {
-        return ObjectHolder::Own(runtime::String{"None"s});
+        return MakeString("None"s, region);
       }
       runtime::DummyContext dummy_context;
       obj->Print(dummy_context.output, dummy_context);
-      return ObjectHolder::Own(runtime::String{dummy_context.output.str()});
+      return MakeString(dummy_context.output.str(), region);
     }
 
     ObjectHolder Add::Execute(Closure &closure, Context &context) {
       if (!rhs_ || !lhs_) {
         throw std::runtime_error("null operands are not supported"s);
       }
+      // Значения переменных и полей возвращаются копиями ObjectHolder, поэтому левый операнд с единственной
+      // ссылкой - временное значение, например результат вложенного сложения
       const auto obj_lhs = lhs_->Execute(closure, context);
       const auto obj_rhs = rhs_->Execute(closure, context);
+      return Apply(obj_lhs, obj_rhs, context, cache_, RegionIf(in_stack_region_), true);
+    }
+
+    ObjectHolder Add::Apply(const ObjectHolder &obj_lhs, const ObjectHolder &obj_rhs, Context &context,
+                            runtime::InlineCache &cache, runtime::StackRegion *region, bool lhs_temporary) {
       {
         const auto ptr_lhs_n = obj_lhs.TryAs<runtime::Number>();
         const auto ptr_rhs_n = obj_rhs.TryAs<runtime::Number>();
@@ -234,17 +438,15 @@ namespace ast
         const auto ptr_rhs_s = obj_rhs.TryAs<runtime::String>();
 
         if (ptr_lhs_s != nullptr && ptr_rhs_s != nullptr) {
-          const auto l_str = ptr_lhs_s->GetValue();
-          const auto r_str = ptr_rhs_s->GetValue();
-
-          return ObjectHolder::Own(runtime::String{l_str + r_str});
+          return lhs_temporary ? runtime::String::ConcatTemporary(obj_lhs, obj_rhs, region)
+                               : runtime::String::Concat(obj_lhs, obj_rhs, region);
         }
       }
       auto ptr_lhs_class_inst = obj_lhs.TryAs<runtime::ClassInstance>();
 
       if (ptr_lhs_class_inst != nullptr) {
-        if (ptr_lhs_class_inst->HasMethod(ADD_METHOD, 1)) {
-          return ptr_lhs_class_inst->Call(ADD_METHOD, {obj_rhs}, context);
+        if (const runtime::Method *method = cache.Find(*ptr_lhs_class_inst, ADD_METHOD, 1)) {
+          return ptr_lhs_class_inst->Call(*method, {obj_rhs}, context);
         }
       }
 
@@ -258,7 +460,10 @@ namespace ast
 
       const auto obj_lhs = lhs_->Execute(closure, context);
       const auto obj_rhs = rhs_->Execute(closure, context);
+      return Apply(obj_lhs, obj_rhs);
+    }
 
+    ObjectHolder Sub::Apply(const ObjectHolder &obj_lhs, const ObjectHolder &obj_rhs) {
       const auto ptr_lhs_n = obj_lhs.TryAs<runtime::Number>();
       const auto ptr_rhs_n = obj_rhs.TryAs<runtime::Number>();
 
@@ -278,7 +483,10 @@ namespace ast
       }
       const auto obj_lhs = lhs_->Execute(closure, context);
       const auto obj_rhs = rhs_->Execute(closure, context);
+      return Apply(obj_lhs, obj_rhs);
+    }
 
+    ObjectHolder Mult::Apply(const ObjectHolder &obj_lhs, const ObjectHolder &obj_rhs) {
       const auto ptr_lhs_n = obj_lhs.TryAs<runtime::Number>();
       const auto ptr_rhs_n = obj_rhs.TryAs<runtime::Number>();
 
@@ -299,7 +507,10 @@ namespace ast
 
       const auto obj_lhs = lhs_->Execute(closure, context);
       const auto obj_rhs = rhs_->Execute(closure, context);
+      return Apply(obj_lhs, obj_rhs);
+    }
 
+    ObjectHolder Div::Apply(const ObjectHolder &obj_lhs, const ObjectHolder &obj_rhs) {
       const auto ptr_lhs_n = obj_lhs.TryAs<runtime::Number>();
       const auto ptr_rhs_n = obj_rhs.TryAs<runtime::Number>();
 
@@ -323,14 +534,14 @@ namespace ast
       }
       const auto l_obj = lhs_->Execute(closure, context);
       if (runtime::IsTrue(l_obj)) {
-        return ObjectHolder::Own(runtime::Bool{true});
+        return ObjectHolder::True();
       }
       const auto r_obj = rhs_->Execute(closure, context);
       if (runtime::IsTrue(r_obj)) {
-        return ObjectHolder::Own(runtime::Bool{true});
+        return ObjectHolder::True();
       }
 
-      return ObjectHolder::Own(runtime::Bool{false});
+      return ObjectHolder::False();
     }
 
     ObjectHolder And::Execute(Closure &closure, Context &context) {
@@ -339,14 +550,14 @@ namespace ast
       }
       const auto &l_obj = lhs_->Execute(closure, context);
       if (!runtime::IsTrue(l_obj)) {
-        return ObjectHolder::Own(runtime::Bool{false});
+        return ObjectHolder::False();
       }
       const auto &r_obj = rhs_->Execute(closure, context);
-      if (runtime::IsTrue(l_obj) && runtime::IsTrue(r_obj)) {
-        return ObjectHolder::Own(runtime::Bool{true});
+      if (runtime::IsTrue(r_obj)) {
+        return ObjectHolder::True();
       }
 
-      return ObjectHolder::Own(runtime::Bool{false});
+      return ObjectHolder::False();
     }
 
     ObjectHolder Not::Execute(Closure &closure, Context &context) {
@@ -354,26 +565,117 @@ namespace ast
         throw std::runtime_error("null operands are not supported"s);
       }
       const auto obj = argument_->Execute(closure, context);
-      const auto res = runtime::IsTrue(obj);
-      return ObjectHolder::Own(runtime::Bool{!res});
+      return runtime::IsTrue(obj) ? ObjectHolder::False() : ObjectHolder::True();
     }
 
-    Comparison::Comparison(Comparator cmp, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs)
-        : BinaryOperation(std::move(lhs), std::move(rhs))
-        , cmp_(std::move(cmp)) {
+    ObjectHolder Negate::Execute(Closure &closure, Context &context) {
+      if (!argument_) {
+        throw std::runtime_error("null operands are not supported"s);
+      }
+      return Apply(argument_->Execute(closure, context));
     }
 
-    ObjectHolder Comparison::Execute(Closure &closure, Context &context) {
+    ObjectHolder Negate::Apply(const ObjectHolder &object) {
+      if (const auto *number = object.TryAs<runtime::Number>()) {
+        return ObjectHolder::Own(runtime::Number{-number->GetValue()});
+      }
+      throw std::runtime_error("incorrect negate operand"s);
+    }
+
+    ObjectHolder Length::Execute(Closure &closure, Context &context) {
+      return Apply(argument_->Execute(closure, context));
+    }
+
+    ObjectHolder Length::Apply(const ObjectHolder &object) {
+      std::size_t length;
+      if (const auto *list = object.TryAs<runtime::List>()) {
+        length = list->Size();
+      } else if (const auto *dict = object.TryAs<runtime::Dict>()) {
+        length = dict->Size();
+      } else if (const auto *str = object.TryAs<runtime::String>()) {
+        length = str->Size();
+      } else {
+        throw std::runtime_error("object has no len()"s);
+      }
+      return ObjectHolder::Own(runtime::Number{static_cast<int>(length)});
+    }
+
+    ObjectHolder Contains::Execute(Closure &closure, Context &context) {
+      const auto item = lhs_->Execute(closure, context);
+      const auto container = rhs_->Execute(closure, context);
+      return runtime::Contains(container, item, context) ? ObjectHolder::True() : ObjectHolder::False();
+    }
+
+    namespace
+      {
+        template<Comparator cmp, typename T>
+        bool CompareValues(const T &lhs, const T &rhs) {
+          if constexpr (cmp == Comparator::Equal) {
+            return lhs == rhs;
+          } else if constexpr (cmp == Comparator::NotEqual) {
+            return lhs != rhs;
+          } else if constexpr (cmp == Comparator::Less) {
+            return lhs < rhs;
+          } else if constexpr (cmp == Comparator::Greater) {
+            return lhs > rhs;
+          } else if constexpr (cmp == Comparator::LessOrEqual) {
+            return lhs <= rhs;
+          } else {
+            return lhs >= rhs;
+          }
+        }
+      } // namespace
+
+    template<Comparator cmp>
+    ObjectHolder Comparison<cmp>::Execute(Closure &closure, Context &context) {
       if (!rhs_ || !lhs_) {
         throw std::runtime_error("null operands are not supported"s);
       }
       const auto l_obj = lhs_->Execute(closure, context);
       const auto r_obj = rhs_->Execute(closure, context);
-      const bool res = cmp_(l_obj, r_obj, context);
-
-      return ObjectHolder::Own(runtime::Bool{res});
+      return Apply(l_obj, r_obj, context, eq_cache_, lt_cache_) ? ObjectHolder::True() : ObjectHolder::False();
+    }
+
+    template<Comparator cmp>
+    bool Comparison<cmp>::Apply(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context,
+                                runtime::InlineCache &eq_cache, runtime::InlineCache &lt_cache) {
+      using runtime::ObjectKind;
+      const ObjectKind lhs_kind = lhs.GetKind();
+      if (lhs_kind == rhs.GetKind()) {
+        switch (lhs_kind) {
+          case ObjectKind::Number:
+            return CompareValues<cmp>(lhs.As<runtime::Number>().GetValue(), rhs.As<runtime::Number>().GetValue());
+          case ObjectKind::String:
+            return CompareValues<cmp>(lhs.As<runtime::String>().GetValue(), rhs.As<runtime::String>().GetValue());
+          case ObjectKind::Bool:
+            return CompareValues<cmp>(lhs.As<runtime::Bool>().GetValue(), rhs.As<runtime::Bool>().GetValue());
+          default:
+            break;
+        }
+      }
+      // Остальные случаи, в том числе вызовы __eq__ и __lt__, выполняются так же, как в runtime::Greater и др.
+      if constexpr (cmp == Comparator::Equal) {
+        return runtime::Equal(lhs, rhs, context, eq_cache);
+      } else if constexpr (cmp == Comparator::NotEqual) {
+        return !runtime::Equal(lhs, rhs, context, eq_cache);
+      } else if constexpr (cmp == Comparator::Less) {
+        return runtime::Less(lhs, rhs, context, lt_cache);
+      } else if constexpr (cmp == Comparator::Greater) {
+        return !(runtime::Less(lhs, rhs, context, lt_cache) || runtime::Equal(lhs, rhs, context, eq_cache));
+      } else if constexpr (cmp == Comparator::LessOrEqual) {
+        return runtime::Less(lhs, rhs, context, lt_cache) || runtime::Equal(lhs, rhs, context, eq_cache);
+      } else {
+        return !runtime::Less(lhs, rhs, context, lt_cache);
+      }
     }
 
+    template class Comparison<Comparator::Equal>;
+    template class Comparison<Comparator::NotEqual>;
+    template class Comparison<Comparator::Less>;
+    template class Comparison<Comparator::Greater>;
+    template class Comparison<Comparator::LessOrEqual>;
+    template class Comparison<Comparator::GreaterOrEqual>;
+
     IfElse::IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
                    std::unique_ptr<Statement> else_body)
         : condition_(std::move(condition))
@@ -393,4 +695,90 @@ namespace ast
       }
     }
 
-  } // namespace ast
\ No newline at end of file
+    While::While(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> body)
+        : condition_(std::move(condition))
+        , body_(std::move(body)) {
+    }
+
+    ObjectHolder While::Execute(Closure &closure, Context &context) {
+      while (runtime::IsTrue(condition_->Execute(closure, context))) {
+        auto result = body_->Execute(closure, context);
+        if (EndIteration(closure)) {
+          return closure.IsReturning() ? result : ObjectHolder{};
+        }
+      }
+      return {};
+    }
+
+    ForRange::ForRange(runtime::Symbol var, std::size_t slot, std::unique_ptr<Statement> begin,
+                       std::unique_ptr<Statement> end, std::unique_ptr<Statement> body)
+        : var_(var)
+        , slot_(slot)
+        , begin_(std::move(begin))
+        , end_(std::move(end))
+        , body_(std::move(body)) {
+    }
+
+    ObjectHolder ForRange::Execute(Closure &closure, Context &context) {
+      const auto begin = begin_->Execute(closure, context);
+      const auto end = end_->Execute(closure, context);
+      if (begin.GetKind() != runtime::ObjectKind::Number || end.GetKind() != runtime::ObjectKind::Number) {
+        throw std::runtime_error("range() arguments must be numbers"s);
+      }
+      // Переменная получает значение только на итерациях: для пустого диапазона она не создаётся
+      const int last = end.As<runtime::Number>().GetValue();
+      for (int i = begin.As<runtime::Number>().GetValue(); i < last; ++i) {
+        BindVariable(closure, slot_, var_) = ObjectHolder::Own(runtime::Number{i});
+        auto result = body_->Execute(closure, context);
+        if (EndIteration(closure)) {
+          return closure.IsReturning() ? result : ObjectHolder{};
+        }
+      }
+      return {};
+    }
+
+    ForEach::ForEach(runtime::Symbol var, std::size_t slot, std::unique_ptr<Statement> iterable,
+                     std::unique_ptr<Statement> body)
+        : var_(var)
+        , slot_(slot)
+        , iterable_(std::move(iterable))
+        , body_(std::move(body)) {
+    }
+
+    ObjectHolder ForEach::Execute(Closure &closure, Context &context) {
+      // Цикл владеет списком: тело может присвоить переменной, через которую он получен, другое значение
+      const auto iterable = iterable_->Execute(closure, context);
+      auto *list = iterable.TryAs<runtime::List>();
+      if (list == nullptr) {
+        throw std::runtime_error("object is not iterable"s);
+      }
+      for (std::size_t i = 0; i < list->Size(); ++i) {
+        BindVariable(closure, slot_, var_) = list->GetItems()[i];
+        auto result = body_->Execute(closure, context);
+        if (EndIteration(closure)) {
+          return closure.IsReturning() ? result : ObjectHolder{};
+        }
+      }
+      return {};
+    }
+
+    ObjectHolder Break::Execute(Closure &closure, Context & /* context */) {
+      closure.SetLoopControl(runtime::LoopControl::Break);
+      return {};
+    }
+
+    ObjectHolder Continue::Execute(Closure &closure, Context & /* context */) {
+      closure.SetLoopControl(runtime::LoopControl::Continue);
+      return {};
+    }
+
+    StackScope::StackScope(std::unique_ptr<Statement> body)
+        : body_(std::move(body)) {
+    }
+
+    ObjectHolder StackScope::Execute(Closure &closure, Context &context) {
+      runtime::StackRegion::Scope scope(runtime::STACK_REGION);
+      return body_->Execute(closure, context);
+    }
+
+  } // namespace ast
@@ -2,7 +2,25 @@
 
 #include "runtime.h"
 
-#include <functional>
+namespace vm
+  {
+    class Compiler;
+  }  // namespace vm
+
+namespace cache
+  {
+    class ProgramWriter;
+  }  // namespace cache
+
+namespace jit
+  {
+    class Compiler;
+  }  // namespace jit
+
+namespace opt
+  {
+    class TreeAccess;
+  }  // namespace opt
 
 namespace ast
   {
@@ -18,10 +36,20 @@ namespace ast
 
       runtime::ObjectHolder Execute(runtime::Closure & /*closure*/,
                                     runtime::Context & /*context*/) override {
-        return runtime::ObjectHolder::Share(value_);
+        // Числа и логические значения возвращаются как immediate-значения
+        if constexpr (std::is_same_v<T, runtime::Number> || std::is_same_v<T, runtime::Bool>) {
+          return runtime::ObjectHolder::Own(T(value_));
+        } else {
+          return runtime::ObjectHolder::Share(value_);
+        }
       }
 
      private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class jit::Compiler;
+      friend class opt::TreeAccess;
+
       T value_;
     };
 
@@ -41,38 +69,142 @@ namespace ast
     class VariableValue
         : public Statement {
      public:
-      explicit VariableValue(const std::string& var_name);
-      explicit VariableValue(std::vector<std::string> dotted_ids);
+      explicit VariableValue(runtime::Symbol var_name);
+      explicit VariableValue(std::vector<runtime::Symbol> dotted_ids);
+      // Первый идентификатор - переменная метода, хранящаяся в слоте slot кадра вызова.
+      // Без кадра вызова переменная ищется в closure по имени
+      VariableValue(std::vector<runtime::Symbol> dotted_ids, std::size_t slot);
 
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
      private:
-      std::vector<std::string> dotted_ids_;
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class jit::Compiler;
+      friend class opt::TreeAccess;
+
+      std::vector<runtime::Symbol> dotted_ids_;
+      std::size_t slot_ = runtime::Frame::NO_SLOT;
+      // Кэши полей dotted_ids_[1], dotted_ids_[2], ...
+      std::vector<runtime::FieldCache> field_caches_;
     };
 
     class Assignment
         : public Statement {
      public:
-      Assignment(std::string var, std::unique_ptr<Statement> rv);
+      Assignment(runtime::Symbol var, std::unique_ptr<Statement> rv);
+      // Переменная var хранится в слоте slot кадра вызова метода
+      Assignment(runtime::Symbol var, std::size_t slot, std::unique_ptr<Statement> rv);
 
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
      public:
-      std::string var_;
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
+      runtime::Symbol var_;
+      std::size_t slot_ = runtime::Frame::NO_SLOT;
       std::unique_ptr<Statement> rv_;
     };
 
     class FieldAssignment
         : public Statement {
      public:
-      FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv);
+      FieldAssignment(VariableValue object, runtime::Symbol field_name, std::unique_ptr<Statement> rv);
 
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
      private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
       VariableValue object_;
-      std::string field_name_;
+      runtime::Symbol field_name_;
       std::unique_ptr<Statement> rv_;
+      runtime::FieldCache field_cache_;
+    };
+
+    // Литерал списка [a, b, ...]: каждое выполнение создаёт новый список
+    class ListLiteral
+        : public Statement {
+     public:
+      explicit ListLiteral(std::vector<std::unique_ptr<Statement>> items);
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+     private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
+      std::vector<std::unique_ptr<Statement>> items_;
+    };
+
+    // Словарь {key: value, ...}. Ключи и значения вычисляются попарно в порядке записи
+    class DictLiteral
+        : public Statement {
+     public:
+      DictLiteral(std::vector<std::unique_ptr<Statement>> keys, std::vector<std::unique_ptr<Statement>> values);
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+     private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
+      std::vector<std::unique_ptr<Statement>> keys_;
+      std::vector<std::unique_ptr<Statement>> values_;
+    };
+
+    // Обращение к элементу списка или словаря object[index]
+    class Index
+        : public Statement {
+     public:
+      Index(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index);
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+     private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
+      std::unique_ptr<Statement> object_;
+      std::unique_ptr<Statement> index_;
+    };
+
+    // Присваивание элементу списка или словаря object[index] = rv
+    class IndexAssignment
+        : public Statement {
+     public:
+      IndexAssignment(std::unique_ptr<Statement> object, std::unique_ptr<Statement> index,
+                      std::unique_ptr<Statement> rv);
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+     private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
+      std::unique_ptr<Statement> object_;
+      std::unique_ptr<Statement> index_;
+      std::unique_ptr<Statement> rv_;
+    };
+
+    // Тело метода, подставленное оптимизатором на место вызова (см. optimizer.h). Выполняется
+    // в собственном кадре вызова: слот 0 занимает self, слоты 1..n - значения аргументов
+    struct InlinedMethod {
+      const runtime::Method *method = nullptr;
+      std::unique_ptr<Statement> body;
+
+      // Выполняет body, связав слоты кадра со значениями self и аргументов args.
+      // Возвращает значение тела метода: у подставленных методов оно совпадает с результатом вызова
+      runtime::ObjectHolder Execute(runtime::ObjectHolder self, const std::vector<std::unique_ptr<Statement>> &args,
+                                    runtime::Closure &closure, runtime::Context &context) const;
     };
 
     class NewInstance
@@ -84,22 +216,78 @@ namespace ast
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
      private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
       runtime::ClassInstance cls_;
       std::vector<std::unique_ptr<Statement>> args_;
+      // Подставленное тело __init__ либо пустое значение
+      InlinedMethod init_;
+      // Экземпляр не покидает выражение и размещается в STACK_REGION
+      bool in_stack_region_ = false;
     };
 
     class MethodCall
         : public Statement {
      public:
-      MethodCall(std::unique_ptr<Statement> object, std::string method,
+      MethodCall(std::unique_ptr<Statement> object, runtime::Symbol method,
                  std::vector<std::unique_ptr<Statement>> args);
 
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
-     private:
+     protected:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class jit::Compiler;
+      friend class opt::TreeAccess;
+
+      // Вызывает метод у вычисленного объекта object
+      runtime::ObjectHolder Call(const runtime::ObjectHolder &object, runtime::Closure &closure,
+                                 runtime::Context &context);
+
       std::unique_ptr<Statement> object_;
-      std::string method_name_;
+      runtime::Symbol method_name_;
+      runtime::Selector selector_;
       std::vector<std::unique_ptr<Statement>> args_;
+      runtime::InlineCache cache_;
+    };
+
+    // Вызов метода, тело которого подставлено оптимизатором. Подставленное тело выполняется, если у объекта
+    // тот же метод, для которого выполнена подстановка; иначе метод вызывается как в MethodCall.
+    // Бэкенды, не поддерживающие подстановку, исполняют узел как обычный MethodCall
+    class InlinedCall
+        : public MethodCall {
+     public:
+      InlinedCall(std::unique_ptr<Statement> object, runtime::Symbol method, std::vector<std::unique_ptr<Statement>> args,
+                  InlinedMethod inlined);
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+     private:
+      friend class vm::Compiler;
+      friend class opt::TreeAccess;
+
+      InlinedMethod inlined_;
+    };
+
+    // Вызов методом самого себя в хвостовой позиции: return self.method(...). Если у объекта тот же метод,
+    // аргументы записываются в кадр текущего вызова и MethodBody выполняет тело заново, не расходуя стек;
+    // иначе метод вызывается как в MethodCall
+    class TailCall
+        : public MethodCall {
+     public:
+      TailCall(std::unique_ptr<Statement> object, runtime::Symbol method, std::vector<std::unique_ptr<Statement>> args,
+               const runtime::Method *callee);
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+     private:
+      friend class vm::Compiler;
+      friend class jit::Compiler;
+
+      // Метод, тело которого содержит узел
+      const runtime::Method *callee_;
     };
 
     class Compound
@@ -116,6 +304,11 @@ namespace ast
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
      private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class jit::Compiler;
+      friend class opt::TreeAccess;
+
       template<typename T0, typename... Ts>
       void CompoundImpl(T0 &&v0, Ts &&... vs) {
         if constexpr (sizeof...(vs) != 0) {
@@ -138,6 +331,11 @@ namespace ast
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
      private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class jit::Compiler;
+      friend class opt::TreeAccess;
+
       std::unique_ptr<Statement> statement_;
     };
 
@@ -149,6 +347,11 @@ namespace ast
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
      private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class jit::Compiler;
+      friend class opt::TreeAccess;
+
       std::unique_ptr<Statement> body_;
     };
 
@@ -160,6 +363,10 @@ namespace ast
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
      private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
       runtime::ObjectHolder cls_;
     };
 
@@ -173,6 +380,10 @@ namespace ast
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
      private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
       std::vector<std::unique_ptr<Statement>> args_;
     };
 
@@ -184,6 +395,11 @@ namespace ast
       }
 
      protected:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class jit::Compiler;
+      friend class opt::TreeAccess;
+
       std::unique_ptr<Statement> argument_;
     };
 
@@ -196,6 +412,11 @@ namespace ast
       }
 
      protected:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class jit::Compiler;
+      friend class opt::TreeAccess;
+
       std::unique_ptr<Statement> lhs_;
       std::unique_ptr<Statement> rhs_;
     };
@@ -206,6 +427,17 @@ namespace ast
       using UnaryOperation::UnaryOperation;
 
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+      // Возвращает строковое представление вычисленного аргумента. Если задан region,
+      // строка размещается в нём, а не в куче
+      static runtime::ObjectHolder Apply(const runtime::ObjectHolder &object, runtime::StackRegion *region = nullptr);
+
+     private:
+      friend class vm::Compiler;
+      friend class opt::TreeAccess;
+
+      // Результат не покидает выражение и размещается в STACK_REGION (см. ast::StackScope)
+      bool in_stack_region_ = false;
     };
 
     class Add
@@ -214,6 +446,23 @@ namespace ast
       using BinaryOperation::BinaryOperation;
 
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+      // Складывает вычисленные операнды. cache - кэш метода __add__ точки сложения.
+      // Если задан region, результат сложения строк размещается в нём, а не в куче.
+      // lhs_temporary - левый операнд не виден программе (не значение переменной или поля), и строку,
+      // на которую нет других ссылок, можно дополнить на месте (см. runtime::String::ConcatTemporary)
+      static runtime::ObjectHolder Apply(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs,
+                                         runtime::Context &context, runtime::InlineCache &cache,
+                                         runtime::StackRegion *region = nullptr, bool lhs_temporary = false);
+
+     private:
+      friend class vm::Compiler;
+      friend class opt::TreeAccess;
+
+      // Кэш метода __add__ для экземпляров классов
+      runtime::InlineCache cache_;
+      // Результат сложения строк не покидает выражение и размещается в STACK_REGION
+      bool in_stack_region_ = false;
     };
 
     class Sub
@@ -222,6 +471,9 @@ namespace ast
       using BinaryOperation::BinaryOperation;
 
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+      // Вычитает вычисленные операнды
+      static runtime::ObjectHolder Apply(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs);
     };
 
     class Mult
@@ -230,6 +482,9 @@ namespace ast
       using BinaryOperation::BinaryOperation;
 
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+      // Перемножает вычисленные операнды
+      static runtime::ObjectHolder Apply(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs);
     };
 
     class Div
@@ -238,6 +493,9 @@ namespace ast
       using BinaryOperation::BinaryOperation;
 
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+      // Делит вычисленные операнды
+      static runtime::ObjectHolder Apply(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs);
     };
 
     class Or
@@ -264,18 +522,66 @@ namespace ast
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
     };
 
-    class Comparison
+    // Смена знака числа. Парсер представляет -x как x * -1, оптимизатор заменяет такое умножение на Negate
+    class Negate
+        : public UnaryOperation {
+     public:
+      using UnaryOperation::UnaryOperation;
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+      // Возвращает число с противоположным знаком
+      static runtime::ObjectHolder Apply(const runtime::ObjectHolder &object);
+    };
+
+    // Встроенная функция len: длина списка, словаря или строки
+    class Length
+        : public UnaryOperation {
+     public:
+      using UnaryOperation::UnaryOperation;
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+      static runtime::ObjectHolder Apply(const runtime::ObjectHolder &object);
+    };
+
+    // Проверка lhs in rhs (см. runtime::Contains). Запись lhs not in rhs разбирается как Not(Contains)
+    class Contains
         : public BinaryOperation {
      public:
-      using Comparator = std::function<bool(const runtime::ObjectHolder &,
-                                            const runtime::ObjectHolder &, runtime::Context &)>;
+      using BinaryOperation::BinaryOperation;
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    };
 
-      Comparison(Comparator cmp, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs);
+    enum class Comparator {
+      Equal,
+      NotEqual,
+      Less,
+      Greater,
+      LessOrEqual,
+      GreaterOrEqual,
+    };
+
+    // Операция сравнения cmp. Числа, строки и значения Bool сравниваются напрямую, за один проход;
+    // для остальных объектов результат совпадает с runtime::Equal, runtime::Less и производными от них
+    template<Comparator cmp>
+    class Comparison
+        : public BinaryOperation {
+     public:
+      using BinaryOperation::BinaryOperation;
 
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+      // Сравнивает вычисленные операнды, используя кэши методов __eq__ и __lt__ точки сравнения
+      static bool Apply(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs, runtime::Context &context,
+                        runtime::InlineCache &eq_cache, runtime::InlineCache &lt_cache);
+
      private:
-      Comparator cmp_;
+
+      // Кэши методов __eq__ и __lt__ для экземпляров классов
+      runtime::InlineCache eq_cache_;
+      runtime::InlineCache lt_cache_;
     };
 
     class IfElse
@@ -287,9 +593,104 @@ namespace ast
       runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
      private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class jit::Compiler;
+      friend class opt::TreeAccess;
+
       std::unique_ptr<Statement> condition_;
       std::unique_ptr<Statement> if_body_;
       std::unique_ptr<Statement> else_body_;
     };
 
+    class While
+        : public Statement {
+     public:
+      While(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> body);
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+     private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
+      std::unique_ptr<Statement> condition_;
+      std::unique_ptr<Statement> body_;
+    };
+
+    // Цикл for var in range(begin, end). Счётчик хранится в int и присваивается переменной как число,
+    // размещённое непосредственно в ObjectHolder, поэтому итерация не выделяет память.
+    // Присваивание переменной внутри тела не влияет на следующее значение счётчика
+    class ForRange
+        : public Statement {
+     public:
+      ForRange(runtime::Symbol var, std::size_t slot, std::unique_ptr<Statement> begin, std::unique_ptr<Statement> end,
+               std::unique_ptr<Statement> body);
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+     private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
+      runtime::Symbol var_;
+      std::size_t slot_;
+      std::unique_ptr<Statement> begin_;
+      std::unique_ptr<Statement> end_;
+      std::unique_ptr<Statement> body_;
+    };
+
+    // Цикл for var in iterable по элементам списка. Длина списка проверяется перед каждой итерацией,
+    // поэтому элементы, добавленные в теле цикла, тоже перебираются
+    class ForEach
+        : public Statement {
+     public:
+      ForEach(runtime::Symbol var, std::size_t slot, std::unique_ptr<Statement> iterable, std::unique_ptr<Statement> body);
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+     private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
+      runtime::Symbol var_;
+      std::size_t slot_;
+      std::unique_ptr<Statement> iterable_;
+      std::unique_ptr<Statement> body_;
+    };
+
+    // break и continue прерывают Compound через Closure::SetLoopControl, как return, без исключений
+    class Break
+        : public Statement {
+     public:
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    };
+
+    class Continue
+        : public Statement {
+     public:
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    };
+
+    // Область временных значений (см. проход escape в optimizer.h): узлы внутри body могут размещать
+    // в STACK_REGION значения, которые не покидают вычисляющее их выражение. После выполнения body
+    // эти значения уничтожаются. Результат body размещается в куче
+    class StackScope
+        : public Statement {
+     public:
+      explicit StackScope(std::unique_ptr<Statement> body);
+
+      runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+
+     private:
+      friend class vm::Compiler;
+      friend class cache::ProgramWriter;
+      friend class opt::TreeAccess;
+
+      std::unique_ptr<Statement> body_;
+    };
+
   } // namespace ast
@@ -79,6 +79,28 @@ void TestVariable() {
     ASSERT(context.output.str().empty());
 }
 
+void TestFrameVariable() {
+    runtime::DummyContext context;
+
+    runtime::Frame frame(3);
+    frame.Bind(1) = ObjectHolder::Own(runtime::Number(42));
+    Closure closure = {{"x"s, ObjectHolder::Own(runtime::String("from closure"s))}};
+    closure.SetFrame(&frame);
+
+    ASSERT_OBJECT_VALUE_EQUAL(VariableValue(vector<runtime::Symbol>{"x"s}, 1).Execute(closure, context), 42);
+    ASSERT_THROWS(VariableValue(vector<runtime::Symbol>{"y"s}, 2).Execute(closure, context), std::runtime_error);
+
+    Assignment assign_y("y"s, 2, make_unique<NumericConst>(runtime::Number(57)));
+    ASSERT_OBJECT_VALUE_EQUAL(assign_y.Execute(closure, context), 57);
+    ASSERT_OBJECT_VALUE_EQUAL(VariableValue(vector<runtime::Symbol>{"y"s}, 2).Execute(closure, context), 57);
+    ASSERT(closure.count("y"s) == 0);
+
+    // Без кадра вызова переменные ищутся по имени
+    closure.SetFrame(nullptr);
+    ASSERT_OBJECT_VALUE_EQUAL(VariableValue(vector<runtime::Symbol>{"x"s}, 1).Execute(closure, context),
+                              "from closure"s);
+}
+
 void TestAssignment() {
     runtime::DummyContext context;
 
@@ -128,7 +150,7 @@ void TestFieldAssignment() {
 
     assign_y.Execute(closure, context);
     FieldAssignment assign_yz(
-        VariableValue{vector<string>{"self"s, "y"s}}, "z"s,
+        VariableValue{vector<runtime::Symbol>{"self"s, "y"s}}, "z"s,
         make_unique<StringConst>(runtime::String("Hello, world! Hooray! Yes-yes!!!"s)));
     {
         ObjectHolder o = assign_yz.Execute(closure, context);
@@ -307,6 +329,112 @@ void TestCompound() {
     ASSERT(context.output.str().empty());
 }
 
+void TestReturn() {
+    runtime::DummyContext context;
+
+    // if x:
+    //   if x:
+    //     return "inner"
+    //   print "unreachable"
+    // print "after if"
+    // return "outer"
+    auto make_body = [] {
+        auto inner_if = make_unique<IfElse>(
+            make_unique<VariableValue>("x"s),
+            make_unique<Compound>(make_unique<Return>(make_unique<StringConst>("inner"s))), nullptr);
+        auto outer_if = make_unique<IfElse>(
+            make_unique<VariableValue>("x"s),
+            make_unique<Compound>(std::move(inner_if), make_unique<Print>(make_unique<StringConst>("unreachable"s))),
+            nullptr);
+        return MethodBody(make_unique<Compound>(std::move(outer_if),
+                                                make_unique<Print>(make_unique<StringConst>("after if"s)),
+                                                make_unique<Return>(make_unique<StringConst>("outer"s))));
+    };
+
+    {
+        auto body = make_body();
+        Closure closure = {{"x"s, ObjectHolder::True()}};
+        ASSERT_OBJECT_VALUE_EQUAL(body.Execute(closure, context), "inner"s);
+        ASSERT(!closure.IsReturning());
+        ASSERT(context.output.str().empty());
+    }
+    {
+        auto body = make_body();
+        Closure closure = {{"x"s, ObjectHolder::False()}};
+        ASSERT_OBJECT_VALUE_EQUAL(body.Execute(closure, context), "outer"s);
+        ASSERT(!closure.IsReturning());
+        ASSERT_EQUAL(context.output.str(), "after if\n"s);
+    }
+    {
+        // Метод без return возвращает None, даже если последняя инструкция вернула значение
+        MethodBody body(make_unique<Compound>(make_unique<Assignment>("y"s, make_unique<NumericConst>(1))));
+        Closure closure;
+        ASSERT(!body.Execute(closure, context));
+    }
+}
+
+template <Comparator cmp>
+bool Compare(ObjectHolder lhs, ObjectHolder rhs, runtime::Context& context) {
+    Closure closure = {{"lhs"s, std::move(lhs)}, {"rhs"s, std::move(rhs)}};
+    Comparison<cmp> comparison(make_unique<VariableValue>("lhs"s), make_unique<VariableValue>("rhs"s));
+    return runtime::IsTrue(comparison.Execute(closure, context));
+}
+
+template <Comparator cmp>
+void AssertComparisonMatches(bool (*runtime_cmp)(const ObjectHolder&, const ObjectHolder&, runtime::Context&)) {
+    runtime::DummyContext context;
+    const vector<pair<ObjectHolder, ObjectHolder>> operands = {
+        {ObjectHolder::Own(runtime::Number(1)), ObjectHolder::Own(runtime::Number(2))},
+        {ObjectHolder::Own(runtime::Number(2)), ObjectHolder::Own(runtime::Number(2))},
+        {ObjectHolder::Own(runtime::Number(100'000)), ObjectHolder::Own(runtime::Number(-100'000))},
+        {ObjectHolder::Own(runtime::String("abc"s)), ObjectHolder::Own(runtime::String("abd"s))},
+        {ObjectHolder::Own(runtime::String("b"s)), ObjectHolder::Own(runtime::String("b"s))},
+        {ObjectHolder::True(), ObjectHolder::False()},
+        {ObjectHolder::False(), ObjectHolder::False()},
+    };
+    for (const auto& [lhs, rhs] : operands) {
+        ASSERT_EQUAL(Compare<cmp>(lhs, rhs, context), runtime_cmp(lhs, rhs, context));
+        ASSERT_EQUAL(Compare<cmp>(rhs, lhs, context), runtime_cmp(rhs, lhs, context));
+    }
+    ASSERT_THROWS(Compare<cmp>(ObjectHolder::Own(runtime::Number(1)), ObjectHolder::Own(runtime::String("1"s)),
+                               context),
+                  runtime_error);
+}
+
+void TestComparison() {
+    AssertComparisonMatches<Comparator::Equal>(runtime::Equal);
+    AssertComparisonMatches<Comparator::NotEqual>(runtime::NotEqual);
+    AssertComparisonMatches<Comparator::Less>(runtime::Less);
+    AssertComparisonMatches<Comparator::Greater>(runtime::Greater);
+    AssertComparisonMatches<Comparator::LessOrEqual>(runtime::LessOrEqual);
+    AssertComparisonMatches<Comparator::GreaterOrEqual>(runtime::GreaterOrEqual);
+
+    runtime::DummyContext context;
+    ASSERT(Compare<Comparator::Equal>(ObjectHolder::None(), ObjectHolder::None(), context));
+    ASSERT_THROWS(Compare<Comparator::LessOrEqual>(ObjectHolder::None(), ObjectHolder::None(), context),
+                  runtime_error);
+
+    // Для объектов методы __lt__ и __eq__ вызываются в том же порядке, что и в runtime::LessOrEqual и др.
+    vector<runtime::Method> methods;
+    methods.push_back({"__lt__"s, {"other"s},
+                       make_unique<MethodBody>(make_unique<Compound>(
+                           make_unique<Print>(make_unique<StringConst>("lt"s)),
+                           make_unique<Return>(make_unique<BoolConst>(runtime::Bool(false)))))});
+    methods.push_back({"__eq__"s, {"other"s},
+                       make_unique<MethodBody>(make_unique<Compound>(
+                           make_unique<Print>(make_unique<StringConst>("eq"s)),
+                           make_unique<Return>(make_unique<BoolConst>(runtime::Bool(true)))))});
+    runtime::Class cls("Comparable"s, std::move(methods), nullptr);
+    const auto instance = ObjectHolder::Own(runtime::ClassInstance{cls});
+    const auto other = ObjectHolder::Own(runtime::Number(1));
+
+    ASSERT(Compare<Comparator::LessOrEqual>(instance, other, context));
+    ASSERT(!Compare<Comparator::Greater>(instance, other, context));
+    ASSERT(Compare<Comparator::GreaterOrEqual>(instance, other, context));
+    ASSERT(!Compare<Comparator::NotEqual>(instance, other, context));
+    ASSERT_EQUAL(context.output.str(), "lt\neq\nlt\neq\nlt\neq\n"s);
+}
+
 void TestFields() {
     runtime::DummyContext context;
 
@@ -317,13 +445,13 @@ void TestFields() {
                        {make_unique<FieldAssignment>(VariableValue{"self"s}, "value"s,
                                                      make_unique<NumericConst>(0))}});
     methods.push_back(
-        {"value"s, {}, {make_unique<VariableValue>(vector<string>{"self"s, "value"s})}});
+        {"value"s, {}, {make_unique<VariableValue>(vector<runtime::Symbol>{"self"s, "value"s})}});
     methods.push_back(
         {"add"s,
          {"x"s},
          {make_unique<FieldAssignment>(
              VariableValue{"self"s}, "value"s,
-             make_unique<Add>(make_unique<VariableValue>(vector<string>{"self"s, "value"s}),
+             make_unique<Add>(make_unique<VariableValue>(vector<runtime::Symbol>{"self"s, "value"s}),
                               make_unique<VariableValue>("x"s)))}});
 
     runtime::Class cls("BoxedValue"s, std::move(methods), nullptr);
@@ -345,7 +473,7 @@ void TestFields() {
 
 void TestBaseClass() {
     vector<runtime::Method> methods;
-    methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector{"self"s, "value"s})});
+    methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector<runtime::Symbol>{"self"s, "value"s})});
     methods.push_back({"SetValue"s,
                        {"x"s},
                        make_unique<FieldAssignment>(VariableValue{"self"s}, "value"s,
@@ -371,7 +499,7 @@ void TestBaseClass() {
 
 void TestInheritance() {
     vector<runtime::Method> methods;
-    methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector{"self"s, "value"s})});
+    methods.push_back({"GetValue"s, {}, make_unique<VariableValue>(vector<runtime::Symbol>{"self"s, "value"s})});
     methods.push_back({"SetValue"s,
                        {"x"s},
                        make_unique<FieldAssignment>(VariableValue{"self"s}, "value"s,
@@ -458,6 +586,7 @@ void RunUnitTests(TestRunner& tr) {
     RUN_TEST(tr, ast::TestNumericConst);
     RUN_TEST(tr, ast::TestStringConst);
     RUN_TEST(tr, ast::TestVariable);
+    RUN_TEST(tr, ast::TestFrameVariable);
     RUN_TEST(tr, ast::TestAssignment);
     RUN_TEST(tr, ast::TestFieldAssignment);
     RUN_TEST(tr, ast::TestPrintVariable);
@@ -469,6 +598,8 @@ void RunUnitTests(TestRunner& tr) {
     RUN_TEST(tr, ast::TestSuccessfulClassInstanceAdd);
     RUN_TEST(tr, ast::TestClassInstanceAddWithoutMethod);
     RUN_TEST(tr, ast::TestCompound);
+    RUN_TEST(tr, ast::TestReturn);
+    RUN_TEST(tr, ast::TestComparison);
     RUN_TEST(tr, ast::TestFields);
     RUN_TEST(tr, ast::TestBaseClass);
     RUN_TEST(tr, ast::TestInheritance);
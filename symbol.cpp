@@ -0,0 +1,67 @@
+#include "symbol.h"
+
+#include <deque>
+#include <ostream>
+#include <unordered_map>
+
+namespace runtime
+  {
+    namespace
+      {
+        // Таблица интернированных строк
+        class SymbolTable {
+         public:
+          const Symbol::Entry *Intern(std::string_view text) {
+            ++stats_.interned;
+            const std::size_t hash = std::hash<std::string_view>{}(text);
+            if (const auto it = index_.find(text); it != index_.end()) {
+              return it->second;
+            }
+            const Symbol::Entry &entry = entries_.emplace_back(Symbol::Entry{std::string(text), hash});
+            index_.emplace(entry.text, &entry);
+            ++stats_.symbols;
+            return &entry;
+          }
+
+          [[nodiscard]] const SymbolStats &GetStats() const {
+            return stats_;
+          }
+
+         private:
+          // deque не перемещает записи, поэтому символы и ключи-string_view остаются действительными
+          std::deque<Symbol::Entry> entries_;
+          std::unordered_map<std::string_view, const Symbol::Entry *> index_;
+          SymbolStats stats_;
+        };
+
+        SymbolTable &GetSymbolTable() {
+          static SymbolTable table;
+          return table;
+        }
+      }
+
+    Symbol::Symbol()
+        : Symbol(std::string_view{}) {
+    }
+
+    Symbol::Symbol(std::string_view text)
+        : entry_(GetSymbolTable().Intern(text)) {
+    }
+
+    Symbol::Symbol(const std::string &text)
+        : Symbol(std::string_view(text)) {
+    }
+
+    Symbol::Symbol(const char *text)
+        : Symbol(std::string_view(text)) {
+    }
+
+    std::ostream &operator<<(std::ostream &os, Symbol symbol) {
+      return os << symbol.GetText();
+    }
+
+    SymbolStats GetSymbolStats() {
+      return GetSymbolTable().GetStats();
+    }
+
+  }  // namespace runtime
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace runtime
+  {
+
+/*
+ * Интернированная строка (символ). Лексер интернирует идентификаторы и строковые константы программы,
+ * и дальше имена переменных, полей, методов и параметров передаются как символы. Символ - указатель
+ * на единственную запись таблицы символов с текстом и его хешем, поэтому символ копируется как указатель,
+ * символы сравниваются по адресу записи, а хеш не вычисляется повторно.
+ * Записи таблицы не удаляются до завершения программы
+ */
+    class Symbol {
+     public:
+      // Символ пустой строки
+      Symbol();
+      // Интернирует text. Преобразования неявные, чтобы имена можно было передавать строками
+      Symbol(std::string_view text);  // NOLINT(google-explicit-constructor)
+      Symbol(const std::string &text);  // NOLINT(google-explicit-constructor)
+      Symbol(const char *text);  // NOLINT(google-explicit-constructor)
+
+      [[nodiscard]] const std::string &GetText() const {
+        return entry_->text;
+      }
+
+      // Хеш текста символа, совпадающий с std::hash<std::string_view>
+      [[nodiscard]] std::size_t GetHash() const {
+        return entry_->hash;
+      }
+
+      operator const std::string &() const {  // NOLINT(google-explicit-constructor)
+        return entry_->text;
+      }
+
+      operator std::string_view() const {  // NOLINT(google-explicit-constructor)
+        return entry_->text;
+      }
+
+      bool operator==(Symbol other) const {
+        return entry_ == other.entry_;
+      }
+
+      bool operator!=(Symbol other) const {
+        return entry_ != other.entry_;
+      }
+
+      // Сравнение с обычной строкой сравнивает текст и не интернирует строку
+      template<typename T, typename = std::enable_if_t<std::is_convertible_v<const T &, std::string_view>>>
+      friend bool operator==(Symbol lhs, const T &rhs) {
+        return lhs.GetText() == std::string_view(rhs);
+      }
+
+      template<typename T, typename = std::enable_if_t<std::is_convertible_v<const T &, std::string_view>>>
+      friend bool operator==(const T &lhs, Symbol rhs) {
+        return rhs == lhs;
+      }
+
+      template<typename T, typename = std::enable_if_t<std::is_convertible_v<const T &, std::string_view>>>
+      friend bool operator!=(Symbol lhs, const T &rhs) {
+        return !(lhs == rhs);
+      }
+
+      template<typename T, typename = std::enable_if_t<std::is_convertible_v<const T &, std::string_view>>>
+      friend bool operator!=(const T &lhs, Symbol rhs) {
+        return !(rhs == lhs);
+      }
+
+      struct Entry {
+        std::string text;
+        std::size_t hash;
+      };
+
+     private:
+      const Entry *entry_;
+    };
+
+    std::ostream &operator<<(std::ostream &os, Symbol symbol);
+
+// Размер таблицы символов
+    struct SymbolStats {
+      // Число различных символов
+      std::size_t symbols = 0;
+      // Число обращений к таблице, включая повторные для уже интернированного текста
+      std::size_t interned = 0;
+    };
+
+    SymbolStats GetSymbolStats();
+
+  }  // namespace runtime
+
+namespace std
+  {
+    template<>
+    struct hash<runtime::Symbol> {
+      size_t operator()(runtime::Symbol symbol) const {
+        return symbol.GetHash();
+      }
+    };
+  }  // namespace std
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "lexer.h"
+#include "parse.h"
+#include "runtime.h"
+#include "statement.h"
+#include "vm.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+// Общие вспомогательные функции тестов, разбирающих и выполняющих программы Mython
+namespace test_program {
+
+inline std::unique_ptr<ast::Statement> Parse(const std::string& source) {
+    std::istringstream input(source);
+    parse::Lexer lexer(input);
+    return ParseProgram(lexer);
+}
+
+// Выполняет program в новом окружении и возвращает её вывод
+inline std::string Run(ast::Statement& program, vm::Backend backend) {
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    vm::Run(program, closure, context, backend);
+    return context.output.str();
+}
+
+}  // namespace test_program
@@ -0,0 +1,688 @@
+#include "vm.h"
+
+#include "compiler.h"
+#include "jit.h"
+
+#include <algorithm>
+
+// Переходы по адресам меток (computed goto) - расширение GCC и Clang
+#if defined(__GNUC__) && !defined(MYTHON_VM_NO_COMPUTED_GOTO)
+#define MYTHON_VM_COMPUTED_GOTO
+#endif
+
+// Редкие и тяжёлые операции выносятся из цикла интерпретатора, чтобы кадр VirtualMachine::Run
+// в стеке рекурсивных вызовов методов оставался небольшим
+#if defined(__GNUC__)
+#define MYTHON_VM_NOINLINE __attribute__((noinline))
+#else
+#define MYTHON_VM_NOINLINE
+#endif
+
+namespace vm
+  {
+    using namespace std::literals;
+
+    using runtime::ClassInstance;
+    using runtime::Closure;
+    using runtime::Context;
+    using runtime::ObjectHolder;
+    using runtime::ObjectKind;
+
+    namespace
+      {
+        const runtime::Selector ADD_METHOD = runtime::InternSelector("__add__"sv);
+
+        // Значение слота локальной переменной, которой ещё не присвоено значение
+        class Unbound
+            : public runtime::Object {
+         public:
+          void Print(std::ostream & /*os*/, Context & /*context*/) override {
+          }
+        };
+
+        Unbound UNBOUND;
+
+        std::size_t FRAME_MEMORY_LIMIT = DEFAULT_FRAME_MEMORY_LIMIT;
+
+        class VirtualMachine {
+         public:
+          VirtualMachine(Program &program, Context &context, bool stackless)
+              : program_(program)
+              , context_(context)
+              , stackless_(stackless) {
+          }
+
+          // Выполняет функцию, регистры которой начинаются с registers_[base]
+          ObjectHolder Run(Function &entry, std::size_t base, Closure &closure);
+
+         private:
+          // Кадр вызова метода в стеке виртуальной машины (режим Backend::Stackless).
+          // Хранит состояние вызывающей функции, в которую возвращается Return
+          struct CallFrame {
+            Function *caller = nullptr;
+            std::size_t caller_base = 0;
+            // Инструкция Call, после которой продолжается вызывающая функция
+            const Instruction *call = nullptr;
+            // Регистр вызывающей функции для результата
+            Register result = 0;
+            // Граница STACK_REGION при входе в метод
+            std::size_t region_mark = 0;
+            // Переменные метода, не имеющие слотов в кадре
+            Closure closure;
+          };
+
+          MYTHON_VM_NOINLINE void CallMethod(Function &function, std::size_t base, const Instruction &instruction);
+          // Размещает кадр вызываемого инструкцией Call метода в стеке кадров и возвращает его функцию.
+          // Если тело метода не скомпилировано, вызывает метод обычным образом и возвращает nullptr
+          MYTHON_VM_NOINLINE Function *PushFrame(Function &function, std::size_t base, const Instruction *call);
+          MYTHON_VM_NOINLINE void CreateInstance(Function &function, std::size_t base, const Instruction &instruction);
+          MYTHON_VM_NOINLINE void AddObjects(Function &function, std::size_t base, const Instruction &instruction,
+                                             runtime::StackRegion *region = nullptr);
+
+          // Вызывает метод объекта self с argument_count аргументами из registers_[args].
+          // Кадр вызова скомпилированного метода размещается, начиная с registers_[frame_base]
+          ObjectHolder Invoke(const runtime::Method &method, Function *function, ClassInstance &self,
+                              std::size_t args, std::size_t argument_count, std::size_t frame_base);
+          // Вызывает метод, тело которого не скомпилировано
+          MYTHON_VM_NOINLINE ObjectHolder InvokeTreeWalker(const runtime::Method &method, ClassInstance &self,
+                                                          std::size_t args, std::size_t argument_count);
+
+          void ReserveRegisters(std::size_t count) {
+            if (registers_.size() < count) {
+              registers_.resize(std::max(count, registers_.size() * 2));
+            }
+          }
+
+          Program &program_;
+          Context &context_;
+          std::vector<ObjectHolder> registers_;
+          // Методы, найденные инструкциями PrepareCall, аргументы которых ещё вычисляются
+          std::vector<const runtime::Method *> pending_calls_;
+          bool stackless_;
+          std::vector<CallFrame> frames_;
+        };
+
+        [[noreturn]] MYTHON_VM_NOINLINE void ThrowError(const char *message) {
+          throw std::runtime_error(message);
+        }
+
+        template<ast::Comparator cmp>
+        MYTHON_VM_NOINLINE void Compare(ObjectHolder *regs, const Instruction &instruction, Context &context,
+                                        runtime::InlineCache *caches) {
+          const bool result = ast::Comparison<cmp>::Apply(regs[instruction.b], regs[instruction.c], context,
+                                                          caches[0], caches[1]);
+          regs[instruction.a] = result ? ObjectHolder::True() : ObjectHolder::False();
+        }
+
+        template<typename Operation>
+        MYTHON_VM_NOINLINE void Unary(ObjectHolder *regs, const Instruction &instruction) {
+          regs[instruction.a] = Operation::Apply(regs[instruction.b]);
+        }
+
+        MYTHON_VM_NOINLINE void Stringify(ObjectHolder *regs, const Instruction &instruction) {
+          regs[instruction.a] =
+              ast::Stringify::Apply(regs[instruction.b], instruction.c != 0 ? &runtime::STACK_REGION : nullptr);
+        }
+
+        MYTHON_VM_NOINLINE void NewList(ObjectHolder *regs, const Instruction &instruction) {
+          std::vector<ObjectHolder> items(regs + instruction.b, regs + instruction.b + instruction.c);
+          regs[instruction.a] = ObjectHolder::Own(runtime::List(std::move(items)));
+        }
+
+        MYTHON_VM_NOINLINE void NewDict(ObjectHolder *regs, const Instruction &instruction, Context &context) {
+          auto dict = ObjectHolder::Own(runtime::Dict());
+          for (std::uint32_t i = 0; i < instruction.c; ++i) {
+            dict.As<runtime::Dict>().Set(regs[instruction.b + 2 * i], regs[instruction.b + 2 * i + 1], context);
+          }
+          regs[instruction.a] = std::move(dict);
+        }
+
+        template<typename Operation>
+        MYTHON_VM_NOINLINE void Arithmetic(ObjectHolder *regs, const Instruction &instruction) {
+          regs[instruction.a] = Operation::Apply(regs[instruction.b], regs[instruction.c]);
+        }
+
+        MYTHON_VM_NOINLINE void Write(const ObjectHolder &object, Context &context) {
+          auto &output = context.GetOutputStream();
+          if (object) {
+            object->Print(output, context);
+          } else {
+            output << "None"sv;
+          }
+        }
+
+        bool BothNumbers(const ObjectHolder &lhs, const ObjectHolder &rhs) {
+          return lhs.GetKind() == ObjectKind::Number && rhs.GetKind() == ObjectKind::Number;
+        }
+
+        int NumberValue(const ObjectHolder &object) {
+          return object.As<runtime::Number>().GetValue();
+        }
+      }  // namespace
+
+    ObjectHolder VirtualMachine::Run(Function &entry, std::size_t base, Closure &closure) {
+      ReserveRegisters(base + entry.register_count);
+      // Исполняемая функция: в режиме Stackless Call и Return переключают её без рекурсии Run
+      Function *function = &entry;
+      Closure *variables = &closure;
+      ObjectHolder *regs = registers_.data() + base;
+      const Instruction *code = function->code.data();
+      const Instruction *ip = code;
+      // Освобождает значения регистров функции при выходе из неё
+      const auto leave = [&] {
+        std::fill_n(registers_.begin() + static_cast<std::ptrdiff_t>(base), function->register_count, ObjectHolder());
+      };
+      // Кадры, размещённые этим вызовом Run. При исключении они снимаются со стека
+      const std::size_t entry_depth = frames_.size();
+      struct FrameGuard {
+        std::vector<CallFrame> &frames;
+        std::size_t depth;
+
+        ~FrameGuard() {
+          frames.erase(frames.begin() + static_cast<std::ptrdiff_t>(depth), frames.end());
+        }
+      } frame_guard{frames_, entry_depth};
+      // Снимает кадр метода со стека кадров и продолжает вызывающую функцию после инструкции Call
+      const auto return_to_caller = [&](ObjectHolder result) {
+        auto &frame = frames_.back();
+        runtime::STACK_REGION.Release(frame.region_mark);
+        function = frame.caller;
+        base = frame.caller_base;
+        ip = frame.call;
+        const Register result_register = frame.result;
+        frames_.pop_back();
+        variables = frames_.size() == entry_depth ? &closure : &frames_.back().closure;
+        regs = registers_.data() + base;
+        code = function->code.data();
+        regs[result_register] = std::move(result);
+      };
+
+#ifdef MYTHON_VM_COMPUTED_GOTO
+#define MYTHON_VM_LABEL_ADDRESS(name) &&op_##name,
+      static const void *const DISPATCH_TABLE[] = {MYTHON_VM_OPCODES(MYTHON_VM_LABEL_ADDRESS)};
+#undef MYTHON_VM_LABEL_ADDRESS
+#define VM_DISPATCH() goto *DISPATCH_TABLE[static_cast<std::size_t>(ip->op)]
+#define VM_CASE(name) op_##name:
+#else
+#define VM_DISPATCH() goto dispatch
+#define VM_CASE(name) case OpCode::name:
+#endif
+#define VM_NEXT() { ++ip; VM_DISPATCH(); }
+#define VM_JUMP(target) { ip = code + (target); VM_DISPATCH(); }
+
+#ifdef MYTHON_VM_COMPUTED_GOTO
+      VM_DISPATCH();
+#else
+      dispatch:
+      switch (ip->op) {
+#endif
+      VM_CASE(LoadNone) {
+        regs[ip->a] = ObjectHolder::None();
+        VM_NEXT();
+      }
+      VM_CASE(LoadTrue) {
+        regs[ip->a] = ObjectHolder::True();
+        VM_NEXT();
+      }
+      VM_CASE(LoadFalse) {
+        regs[ip->a] = ObjectHolder::False();
+        VM_NEXT();
+      }
+      VM_CASE(LoadConst) {
+        regs[ip->a] = function->constants[ip->b];
+        VM_NEXT();
+      }
+      VM_CASE(Move) {
+        regs[ip->a] = regs[ip->b];
+        VM_NEXT();
+      }
+      VM_CASE(LoadLocal) {
+        if (regs[ip->b].Get() == &UNBOUND) {
+          ThrowError("Cant find var");
+        }
+        regs[ip->a] = regs[ip->b];
+        VM_NEXT();
+      }
+      VM_CASE(LoadName) {
+        const auto it = variables->find(function->names[ip->b]);
+        if (it == variables->end()) {
+          ThrowError("Cant find var");
+        }
+        regs[ip->a] = it->second;
+        VM_NEXT();
+      }
+      VM_CASE(StoreName) {
+        (*variables)[function->names[ip->a]] = regs[ip->b];
+        VM_NEXT();
+      }
+      VM_CASE(GetField) {
+        auto *instance = regs[ip->b].TryAs<ClassInstance>();
+        if (instance == nullptr) {
+          ThrowError("This isn't object");
+        }
+        const ObjectHolder *field = function->field_caches[ip->d].Find(*instance, function->names[ip->c]);
+        if (field == nullptr) {
+          ThrowError("Cant find var");
+        }
+        regs[ip->a] = *field;
+        VM_NEXT();
+      }
+      VM_CASE(CheckInstance) {
+        if (regs[ip->a].TryAs<ClassInstance>() == nullptr) {
+          ThrowError("Cant find field");
+        }
+        VM_NEXT();
+      }
+      VM_CASE(SetField) {
+        function->field_caches[ip->d].Add(regs[ip->a].As<ClassInstance>(), function->names[ip->b]) = regs[ip->c];
+        VM_NEXT();
+      }
+      VM_CASE(DefineClass) {
+        (*variables)[function->names[ip->b]] = function->constants[ip->a];
+        VM_NEXT();
+      }
+      VM_CASE(Write) {
+        Write(regs[ip->a], context_);
+        VM_NEXT();
+      }
+      VM_CASE(WriteSpace) {
+        context_.GetOutputStream() << ' ';
+        VM_NEXT();
+      }
+      VM_CASE(WriteNewline) {
+        context_.GetOutputStream() << '\n';
+        VM_NEXT();
+      }
+      VM_CASE(Stringify) {
+        Stringify(regs, *ip);
+        VM_NEXT();
+      }
+      VM_CASE(Add) {
+        if (BothNumbers(regs[ip->b], regs[ip->c])) {
+          regs[ip->a] = ObjectHolder::Own(runtime::Number{NumberValue(regs[ip->b]) + NumberValue(regs[ip->c])});
+        } else {
+          AddObjects(*function, base, *ip);
+          regs = registers_.data() + base;
+        }
+        VM_NEXT();
+      }
+      VM_CASE(Concat) {
+        AddObjects(*function, base, *ip, &runtime::STACK_REGION);
+        regs = registers_.data() + base;
+        VM_NEXT();
+      }
+      VM_CASE(Sub) {
+        if (BothNumbers(regs[ip->b], regs[ip->c])) {
+          regs[ip->a] = ObjectHolder::Own(runtime::Number{NumberValue(regs[ip->b]) - NumberValue(regs[ip->c])});
+        } else {
+          Arithmetic<ast::Sub>(regs, *ip);
+        }
+        VM_NEXT();
+      }
+      VM_CASE(Mult) {
+        if (BothNumbers(regs[ip->b], regs[ip->c])) {
+          regs[ip->a] = ObjectHolder::Own(runtime::Number{NumberValue(regs[ip->b]) * NumberValue(regs[ip->c])});
+        } else {
+          Arithmetic<ast::Mult>(regs, *ip);
+        }
+        VM_NEXT();
+      }
+      VM_CASE(Div) {
+        Arithmetic<ast::Div>(regs, *ip);
+        VM_NEXT();
+      }
+      VM_CASE(Negate) {
+        if (regs[ip->b].GetKind() == ObjectKind::Number) {
+          regs[ip->a] = ObjectHolder::Own(runtime::Number{-NumberValue(regs[ip->b])});
+        } else {
+          Unary<ast::Negate>(regs, *ip);
+        }
+        VM_NEXT();
+      }
+      VM_CASE(Not) {
+        regs[ip->a] = runtime::IsTrue(regs[ip->b]) ? ObjectHolder::False() : ObjectHolder::True();
+        VM_NEXT();
+      }
+      VM_CASE(Equal) {
+        Compare<ast::Comparator::Equal>(regs, *ip, context_, &function->caches[ip->d]);
+        VM_NEXT();
+      }
+      VM_CASE(NotEqual) {
+        Compare<ast::Comparator::NotEqual>(regs, *ip, context_, &function->caches[ip->d]);
+        VM_NEXT();
+      }
+      VM_CASE(Less) {
+        Compare<ast::Comparator::Less>(regs, *ip, context_, &function->caches[ip->d]);
+        VM_NEXT();
+      }
+      VM_CASE(Greater) {
+        Compare<ast::Comparator::Greater>(regs, *ip, context_, &function->caches[ip->d]);
+        VM_NEXT();
+      }
+      VM_CASE(LessOrEqual) {
+        Compare<ast::Comparator::LessOrEqual>(regs, *ip, context_, &function->caches[ip->d]);
+        VM_NEXT();
+      }
+      VM_CASE(GreaterOrEqual) {
+        Compare<ast::Comparator::GreaterOrEqual>(regs, *ip, context_, &function->caches[ip->d]);
+        VM_NEXT();
+      }
+      VM_CASE(Jump) {
+        VM_JUMP(ip->a);
+      }
+      VM_CASE(JumpIfTrue) {
+        if (runtime::IsTrue(regs[ip->a])) {
+          VM_JUMP(ip->b);
+        }
+        VM_NEXT();
+      }
+      VM_CASE(JumpIfFalse) {
+        if (!runtime::IsTrue(regs[ip->a])) {
+          VM_JUMP(ip->b);
+        }
+        VM_NEXT();
+      }
+      VM_CASE(RangeCheck) {
+        if (!BothNumbers(regs[ip->a], regs[ip->b])) {
+          ThrowError("range() arguments must be numbers");
+        }
+        VM_NEXT();
+      }
+      VM_CASE(ForRange) {
+        if (NumberValue(regs[ip->a]) >= NumberValue(regs[ip->c])) {
+          VM_JUMP(ip->b);
+        }
+        VM_NEXT();
+      }
+      VM_CASE(Increment) {
+        regs[ip->a] = ObjectHolder::Own(runtime::Number{NumberValue(regs[ip->a]) + 1});
+        VM_NEXT();
+      }
+      VM_CASE(ForEach) {
+        const auto *list = regs[ip->a].TryAs<runtime::List>();
+        if (list == nullptr) {
+          ThrowError("object is not iterable");
+        }
+        const int position = NumberValue(regs[ip->a + 1]);
+        if (static_cast<std::size_t>(position) >= list->Size()) {
+          VM_JUMP(ip->b);
+        }
+        regs[ip->c] = list->GetItems()[static_cast<std::size_t>(position)];
+        regs[ip->a + 1] = ObjectHolder::Own(runtime::Number{position + 1});
+        VM_NEXT();
+      }
+      VM_CASE(NewList) {
+        NewList(regs, *ip);
+        VM_NEXT();
+      }
+      VM_CASE(GetItem) {
+        regs[ip->a] = runtime::GetItem(regs[ip->b], regs[ip->c], context_);
+        VM_NEXT();
+      }
+      VM_CASE(SetItem) {
+        runtime::SetItem(regs[ip->a], regs[ip->b], regs[ip->c], context_);
+        VM_NEXT();
+      }
+      VM_CASE(Length) {
+        regs[ip->a] = ast::Length::Apply(regs[ip->b]);
+        VM_NEXT();
+      }
+      VM_CASE(NewDict) {
+        NewDict(regs, *ip, context_);
+        VM_NEXT();
+      }
+      VM_CASE(Contains) {
+        regs[ip->a] = runtime::Contains(regs[ip->c], regs[ip->b], context_) ? ObjectHolder::True() : ObjectHolder::False();
+        VM_NEXT();
+      }
+      VM_CASE(GuardMethod) {
+        const auto &guard = function->inline_guards[ip->c];
+        const auto *instance = regs[ip->a].TryAs<ClassInstance>();
+        if (instance == nullptr || instance->GetClass().GetMethod(guard.selector) != guard.method) {
+          VM_JUMP(ip->b);
+        }
+        VM_NEXT();
+      }
+      VM_CASE(TailCall) {
+        for (std::uint32_t i = 1; i <= function->argument_count; ++i) {
+          regs[i] = std::move(regs[ip->a + i]);
+        }
+        for (std::uint32_t i = function->argument_count + 1; i < function->local_count; ++i) {
+          regs[i] = ObjectHolder::Share(UNBOUND);
+        }
+        VM_JUMP(0);
+      }
+      VM_CASE(PrepareCall) {
+        auto &site = function->call_sites[ip->c];
+        const auto *instance = regs[ip->b].TryAs<ClassInstance>();
+        const runtime::Method *method =
+            instance != nullptr ? site.cache.Find(*instance, site.selector, site.argument_count) : nullptr;
+        // Для списка вызывается встроенный метод: в очередь вызовов помещается nullptr
+        if (method == nullptr && regs[ip->b].GetKind() != ObjectKind::List) {
+          regs[ip->a] = ObjectHolder::None();
+          VM_JUMP(ip->d);
+        }
+        pending_calls_.push_back(method);
+        VM_NEXT();
+      }
+      VM_CASE(Call) {
+        if (stackless_) {
+          if (Function *callee = PushFrame(*function, base, ip)) {
+            base += function->register_count;
+            function = callee;
+            variables = &frames_.back().closure;
+            regs = registers_.data() + base;
+            code = function->code.data();
+            ip = code;
+            VM_DISPATCH();
+          }
+        } else {
+          CallMethod(*function, base, *ip);
+        }
+        regs = registers_.data() + base;
+        VM_NEXT();
+      }
+      VM_CASE(New) {
+        CreateInstance(*function, base, *ip);
+        regs = registers_.data() + base;
+        VM_NEXT();
+      }
+      VM_CASE(RegionMark) {
+        regs[ip->a] = ObjectHolder::Own(runtime::Number{static_cast<int>(runtime::STACK_REGION.Mark())});
+        VM_NEXT();
+      }
+      VM_CASE(RegionRelease) {
+        runtime::STACK_REGION.Release(static_cast<std::size_t>(NumberValue(regs[ip->a])));
+        VM_NEXT();
+      }
+      VM_CASE(Return) {
+        ObjectHolder result = std::move(regs[ip->a]);
+        leave();
+        if (frames_.size() == entry_depth) {
+          return result;
+        }
+        return_to_caller(std::move(result));
+        VM_NEXT();
+      }
+      VM_CASE(ReturnNone) {
+        leave();
+        if (frames_.size() == entry_depth) {
+          return ObjectHolder::None();
+        }
+        return_to_caller(ObjectHolder::None());
+        VM_NEXT();
+      }
+#ifndef MYTHON_VM_COMPUTED_GOTO
+      }
+      return ObjectHolder::None();
+#endif
+
+#undef VM_JUMP
+#undef VM_NEXT
+#undef VM_CASE
+#undef VM_DISPATCH
+    }
+
+    void VirtualMachine::CallMethod(Function &function, std::size_t base, const Instruction &instruction) {
+      auto &site = function.call_sites[instruction.c];
+      const runtime::Method *method = pending_calls_.back();
+      pending_calls_.pop_back();
+      if (method == nullptr) {
+        auto &list = registers_[base + instruction.b].As<runtime::List>();
+        registers_[base + instruction.a] =
+            list.Call(site.selector, registers_.data() + base + instruction.b + 1, site.argument_count);
+        return;
+      }
+      if (method != site.last_method) {
+        site.last_method = method;
+        site.last_function = program_.FindMethod(method);
+      }
+      auto &self = registers_[base + instruction.b].As<ClassInstance>();
+      auto result = Invoke(*method, site.last_function, self, base + instruction.b + 1, site.argument_count,
+                           base + function.register_count);
+      registers_[base + instruction.a] = std::move(result);
+    }
+
+    Function *VirtualMachine::PushFrame(Function &function, std::size_t base, const Instruction *call) {
+      auto &site = function.call_sites[call->c];
+      const runtime::Method *method = pending_calls_.back();
+      if (method == nullptr) {
+        CallMethod(function, base, *call);
+        return nullptr;
+      }
+      if (method != site.last_method) {
+        site.last_method = method;
+        site.last_function = program_.FindMethod(method);
+      }
+      Function *callee = site.last_function;
+      // Машинный код JIT расходует стек потока, поэтому в этом режиме не используется
+      if (callee == nullptr) {
+        CallMethod(function, base, *call);
+        return nullptr;
+      }
+      pending_calls_.pop_back();
+
+      const std::size_t frame_base = base + function.register_count;
+      const std::size_t register_count = frame_base + callee->register_count;
+      const std::size_t frame_bytes =
+          register_count * sizeof(ObjectHolder) + (frames_.size() + 1) * sizeof(CallFrame);
+      if (frame_bytes > FRAME_MEMORY_LIMIT) {
+        ThrowError("call stack memory limit exceeded");
+      }
+      ReserveRegisters(register_count);
+      const std::size_t args = base + call->b;
+      registers_[frame_base] = registers_[args];
+      for (std::size_t i = 1; i <= site.argument_count; ++i) {
+        registers_[frame_base + i] = registers_[args + i];
+      }
+      for (std::size_t i = site.argument_count + 1; i < callee->local_count; ++i) {
+        registers_[frame_base + i] = ObjectHolder::Share(UNBOUND);
+      }
+      frames_.push_back({&function, base, call, call->a, runtime::STACK_REGION.Mark(), {}});
+
+      ++CALL_STACK_STATS.calls;
+      CALL_STACK_STATS.max_depth = std::max(CALL_STACK_STATS.max_depth, frames_.size());
+      CALL_STACK_STATS.peak_frame_bytes = std::max(CALL_STACK_STATS.peak_frame_bytes, frame_bytes);
+      return callee;
+    }
+
+    void VirtualMachine::CreateInstance(Function &function, std::size_t base, const Instruction &instruction) {
+      auto &site = function.new_sites[instruction.c];
+      if (site.init != nullptr) {
+        if (!site.init_resolved) {
+          site.init_function = program_.FindMethod(site.init);
+          site.init_resolved = true;
+        }
+        Invoke(*site.init, site.init_function, *site.instance, base + instruction.b, site.argument_count,
+               base + function.register_count);
+      }
+      registers_[base + instruction.a] = instruction.d != 0 ? runtime::STACK_REGION.Make(ClassInstance{*site.instance})
+                                                           : ObjectHolder::Own(ClassInstance{*site.instance});
+    }
+
+    void VirtualMachine::AddObjects(Function &function, std::size_t base, const Instruction &instruction,
+                                    runtime::StackRegion *region) {
+      const auto &lhs = registers_[base + instruction.b];
+      auto &cache = function.caches[instruction.d];
+      if (lhs.GetKind() != ObjectKind::ClassInstance) {
+        if (instruction.temporary_b) {
+          // Регистр отдаёт свою ссылку, иначе временная строка никогда не будет единственной ссылкой на объект
+          const ObjectHolder temporary = std::move(registers_[base + instruction.b]);
+          registers_[base + instruction.a] =
+              ast::Add::Apply(temporary, registers_[base + instruction.c], context_, cache, region, true);
+        } else {
+          registers_[base + instruction.a] =
+              ast::Add::Apply(lhs, registers_[base + instruction.c], context_, cache, region);
+        }
+        return;
+      }
+      auto &instance = lhs.As<ClassInstance>();
+      const runtime::Method *method = cache.Find(instance, ADD_METHOD, 1);
+      if (method == nullptr) {
+        ThrowError("incorrect add operands");
+      }
+      auto result = Invoke(*method, program_.FindMethod(method), instance, base + instruction.c, 1,
+                           base + function.register_count);
+      registers_[base + instruction.a] = std::move(result);
+    }
+
+    ObjectHolder VirtualMachine::Invoke(const runtime::Method &method, Function *function, ClassInstance &self,
+                                        std::size_t args, std::size_t argument_count, std::size_t frame_base) {
+      if (function == nullptr) {
+        return InvokeTreeWalker(method, self, args, argument_count);
+      }
+      if (ObjectHolder result; jit::TryCall(method, self, registers_.data() + args, argument_count, result)) {
+        return result;
+      }
+      ReserveRegisters(frame_base + function->register_count);
+      registers_[frame_base] = ObjectHolder::Share(self);
+      for (std::size_t i = 0; i < argument_count; ++i) {
+        registers_[frame_base + 1 + i] = registers_[args + i];
+      }
+      for (std::size_t i = argument_count + 1; i < function->local_count; ++i) {
+        registers_[frame_base + i] = ObjectHolder::Share(UNBOUND);
+      }
+      Closure closure;
+      // Return может завершить метод внутри области временных значений, не выполнив RegionRelease
+      runtime::StackRegion::Scope region_scope(runtime::STACK_REGION);
+      return Run(*function, frame_base, closure);
+    }
+
+    ObjectHolder VirtualMachine::InvokeTreeWalker(const runtime::Method &method, ClassInstance &self,
+                                                  std::size_t args, std::size_t argument_count) {
+      const auto first = registers_.begin() + static_cast<std::ptrdiff_t>(args);
+      const std::vector<ObjectHolder> actual_args(first, first + static_cast<std::ptrdiff_t>(argument_count));
+      return self.Call(method, actual_args, context_);
+    }
+
+    CallStackStats CALL_STACK_STATS;
+
+    void SetFrameMemoryLimit(std::size_t limit) {
+      FRAME_MEMORY_LIMIT = limit;
+    }
+
+    std::size_t GetFrameMemoryLimit() {
+      return FRAME_MEMORY_LIMIT;
+    }
+
+    ObjectHolder Execute(Program &program, Closure &closure, Context &context, Backend backend) {
+      VirtualMachine machine(program, context, backend == Backend::Stackless);
+      runtime::StackRegion::Scope region_scope(runtime::STACK_REGION);
+      return machine.Run(program.main, 0, closure);
+    }
+
+    ObjectHolder Run(ast::Statement &program, Closure &closure, Context &context, Backend backend) {
+      if (backend != Backend::TreeWalker) {
+        std::unique_ptr<Program> compiled;
+        try {
+          compiled = Compiler::Compile(program);
+        } catch (const CompileError &) {
+        }
+        if (compiled) {
+          return Execute(*compiled, closure, context, backend);
+        }
+      }
+      return program.Execute(closure, context);
+    }
+
+  }  // namespace vm
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "bytecode.h"
+#include "statement.h"
+
+#include <cstddef>
+
+namespace vm
+  {
+
+// Способ исполнения программы
+    enum class Backend {
+      TreeWalker,  // обход дерева разбора (Statement::Execute)
+      Bytecode,  // компиляция в байт-код и исполнение регистровой виртуальной машиной
+      Stackless,  // байт-код; кадры вызовов скомпилированных методов размещаются в явном стеке
+                  // виртуальной машины, а не в стеке потока (см. SetFrameMemoryLimit)
+    };
+
+// Статистика стека кадров режима Backend::Stackless
+    struct CallStackStats {
+      // Вызовы методов, кадры которых размещены в стеке виртуальной машины
+      std::size_t calls = 0;
+      // Наибольшая глубина стека кадров
+      std::size_t max_depth = 0;
+      // Наибольший объём памяти регистров и кадров стека, байт
+      std::size_t peak_frame_bytes = 0;
+    };
+
+    extern CallStackStats CALL_STACK_STATS;
+
+// Объём памяти стека кадров по умолчанию
+    constexpr std::size_t DEFAULT_FRAME_MEMORY_LIMIT = std::size_t{256} << 20;
+
+// Ограничивает объём памяти регистров и кадров стека режима Backend::Stackless. Вызов, для кадра
+// которого не хватает памяти, выбрасывает runtime_error, поэтому глубина рекурсии ограничена limit,
+// а не размером стека потока
+    void SetFrameMemoryLimit(std::size_t limit);
+    std::size_t GetFrameMemoryLimit();
+
+// Выполняет скомпилированную программу. Глобальные переменные программы хранятся в closure
+    runtime::ObjectHolder Execute(Program &program, runtime::Closure &closure, runtime::Context &context,
+                                  Backend backend = Backend::Bytecode);
+
+// Выполняет программу способом backend. Если программу нельзя скомпилировать в байт-код,
+// она выполняется обходом дерева
+    runtime::ObjectHolder Run(ast::Statement &program, runtime::Closure &closure, runtime::Context &context,
+                              Backend backend);
+
+  }  // namespace vm
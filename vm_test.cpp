@@ -0,0 +1,599 @@
+#include "compiler.h"
+#include "lexer.h"
+#include "parse.h"
+#include "test_runner_p.h"
+#include "vm.h"
+
+using namespace std;
+
+namespace vm {
+
+namespace {
+
+struct Output {
+    string text;
+    bool failed = false;
+};
+
+Output RunWith(const string& program, Backend backend) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto tree = ParseProgram(lexer);
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    Output result;
+    try {
+        Run(*tree, closure, context, backend);
+    } catch (const runtime_error&) {
+        result.failed = true;
+    }
+    result.text = context.output.str();
+    return result;
+}
+
+// Программа должна одинаково выполняться обходом дерева и виртуальной машиной в обоих режимах
+void AssertSameOutput(const string& program, const string& expected) {
+    const auto tree = RunWith(program, Backend::TreeWalker);
+    ASSERT(!tree.failed);
+    ASSERT_EQUAL(tree.text, expected);
+    for (const auto backend : {Backend::Bytecode, Backend::Stackless}) {
+        const auto bytecode = RunWith(program, backend);
+        ASSERT(!bytecode.failed);
+        ASSERT_EQUAL(bytecode.text, expected);
+    }
+}
+
+void AssertSameFailure(const string& program) {
+    const auto tree = RunWith(program, Backend::TreeWalker);
+    ASSERT(tree.failed);
+    for (const auto backend : {Backend::Bytecode, Backend::Stackless}) {
+        const auto bytecode = RunWith(program, backend);
+        ASSERT(bytecode.failed);
+        ASSERT_EQUAL(tree.text, bytecode.text);
+    }
+}
+
+void TestExpressions() {
+    AssertSameOutput("print 1+2*3-4/2, 'a' + 'b', -5, None, True, not 0\n"s, "5 ab -5 None True True\n"s);
+    AssertSameOutput("x = 2\ny = x * x\nprint x < y, x > y, x == 2, x != 2, x <= 2, y >= 5, 'a' < 'b'\n"s,
+                     "True False True False True False True\n"s);
+    AssertSameOutput("print 0 or 1, 1 and 0, 0 or 0, 2 and 'x', str(12) + str(None) + str(True)\n"s,
+                     "True False False True 12NoneTrue\n"s);
+    AssertSameOutput("x = 0\nif x:\n  print 'then'\nelse:\n  print 'else'\nif not x:\n  print 'not'\n"s,
+                     "else\nnot\n"s);
+}
+
+void TestMethods() {
+    const string program = R"(
+class Counter:
+  def __init__(start):
+    self.value = start
+
+  def add(delta):
+    self.value = self.value + delta
+    return self
+
+  def __str__():
+    return 'Counter(' + str(self.value) + ')'
+
+  def __eq__(other):
+    return self.value == other.value
+
+  def __lt__(other):
+    return self.value < other.value
+
+  def __add__(other):
+    return self.value + other.value
+
+class Fib:
+  def calc(n):
+    if n < 2:
+      if n < 1:
+        return 0
+      return 1
+    return self.calc(n - 1) + self.calc(n - 2)
+
+  def locals(a, b):
+    tmp = a
+    a = b
+    b = tmp
+    if a > b:
+      big = a
+    else:
+      big = b
+    return str(a) + str(b) + str(big)
+
+c = Counter(1)
+d = Counter(5)
+c.add(2)
+c.add(3)
+print c, d, c == d, c < d, c <= d, c > d, c + d
+f = Fib()
+print f.calc(15), f.locals(1, 2), f.missing(), c.add()
+)"s;
+    AssertSameOutput(program, "Counter(6) Counter(5) False False False True 11\n610 212 None None\n"s);
+}
+
+void TestInheritance() {
+    const string program = R"(
+class Shape:
+  def name():
+    return 'shape'
+
+  def describe():
+    return self.name() + ' with area ' + str(self.area())
+
+  def area():
+    return 0
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def name():
+    return 'rect'
+
+  def area():
+    return self.w * self.h
+
+class Square(Rect):
+  def __init__(a):
+    self.w = a
+    self.h = a
+
+  def name():
+    return 'square'
+
+shapes = Shape()
+print shapes.describe()
+r = Rect(2, 3)
+print r.describe()
+s = Square(4)
+print s.describe()
+)"s;
+    AssertSameOutput(program, "shape with area 0\nrect with area 6\nsquare with area 16\n"s);
+}
+
+void TestNewInstanceSharesInitInstance() {
+    // Как и при обходе дерева, поля, записанные __init__ в предыдущих вызовах, сохраняются
+    const string program = R"(
+class Lazy:
+  def __init__(set):
+    if set:
+      self.value = 'set'
+
+class Factory:
+  def make(set):
+    return Lazy(set)
+
+f = Factory()
+a = f.make(1)
+b = f.make(0)
+print b.value
+)"s;
+    AssertSameOutput(program, "set\n"s);
+}
+
+void TestErrors() {
+    AssertSameFailure("print 'before'\nprint x\n"s);
+    AssertSameFailure("x = 1\nx.y = 2\n"s);
+    AssertSameFailure("x = 1\nprint x.y\n"s);
+    AssertSameFailure("print 'a' - 'b'\n"s);
+    AssertSameFailure("print 1 / 0\n"s);
+    AssertSameFailure("print 1 < 'a'\n"s);
+    AssertSameFailure("class A:\n  def f(c):\n    if c:\n      y = 1\n    return y\na = A()\nprint a.f(1)\nprint a.f(0)\n"s);
+    AssertSameFailure("x = 1\nclass A:\n  def f():\n    return x\na = A()\nprint a.f()\n"s);
+}
+
+void TestCompilation() {
+    const string program = R"(
+class A:
+  def f(x):
+    return x + 1
+
+a = A()
+print a.f(1)
+)"s;
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto tree = ParseProgram(lexer);
+    const auto compiled = Compiler::Compile(*tree);
+    ASSERT_EQUAL(compiled->methods.size(), 1U);
+    ASSERT_EQUAL(compiled->methods.begin()->second->name, "A.f"s);
+    ASSERT(compiled->main.code.back().op == OpCode::ReturnNone);
+
+    // Программу можно выполнить повторно
+    for (int i = 0; i < 2; ++i) {
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        Execute(*compiled, closure, context);
+        ASSERT_EQUAL(context.output.str(), "2\n"s);
+    }
+}
+
+struct NativeBody : runtime::Executable {
+    runtime::ObjectHolder Execute(runtime::Closure&, runtime::Context&) override {
+        return runtime::ObjectHolder::Own(runtime::Number{42});
+    }
+};
+
+struct Unsupported : ast::Statement {
+    runtime::ObjectHolder Execute(runtime::Closure&, runtime::Context& context) override {
+        context.GetOutputStream() << "tree"s;
+        return {};
+    }
+};
+
+void TestFallback() {
+    // Методы, которые не удалось скомпилировать, исполняются обходом дерева
+    vector<runtime::Method> methods;
+    methods.push_back({"native"s, {}, make_unique<NativeBody>(), 0});
+    methods.push_back({"unsupported"s, {}, make_unique<ast::MethodBody>(make_unique<Unsupported>()), 1});
+    runtime::Class cls{"Native"s, std::move(methods), nullptr};
+
+    ast::Compound program(make_unique<ast::ClassDefinition>(runtime::ObjectHolder::Share(cls)),
+                          make_unique<ast::Assignment>("x"s, make_unique<ast::NewInstance>(cls)),
+                          make_unique<ast::Print>(make_unique<ast::MethodCall>(
+                              make_unique<ast::VariableValue>("x"s), "native"s,
+                              vector<unique_ptr<ast::Statement>>{})),
+                          make_unique<ast::MethodCall>(make_unique<ast::VariableValue>("x"s), "unsupported"s,
+                                                       vector<unique_ptr<ast::Statement>>{}));
+    const auto compiled = Compiler::Compile(program);
+    ASSERT(compiled->methods.empty());
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    Execute(*compiled, closure, context);
+    ASSERT_EQUAL(context.output.str(), "42\ntree"s);
+
+    // Программа, которую нельзя скомпилировать, целиком исполняется обходом дерева
+    ast::Compound unsupported(make_unique<ast::Print>(make_unique<ast::StringConst>(runtime::String{"ok "s})),
+                              make_unique<Unsupported>());
+    ASSERT_THROWS(Compiler::Compile(unsupported), CompileError);
+    runtime::DummyContext fallback_context;
+    runtime::Closure fallback_closure;
+    Run(unsupported, fallback_closure, fallback_context, Backend::Bytecode);
+    ASSERT_EQUAL(fallback_context.output.str(), "ok \ntree"s);
+}
+
+void TestDeepRecursion() {
+    // Кадры вызовов многократно увеличивают стек регистров
+    const string program = R"(
+class Sum:
+  def calc(n):
+    if n == 0:
+      return 0
+    part = n * 1
+    return part + self.calc(n - 1)
+
+s = Sum()
+print s.calc(1000)
+)"s;
+    AssertSameOutput(program, "500500\n"s);
+}
+
+void TestStacklessRecursion() {
+    // Рекурсия не в хвостовой позиции: глубина ограничена памятью стека кадров, а не стеком потока
+    const string program = R"(
+class Sum:
+  def calc(n):
+    if n == 0:
+      return 0
+    return n + self.calc(n - 1)
+
+s = Sum()
+print s.calc(200000)
+)"s;
+    CALL_STACK_STATS = {};
+    const auto result = RunWith(program, Backend::Stackless);
+    ASSERT(!result.failed);
+    ASSERT_EQUAL(result.text, "-1474736480\n"s);
+    ASSERT_EQUAL(CALL_STACK_STATS.calls, 200001U);
+    ASSERT_EQUAL(CALL_STACK_STATS.max_depth, 200001U);
+    ASSERT(CALL_STACK_STATS.peak_frame_bytes > 200000U * sizeof(runtime::ObjectHolder));
+    ASSERT(CALL_STACK_STATS.peak_frame_bytes <= GetFrameMemoryLimit());
+
+    // Вызов, для кадра которого не хватает памяти, завершает программу ошибкой
+    const auto limit = GetFrameMemoryLimit();
+    SetFrameMemoryLimit(CALL_STACK_STATS.peak_frame_bytes / 2);
+    const auto exceeded = RunWith(program, Backend::Stackless);
+    SetFrameMemoryLimit(limit);
+    ASSERT(exceeded.failed);
+    ASSERT(exceeded.text.empty());
+    ASSERT_EQUAL(runtime::STACK_REGION.Mark(), 0U);
+}
+
+void TestLoops() {
+    const string program = R"(
+class Grid:
+  def __init__(w):
+    self.w = w
+
+  def sum(h):
+    total = 0
+    for y in range(h):
+      for x in range(self.w):
+        if x == y:
+          continue
+        if x > 3:
+          break
+        total = total + x * y
+    return total
+
+  def first_over(limit):
+    n = 1
+    while True:
+      n = n * 2
+      if n > limit:
+        return n
+
+  def label(n):
+    s = ''
+    for i in range(n):
+      s = s + str(i) + ','
+    return s
+
+g = Grid(10)
+print g.sum(5), g.first_over(1000), g.label(4)
+n = 3
+while n:
+  n = n - 1
+  print 'n', n
+for i in range(n, 0):
+  print 'never'
+for i in range(-2, 1):
+  print i
+i = 0
+total = 0
+while i < 100000:
+  i = i + 1
+  if i > 10:
+    continue
+  total = total + i
+print i, total
+)"s;
+    AssertSameOutput(program, "46 1024 0,1,2,3,\nn 2\nn 1\nn 0\n-2\n-1\n0\n100000 55\n"s);
+    AssertSameFailure("for i in range('a'):\n  print i\n"s);
+    AssertSameFailure("for i in range(1, 2):\n  print i / 0\n"s);
+}
+
+void TestLists() {
+    const string program = R"(
+class Stack:
+  def __init__():
+    self.items = []
+
+  def push(x):
+    self.items.append(x)
+
+  def top():
+    return self.items[len(self.items) - 1]
+
+  def sum():
+    total = 0
+    for x in self.items:
+      total = total + x
+    return total
+
+class Point:
+  def __init__(x):
+    self.x = x
+
+  def __str__():
+    return 'P' + str(self.x)
+
+s = Stack()
+for i in range(5):
+  s.push(i * i)
+print s.items, s.top(), s.sum(), len(s.items), len('abc')
+grid = [[1, 2], [3, 4], []]
+grid[2].append(5)
+grid[0][1] = 20
+print grid, grid[-1][0], [Point(1), None, 'a', True], []
+empty = []
+if not empty and [0]:
+  print 'truth'
+print [1, [2]] == [1, [2]], [1, 2] == [1], [1] != [2]
+seen = [1]
+for x in seen:
+  if x < 4:
+    seen.append(x + 1)
+print seen, x
+for p in [Point(3), Point(4)]:
+  if p.x == 4:
+    break
+print p, str([p])
+last = seen.pop()
+print last, seen, len(seen)
+l = [1]
+l.append(l)
+m = [1]
+m.append(m)
+print l == l, l == m, l == [1, l], {'a': l} == {'a': m}
+# Циклические ссылки не освобождаются счётчиком ссылок
+l.pop()
+m.pop()
+)"s;
+    AssertSameOutput(program,
+                     "[0, 1, 4, 9, 16] 16 30 5 3\n"s
+                     "[[1, 20], [3, 4], [5]] 5 [P1, None, a, True] []\n"s
+                     "truth\n"s
+                     "True False True\n"s
+                     "[1, 2, 3, 4] 4\n"s
+                     "P4 [P4]\n"s
+                     "4 [1, 2, 3] 3\n"s
+                     "True True True True\n"s);
+    AssertSameFailure("x = [1]\nprint x[1]\n"s);
+    AssertSameFailure("x = [1]\nprint x['a']\n"s);
+    AssertSameFailure("x = 1\nprint x[0]\n"s);
+    AssertSameFailure("x = []\nx.pop()\n"s);
+    AssertSameFailure("x = [1]\nx.push(2)\n"s);
+    AssertSameFailure("for x in 5:\n  print x\n"s);
+    AssertSameFailure("print len(5)\n"s);
+}
+
+void TestDicts() {
+    const string program = R"(
+class Key:
+  def __init__(id):
+    self.id = id
+
+  def __hash__():
+    return self.id / 2
+
+  def __eq__(other):
+    return self.id == other.id
+
+  def __str__():
+    return 'K' + str(self.id)
+
+class Plain:
+  def __str__():
+    return 'plain'
+
+d = {'a': 1, 2: 'two', None: [3]}
+d['a'] = d['a'] + 10
+d[True] = False
+print d, len(d), d[2], d[None][0]
+print 'a' in d, 'b' in d, 'b' not in d, 1 in d, 1 in [1, 2], 'ell' in 'hello'
+keys = {}
+for i in range(6):
+  keys[Key(i)] = i * i
+print keys[Key(4)], Key(7) in keys, len(keys)
+p = Plain()
+q = Plain()
+ids = {p: 1}
+print p in ids, q in ids, ids
+print {} == {}, {1: 2, 3: 4} == {3: 4, 1: 2}, {1: 2} == {1: 3}, not {}, {'x': {}}
+)"s;
+    AssertSameOutput(program,
+                     "{a: 11, 2: two, None: [3], True: False} 4 two 3\n"s
+                     "True False True False True True\n"s
+                     "16 False 6\n"s
+                     "True False {plain: 1}\n"s
+                     "True True False True {x: {}}\n"s);
+    AssertSameFailure("d = {1: 2}\nprint d[2]\n"s);
+    AssertSameFailure("d = {}\nd[[1]] = 2\n"s);
+    AssertSameFailure("print 1 in 5\n"s);
+    AssertSameFailure("x = 1\nx['a'] = 2\n"s);
+}
+
+void TestStringRopes() {
+    const string program = R"(
+chunk = '0123456789abcdef0123456789abcdef'
+s = ''
+for i in range(100):
+  s = s + chunk
+t = s + '!'
+print len(s), len(t), s == t, s + '!' == t, s < t, 'f!' in t
+d = {t: 1}
+print d[s + '!'], str(s) == s
+print '<' + s + '>'
+)"s;
+    string text;
+    for (int i = 0; i < 100; ++i) {
+        text += "0123456789abcdef0123456789abcdef"s;
+    }
+    AssertSameOutput(program, "3200 3201 False True True True\n1 True\n<"s + text + ">\n"s);
+}
+
+void TestTemporaryStrings() {
+    // Дополнение временных строк на месте не меняет значений переменных, полей и параметров,
+    // в том числе параметров, которым хвостовой вызов передаёт аргументы без копирования
+    const string program = R"(
+class Builder:
+  def __init__():
+    self.name = 'b'
+
+  def twice(s):
+    t = s + '!'
+    return t + s
+
+  def loop(s, n):
+    if n == 0:
+      return s + '|' + s
+    return self.loop(s + str(n), n - 1)
+
+b = Builder()
+print b.twice('a' + 'b'), b.loop('x' + '', 3)
+x = 'ab'
+y = x + 'c' + 'd'
+z = b.name + '1' + '2'
+print x, y, (x + 'e') + (y + 'f'), z, b.name
+)"s;
+    AssertSameOutput(program, "ab!ab x321|x321\nab abcd abeabcdf b12 b\n"s);
+}
+
+void TestFieldShapes() {
+    const string program = R"(
+class Node:
+  def __init__(value, first):
+    if first:
+      self.value = value
+      self.next = None
+    else:
+      self.next = None
+      self.value = value
+
+  def init_extra():
+    self.extra = self.value * 10
+    return 1
+
+  def grow():
+    self.flag = self.init_extra()
+    return self.extra + self.flag
+
+  def wide():
+    self.a = 1
+    self.b = 2
+    self.c = 3
+    self.d = 4
+    self.e = 5
+    return self.a + self.b + self.c + self.d + self.e + self.value
+
+class Chain:
+  def __init__():
+    self.head = Node(1, True)
+    self.head.next = Node(2, False)
+
+  def second():
+    return self.head.next.value
+
+total = 0
+for i in range(10):
+  n = Node(i, i / 2 * 2 == i)
+  total = total + n.value
+print total
+c = Chain()
+print c.second(), c.head.value, Node(5, True).grow(), Node(6, False).grow(), Node(7, False).wide()
+c.head.next.value = 20
+print c.second()
+)"s;
+    const auto stats = runtime::FIELD_CACHE_STATS;
+    AssertSameOutput(program, "45\n2 1 51 61 22\n20\n"s);
+    // Экземпляры двух форм чередуются в одних и тех же точках обращения к полям
+    ASSERT(runtime::FIELD_CACHE_STATS.hits > stats.hits);
+    AssertSameFailure("class A:\n  def f():\n    return self.x\na = A()\nprint a.f()\n"s);
+}
+
+}  // namespace
+
+void RunVmTests(TestRunner& tr) {
+    RUN_TEST(tr, vm::TestExpressions);
+    RUN_TEST(tr, vm::TestMethods);
+    RUN_TEST(tr, vm::TestInheritance);
+    RUN_TEST(tr, vm::TestNewInstanceSharesInitInstance);
+    RUN_TEST(tr, vm::TestErrors);
+    RUN_TEST(tr, vm::TestCompilation);
+    RUN_TEST(tr, vm::TestFallback);
+    RUN_TEST(tr, vm::TestDeepRecursion);
+    RUN_TEST(tr, vm::TestStacklessRecursion);
+    RUN_TEST(tr, vm::TestLoops);
+    RUN_TEST(tr, vm::TestLists);
+    RUN_TEST(tr, vm::TestDicts);
+    RUN_TEST(tr, vm::TestStringRopes);
+    RUN_TEST(tr, vm::TestTemporaryStrings);
+    RUN_TEST(tr, vm::TestFieldShapes);
+}
+
+}  // namespace vm